@@ -3,25 +3,71 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <deque>
 #include <map>
+#include <unordered_map>
 #include <mutex>
 #include <atomic>
 #include <chrono>
 #include <memory>
+#include <memory_resource>
+#include <new>
 #include <cmath>
 #include <cstring>
 #include <stdexcept>
 #include <functional>
 #include <thread>
+#include <condition_variable>
 #include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
 #include <sstream>
+#include <cstdio>
+#include <cerrno>
 #include <shared_mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 // 常量定义
 const size_t DEFAULT_ALIGNMENT = 8;  // 默认对齐大小
 const size_t MIN_BLOCK_SIZE = 16;    // 最小块大小
 const size_t MAX_BLOCK_SIZE = 1024 * 1024;  // 最大块大小
 const double DEFAULT_GROWTH_FACTOR = 2.0;    // 默认增长因子
+const size_t THREAD_CACHE_MAX_BLOCK_SIZE = 32 * 1024;  // 线程缓存可缓存的最大块大小
+const size_t THREAD_CACHE_MAX_BYTES = 1024 * 1024;     // 每个线程缓存的最大字节数
+const size_t THREAD_CACHE_BIN_BYTES = 64 * 1024;       // 单个大小类缓存的目标字节数
+const size_t THREAD_CACHE_MAX_BIN_COUNT = 128;         // 单个大小类缓存的最大块数
+const size_t THREAD_CACHE_FREE_BATCH = 64;             // 延迟释放的批量大小
+const size_t SLAB_BLOCK_SIZE = 64 * 1024;              // 每个slab占用的伙伴块大小
+const size_t SLAB_MAX_OBJECT_SIZE = 4096;              // 由slab分配的最大对象大小
+const size_t SLAB_OBJECT_ALIGNMENT = 16;               // slab大小类的粒度，也是对象的最小对齐
+const uint8_t SLAB_ORDER_FLAG = 0x80;                  // 阶数表中标记slab块的位，低7位为大小类序号
+const uint8_t DEFERRED_FREE_FLAG = 0x40;               // 阶数表中标记已释放但尚未归还的伙伴块（线程缓存或远程释放链表中）
+const size_t SCAVENGER_SCAN_LIMIT = 4096;              // 后台回收每次持锁最多检查的最大块数
+const size_t LARGE_SPAN_CACHE_BYTES = 64 * 1024 * 1024; // 大对象span缓存的默认字节上限
+const size_t LARGE_SPAN_CACHE_COUNT = 16;              // 大对象span缓存最多保留的span数量
+const size_t DEFAULT_TIMING_SAMPLE_RATE = 64;          // 默认每64次操作计时一次
+const size_t REMOTE_FREE_BATCH = 256;                  // 远程释放链表每次批量归还的块数
+const size_t HANDLE_TABLE_CAPACITY = 1 << 20;          // 句柄表的槽位上限（按需占用物理页）
+const size_t COMPACTION_TARGET_SCAN = 64;              // 压缩器为每个块在每阶自由链表中最多检查的候选块数
+
+// 以2为底的对数（向下取整），可在编译期求值
+constexpr size_t floor_log2(size_t value) {
+    size_t result = 0;
+    while (value >>= 1) {
+        result++;
+    }
+    return result;
+}
 
 // 错误类型枚举
 enum class ErrorType {
@@ -55,7 +101,25 @@ struct MemoryUsage {
     double usage_percent = 0.0;
 };
 
-// 性能指标结构体
+// 计时的操作类型，每种操作一个延迟直方图
+enum class LatencyOp {
+    ALLOCATE,    // 分配
+    DEALLOCATE,  // 释放
+    SPLIT,       // 伙伴块分割
+    MERGE,       // 伙伴块合并
+    EXPAND,      // 内存池扩展
+    COUNT
+};
+
+// 延迟分位数结构体（由采样得到，单位纳秒）
+struct LatencySummary {
+    size_t samples = 0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+};
+
+// 性能指标结构体。平均值和最大值只统计被采样计时的操作
 struct PerformanceMetrics {
     double avg_alloc_time_ns = 0.0;
     double avg_dealloc_time_ns = 0.0;
@@ -63,6 +127,11 @@ struct PerformanceMetrics {
     size_t max_dealloc_time_ns = 0;
     size_t allocation_count = 0;
     size_t deallocation_count = 0;
+    LatencySummary alloc_latency;
+    LatencySummary dealloc_latency;
+    LatencySummary split_latency;
+    LatencySummary merge_latency;
+    LatencySummary expand_latency;
 };
 
 // 错误统计结构体
@@ -74,6 +143,56 @@ struct ErrorStats {
     double dealloc_failure_rate = 0.0;
 };
 
+// 后台回收配置
+struct ScavengerConfig {
+    std::chrono::milliseconds interval{1000};         // 两轮回收之间的间隔
+    std::chrono::milliseconds idle_threshold{10000};  // 最大块空闲超过该时长才归还给操作系统
+    size_t batch_size = 8;                            // 每次持锁最多处理的块数，限制分配路径上的停顿
+    bool use_madv_free = false;                       // 使用MADV_FREE（内存紧张时才由内核回收）代替MADV_DONTNEED
+    bool release_empty_segments = true;               // 解除映射完全空闲的内存段（初始内存段除外）
+};
+
+// 后台回收统计结构体
+struct ScavengerStats {
+    size_t passes = 0;              // 回收轮数
+    size_t released_bytes = 0;      // 通过madvise归还的字节数（累计）
+    size_t unmapped_bytes = 0;      // 解除映射的字节数（累计）
+    size_t unmapped_segments = 0;   // 解除映射的内存段数量（累计）
+};
+
+// 可重定位分配的句柄：低32位为槽位序号加一，高32位为槽位的代数，0表示空句柄
+using MemoryHandle = uint64_t;
+
+// 在线压缩配置：单步持锁期间的搬移块数、复制字节数和检查的句柄数都不超过上限，
+// 以此限制每一步的停顿；大于max_bytes的块不会被搬移
+struct CompactionConfig {
+    size_t max_moves = 64;            // 每步最多搬移的块数
+    size_t max_bytes = 1024 * 1024;   // 每步最多复制的字节数
+    size_t max_scan = 4096;           // 每步最多检查的句柄和候选空闲块数
+    double evacuate_threshold = 0.25; // 只含句柄块且使用率不高于该值的内存段（初始内存段除外）会被整体搬空
+};
+
+// 单步压缩结果
+struct CompactionResult {
+    size_t moved_blocks = 0;          // 搬移的块数
+    size_t moved_bytes = 0;           // 搬移的块字节数
+    size_t skipped_pinned = 0;        // 因被固定而跳过的块数
+    size_t released_segments = 0;     // 搬空后解除映射的内存段数
+    size_t released_bytes = 0;        // 解除映射的字节数
+    std::chrono::nanoseconds pause{0}; // 持有pool_mutex的时长
+    bool complete = false;            // 自上次搬移以来已检查完整个句柄表，继续调用不会再有进展
+};
+
+// 在线压缩统计结构体
+struct CompactionStats {
+    size_t steps = 0;                 // 压缩步数（累计）
+    size_t moved_blocks = 0;          // 搬移的块数（累计）
+    size_t moved_bytes = 0;           // 搬移的块字节数（累计）
+    size_t released_segments = 0;     // 解除映射的内存段数（累计）
+    size_t released_bytes = 0;        // 解除映射的字节数（累计）
+    std::chrono::nanoseconds max_pause{0}; // 单步持锁时长的最大值
+};
+
 // 健康报告结构体
 struct HealthReport {
     HealthStatus status = HealthStatus::HEALTHY;
@@ -83,14 +202,149 @@ struct HealthReport {
     double error_rate = 0.0;
 };
 
+// 按需清零的数组：存储来自匿名mmap，只有访问过的页才占用物理内存，
+// clear()把大数组的物理页归还给内核而不是逐字节清零。
+// 元素类型需可平凡默认构造和析构（整数或整数原子类型），全零即为初值
+template<typename T>
+class ZeroedArray {
+private:
+    static constexpr size_t MADVISE_THRESHOLD = 64 * 1024;  // 小于该大小时clear()直接memset
+    
+    T* data = nullptr;
+    size_t count = 0;
+    
+public:
+    ZeroedArray() = default;
+    
+    ~ZeroedArray() {
+        release();
+    }
+    
+    ZeroedArray(ZeroedArray&& other) noexcept : data(other.data), count(other.count) {
+        other.data = nullptr;
+        other.count = 0;
+    }
+    
+    ZeroedArray& operator=(ZeroedArray&& other) noexcept {
+        if (this != &other) {
+            release();
+            data = other.data;
+            count = other.count;
+            other.data = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+    
+    ZeroedArray(const ZeroedArray&) = delete;
+    ZeroedArray& operator=(const ZeroedArray&) = delete;
+    
+    // 重新分配n个值为零的元素
+    void reset(size_t n) {
+        release();
+        if (n == 0) {
+            return;
+        }
+        
+        void* memory = mmap(nullptr, n * sizeof(T), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        
+        // 平凡默认构造不写内存，只开始对象的生存期
+        data = static_cast<T*>(memory);
+        for (size_t i = 0; i < n; ++i) {
+            new (&data[i]) T;
+        }
+        count = n;
+    }
+    
+    // 所有元素恢复为零
+    void clear() {
+        if (count * sizeof(T) < MADVISE_THRESHOLD) {
+            std::memset(static_cast<void*>(data), 0, count * sizeof(T));
+        } else {
+            madvise(data, count * sizeof(T), MADV_DONTNEED);
+        }
+    }
+    
+    size_t size() const {
+        return count;
+    }
+    
+    T& operator[](size_t index) {
+        return data[index];
+    }
+    
+    const T& operator[](size_t index) const {
+        return data[index];
+    }
+    
+private:
+    void release() {
+        if (data) {
+            munmap(data, count * sizeof(T));
+            data = nullptr;
+            count = 0;
+        }
+    }
+};
+
 // 内存段结构体
 struct MemorySegment {
     void* base = nullptr;
     size_t size = 0;
     bool owned = false;  // 是否由内存池管理
+    // 每个最小块一个字节：已分配块起始位置记录(阶数+1)，其余为0。
+    // 写入在pool_mutex下进行，读取可以无锁；DEFERRED_FREE_FLAG由释放方在锁外用比较交换置位
+    ZeroedArray<std::atomic<uint8_t>> order_map;
+    // 每个阶数一个位图：位i表示段内第i个该阶大小的块在自由链表中
+    std::vector<ZeroedArray<uint64_t>> free_bitmaps;
+    // 每页一位：置位表示该页上有块被使用后释放过，内容不再保证为零。
+    // 未置位的页仍是内核按需清零的状态（空闲块起始处的描述符除外）
+    ZeroedArray<std::atomic<uint64_t>> dirty_pages;
+    // 后台回收：已分配（含slab块和线程缓存中的块）的字节数，
+    // 每个最大块最近一次进入自由链表的时间，以及是否已经归还给操作系统
+    size_t allocated_bytes = 0;
+    std::vector<uint64_t> top_free_since;
+    std::vector<uint8_t> top_released;
+    size_t arena_index = 0;  // 所属arena的序号，多arena前端据此把释放交回原arena
+    size_t handle_bytes = 0; // 句柄块的字节数，与allocated_bytes相等时压缩器可以把内存段整体搬空
+    // reset后段内从untouched_offset起按初始切分得到的块都空闲，但还没有放入自由链表，
+    // 自由链表取不到块时再逐个切出；untouched_since是这部分开始空闲的时间
+    size_t untouched_offset = 0;
+    uint64_t untouched_since = 0;
     
     MemorySegment(void* base_ptr = nullptr, size_t seg_size = 0, bool is_owned = false)
         : base(base_ptr), size(seg_size), owned(is_owned) {}
+    
+    uint8_t get_order_entry(size_t index) const {
+        return order_map[index].load(std::memory_order_relaxed);
+    }
+    
+    void set_order_entry(size_t index, uint8_t entry) {
+        order_map[index].store(entry, std::memory_order_relaxed);
+    }
+    
+    // 表项仍为expected时改为desired；同一个块的两次释放只有一次能成功
+    bool exchange_order_entry(size_t index, uint8_t expected, uint8_t desired) {
+        return order_map[index].compare_exchange_strong(expected, desired, std::memory_order_acq_rel,
+                                                        std::memory_order_relaxed);
+    }
+    
+    bool is_page_dirty(size_t page) const {
+        return (dirty_pages[page / 64].load(std::memory_order_relaxed) >> (page % 64)) & 1;
+    }
+    
+    void mark_page_dirty(size_t page) {
+        dirty_pages[page / 64].fetch_or(uint64_t(1) << (page % 64), std::memory_order_relaxed);
+    }
+    
+    bool contains(const void* ptr) const {
+        const char* start = static_cast<const char*>(base);
+        const char* target = static_cast<const char*>(ptr);
+        return target >= start && target < start + size;
+    }
 };
 
 // 内存池异常类
@@ -108,32 +362,25 @@ public:
 };
 
 // 内存块描述符类
+// 描述符直接构造在空闲块的起始位置（侵入式），块的地址就是描述符自身的地址。
+// 块被分配出去后描述符随之失效，因此分配和释放都不需要向系统堆申请节点。
+// 块的阶数由所在自由链表和内存段的空闲位图确定，描述符只保存双向链表指针
 class MemoryBlockDescriptor {
 private:
-    void* address;                     // 内存块地址
-    size_t size;                       // 内存块大小
-    bool allocated;                    // 是否已分配
     MemoryBlockDescriptor* next;       // 下一个块（用于链表）
+    MemoryBlockDescriptor* prev;       // 上一个块（用于O(1)摘除）
+    
+    MemoryBlockDescriptor() : next(nullptr), prev(nullptr) {}
     
 public:
-    MemoryBlockDescriptor(void* addr = nullptr, size_t sz = 0, bool alloc = false)
-        : address(addr), size(sz), allocated(alloc), next(nullptr) {}
+    // 在空闲块内原地构造描述符，块大小不能小于sizeof(MemoryBlockDescriptor)
+    static MemoryBlockDescriptor* create(void* addr) {
+        return new (addr) MemoryBlockDescriptor();
+    }
     
     // 基本属性
     void* get_address() const {
-        return address;
-    }
-    
-    size_t get_size() const {
-        return size;
-    }
-    
-    bool is_allocated() const {
-        return allocated;
-    }
-    
-    void set_allocated(bool alloc) {
-        allocated = alloc;
+        return const_cast<MemoryBlockDescriptor*>(this);
     }
     
     // 链表操作
@@ -145,21 +392,73 @@ public:
         next = next_block;
     }
     
-    // 伙伴系统
-    void* calculate_buddy_address() const {
-        if (!address) {
-            return nullptr;
+    MemoryBlockDescriptor* get_prev() const {
+        return prev;
+    }
+    
+    void set_prev(MemoryBlockDescriptor* prev_block) {
+        prev = prev_block;
+    }
+};
+
+// slab头部：构造在slab块（一个伙伴块）的起始位置，之后紧跟同一大小类的定长对象。
+// 空闲位图中1表示对象空闲，只在pool_mutex下修改，get_block_size可以无锁读取。
+// 延迟释放位图中1表示对象已释放但尚未归还，用原子读改写置位，可以在锁外进行
+struct SlabHeader {
+    static constexpr size_t BITMAP_WORDS = SLAB_BLOCK_SIZE / SLAB_OBJECT_ALIGNMENT / 64;
+    
+    SlabHeader* next = nullptr;        // 同一大小类的部分空闲slab链表
+    SlabHeader* prev = nullptr;
+    size_t class_index = 0;            // 大小类序号
+    size_t free_count = 0;             // 空闲对象数量
+    size_t search_hint = 0;            // 下一次从哪个位图字开始查找空闲对象
+    std::atomic<uint64_t> free_bitmap[BITMAP_WORDS];
+    std::atomic<uint64_t> deferred_bitmap[BITMAP_WORDS];
+    
+    SlabHeader() {
+        for (auto& word : free_bitmap) {
+            word.store(0, std::memory_order_relaxed);
         }
-        
-        uintptr_t addr = reinterpret_cast<uintptr_t>(address);
-        uintptr_t buddy_addr = addr ^ size;
-        
-        return reinterpret_cast<void*>(buddy_addr);
+        for (auto& word : deferred_bitmap) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+    
+    bool is_free(size_t index) const {
+        return (free_bitmap[index / 64].load(std::memory_order_relaxed) >> (index % 64)) & 1;
+    }
+    
+    void set_free(size_t index, bool free) {
+        uint64_t word = free_bitmap[index / 64].load(std::memory_order_relaxed);
+        uint64_t mask = uint64_t(1) << (index % 64);
+        free_bitmap[index / 64].store(free ? (word | mask) : (word & ~mask), std::memory_order_relaxed);
+    }
+    
+    bool is_deferred(size_t index) const {
+        return (deferred_bitmap[index / 64].load(std::memory_order_acquire) >> (index % 64)) & 1;
+    }
+    
+    // 置位成功返回true，已经置位时返回false
+    bool mark_deferred(size_t index) {
+        uint64_t mask = uint64_t(1) << (index % 64);
+        return !(deferred_bitmap[index / 64].fetch_or(mask, std::memory_order_acq_rel) & mask);
+    }
+    
+    void clear_deferred(size_t index) {
+        deferred_bitmap[index / 64].fetch_and(~(uint64_t(1) << (index % 64)), std::memory_order_release);
     }
 };
 
-// 自由链表类
-class FreeList {
+// 自由链表同步策略
+struct MutexFreeListPolicy {};     // 每次操作加互斥锁
+struct LockFreeFreeListPolicy {};  // 基于带版本号指针的无锁Treiber栈
+
+template<typename SyncPolicy = MutexFreeListPolicy>
+class BasicFreeList;
+
+// 自由链表类（互斥锁版本）
+template<>
+class BasicFreeList<MutexFreeListPolicy> {
 private:
     size_t block_size;                 // 内存块大小
     MemoryBlockDescriptor* head;      // 链表头
@@ -167,15 +466,11 @@ private:
     mutable std::mutex list_mutex;     // 链表锁
     
 public:
-    FreeList(size_t size = 0) : block_size(size), head(nullptr), block_count(0) {}
-    
-    ~FreeList() {
-        clear();
-    }
+    BasicFreeList(size_t size = 0) : block_size(size), head(nullptr), block_count(0) {}
     
     // 禁用拷贝构造和赋值操作
-    FreeList(const FreeList&) = delete;
-    FreeList& operator=(const FreeList&) = delete;
+    BasicFreeList(const BasicFreeList&) = delete;
+    BasicFreeList& operator=(const BasicFreeList&) = delete;
     
     // 链表操作
     void push(MemoryBlockDescriptor* block) {
@@ -185,7 +480,11 @@ public:
         
         std::lock_guard<std::mutex> lock(list_mutex);
         
+        block->set_prev(nullptr);
         block->set_next(head);
+        if (head) {
+            head->set_prev(block);
+        }
         head = block;
         block_count++;
     }
@@ -199,16 +498,29 @@ public:
         
         MemoryBlockDescriptor* block = head;
         head = head->get_next();
+        if (head) {
+            head->set_prev(nullptr);
+        }
         block_count--;
         
         return block;
     }
     
+    // 调用者已保证串行时使用，接口与无锁版本一致；本版本的push/pop已经维护prev指针
+    void push_locked(MemoryBlockDescriptor* block) {
+        push(block);
+    }
+    
+    MemoryBlockDescriptor* pop_locked() {
+        return pop();
+    }
+    
     bool is_empty() const {
         std::lock_guard<std::mutex> lock(list_mutex);
         return head == nullptr;
     }
     
+    // 通过前后指针O(1)摘除，block必须在本链表中
     bool remove(MemoryBlockDescriptor* block) {
         if (!block || !head) {
             return false;
@@ -216,38 +528,28 @@ public:
         
         std::lock_guard<std::mutex> lock(list_mutex);
         
-        // 如果要移除的是头节点
-        if (head == block) {
-            head = head->get_next();
-            block_count--;
-            return true;
-        }
+        MemoryBlockDescriptor* prev = block->get_prev();
+        MemoryBlockDescriptor* next = block->get_next();
         
-        // 查找要移除的节点
-        MemoryBlockDescriptor* current = head;
-        while (current->get_next() && current->get_next() != block) {
-            current = current->get_next();
+        if (prev) {
+            prev->set_next(next);
+        } else if (head == block) {
+            head = next;
+        } else {
+            return false;
         }
         
-        if (current->get_next() == block) {
-            current->set_next(block->get_next());
-            block_count--;
-            return true;
+        if (next) {
+            next->set_prev(prev);
         }
         
-        return false;
+        block_count--;
+        return true;
     }
     
+    // 描述符位于空闲块内部，清空时只需丢弃链表头
     void clear() {
         std::lock_guard<std::mutex> lock(list_mutex);
-        
-        MemoryBlockDescriptor* current = head;
-        while (current) {
-            MemoryBlockDescriptor* next = current->get_next();
-            delete current;
-            current = next;
-        }
-        
         head = nullptr;
         block_count = 0;
     }
@@ -257,6 +559,10 @@ public:
         return block_size;
     }
     
+    void set_block_size(size_t size) {
+        block_size = size;
+    }
+    
     size_t get_block_count() const {
         std::lock_guard<std::mutex> lock(list_mutex);
         return block_count;
@@ -272,6 +578,174 @@ public:
     }
 };
 
+// 自由链表类（无锁版本）
+// head把描述符指针（低48位）和版本号（高16位）打包进一个64位原子量，
+// 每次修改版本号加一，避免pop过程中头节点被弹出又压回导致的ABA问题。
+// 两种用法不能混用：
+// - push/pop/is_empty/get_block_count可并发调用，是不维护prev指针的Treiber栈。
+//   pop会读取可能已被其他线程弹出的节点的next，调用者需保证链表并发使用期间
+//   压入过的块一直可读（不解除映射）。
+// - push_locked/pop_locked/remove/clear/set_head要求调用者保证没有并发修改，
+//   维护prev指针，remove为O(1)。内存池在pool_mutex下只使用这一组
+template<>
+class BasicFreeList<LockFreeFreeListPolicy> {
+private:
+    static constexpr unsigned TAG_SHIFT = 48;
+    static constexpr uint64_t POINTER_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+    
+    size_t block_size;                 // 内存块大小
+    std::atomic<uint64_t> head;        // 带版本号的链表头
+    std::atomic<size_t> block_count;   // 内存块数量
+    
+    static_assert(sizeof(void*) == sizeof(uint64_t), "tagged pointer requires 64-bit pointers");
+    
+    static MemoryBlockDescriptor* to_pointer(uint64_t tagged) {
+        return reinterpret_cast<MemoryBlockDescriptor*>(tagged & POINTER_MASK);
+    }
+    
+    static uint64_t make_tagged(MemoryBlockDescriptor* block, uint64_t previous) {
+        uint64_t tag = (previous >> TAG_SHIFT) + 1;
+        return (tag << TAG_SHIFT) | (reinterpret_cast<uint64_t>(block) & POINTER_MASK);
+    }
+    
+public:
+    BasicFreeList(size_t size = 0) : block_size(size), head(0), block_count(0) {}
+    
+    // 禁用拷贝构造和赋值操作
+    BasicFreeList(const BasicFreeList&) = delete;
+    BasicFreeList& operator=(const BasicFreeList&) = delete;
+    
+    // 链表操作
+    void push(MemoryBlockDescriptor* block) {
+        if (!block) {
+            return;
+        }
+        
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            block->set_next(to_pointer(old_head));
+            new_head = make_tagged(block, old_head);
+        } while (!head.compare_exchange_weak(old_head, new_head, 
+                                             std::memory_order_release, 
+                                             std::memory_order_relaxed));
+        
+        block_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    MemoryBlockDescriptor* pop() {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        
+        while (MemoryBlockDescriptor* block = to_pointer(old_head)) {
+            // block可能已被其他线程弹出并交给调用者改写，此时读到的next无效，
+            // 但版本号变化会让CAS失败。读取本身依赖调用者保证块所在内存仍然映射
+            MemoryBlockDescriptor* next = block->get_next();
+            if (head.compare_exchange_weak(old_head, make_tagged(next, old_head), 
+                                           std::memory_order_acquire, 
+                                           std::memory_order_acquire)) {
+                block_count.fetch_sub(1, std::memory_order_relaxed);
+                return block;
+            }
+        }
+        
+        return nullptr;
+    }
+    
+    // 以下修改要求调用者保证串行，链表上只有本线程在读写节点，prev在此维护
+    void push_locked(MemoryBlockDescriptor* block) {
+        if (!block) {
+            return;
+        }
+        
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        MemoryBlockDescriptor* next = to_pointer(old_head);
+        block->set_prev(nullptr);
+        block->set_next(next);
+        if (next) {
+            next->set_prev(block);
+        }
+        head.store(make_tagged(block, old_head), std::memory_order_release);
+        block_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    MemoryBlockDescriptor* pop_locked() {
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        MemoryBlockDescriptor* block = to_pointer(old_head);
+        if (!block) {
+            return nullptr;
+        }
+        
+        MemoryBlockDescriptor* next = block->get_next();
+        if (next) {
+            next->set_prev(nullptr);
+        }
+        head.store(make_tagged(next, old_head), std::memory_order_release);
+        block_count.fetch_sub(1, std::memory_order_relaxed);
+        return block;
+    }
+    
+    bool is_empty() const {
+        return to_pointer(head.load(std::memory_order_acquire)) == nullptr;
+    }
+    
+    // 通过前后指针O(1)摘除，block必须在本链表中
+    bool remove(MemoryBlockDescriptor* block) {
+        uint64_t current_head = head.load(std::memory_order_acquire);
+        if (!block || !to_pointer(current_head)) {
+            return false;
+        }
+        
+        MemoryBlockDescriptor* prev = block->get_prev();
+        MemoryBlockDescriptor* next = block->get_next();
+        
+        if (prev) {
+            prev->set_next(next);
+        } else if (to_pointer(current_head) == block) {
+            head.store(make_tagged(next, current_head), std::memory_order_release);
+        } else {
+            return false;
+        }
+        
+        if (next) {
+            next->set_prev(prev);
+        }
+        
+        block_count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    void clear() {
+        uint64_t old_head = head.load(std::memory_order_acquire);
+        head.store(make_tagged(nullptr, old_head), std::memory_order_release);
+        block_count.store(0, std::memory_order_relaxed);
+    }
+    
+    // 查询方法
+    size_t get_block_size() const {
+        return block_size;
+    }
+    
+    void set_block_size(size_t size) {
+        block_size = size;
+    }
+    
+    size_t get_block_count() const {
+        return block_count.load(std::memory_order_relaxed);
+    }
+    
+    MemoryBlockDescriptor* get_head() const {
+        return to_pointer(head.load(std::memory_order_acquire));
+    }
+    
+    void set_head(MemoryBlockDescriptor* new_head) {
+        uint64_t old_head = head.load(std::memory_order_relaxed);
+        head.store(make_tagged(new_head, old_head), std::memory_order_release);
+    }
+};
+
+using FreeList = BasicFreeList<MutexFreeListPolicy>;
+using LockFreeFreeList = BasicFreeList<LockFreeFreeListPolicy>;
+
 // 内存对齐工具类
 class MemoryAlignment {
 public:
@@ -288,7 +762,7 @@ public:
     }
     
     // 计算向上对齐的大小
-    static size_t align_up(size_t size, size_t alignment) {
+    static constexpr size_t align_up(size_t size, size_t alignment) {
         if (alignment == 0) {
             return size;
         }
@@ -296,7 +770,7 @@ public:
     }
     
     // 计算向下对齐的大小
-    static size_t align_down(size_t size, size_t alignment) {
+    static constexpr size_t align_down(size_t size, size_t alignment) {
         if (alignment == 0) {
             return size;
         }
@@ -322,1123 +796,5918 @@ public:
     }
 };
 
-// 统计信息类
-class PoolStats {
-private:
-    // 基本统计
-    size_t total_memory;          // 总内存大小
-    size_t used_memory;           // 已使用内存大小
-    size_t free_memory;           // 空闲内存大小
-    size_t allocation_count;      // 分配次数
-    size_t deallocation_count;    // 释放次数
-    size_t fragment_count;        // 碎片数量
-    
-    // 性能统计
-    std::chrono::nanoseconds total_alloc_time;  // 总分配时间
-    std::chrono::nanoseconds total_dealloc_time; // 总释放时间
-    size_t max_alloc_time;        // 最大单次分配时间
-    size_t max_dealloc_time;      // 最大单次释放时间
-    
-    // 历史统计
-    size_t peak_memory_usage;     // 峰值内存使用量
-    size_t peak_allocation_count; // 峰值分配次数
-    std::chrono::system_clock::time_point creation_time; // 创建时间
-    std::chrono::system_clock::time_point last_access_time; // 最后访问时间
-    
-    // 错误统计
-    size_t allocation_failures;   // 分配失败次数
-    size_t deallocation_failures; // 释放失败次数
-    size_t invalid_pointer_errors; // 无效指针错误次数
-    
-    // 块大小分布
-    std::map<size_t, size_t> block_size_distribution; // 块大小分布
-    
-    mutable std::shared_mutex stats_mutex; // 读写锁
-    
+// 周期计数器：x86上读取TSC，其他平台退化为steady_clock的纳秒数。
+// 第一次换算时对照steady_clock校准一次（约2ms），之后换算只是一次乘法
+class CycleClock {
 public:
-    PoolStats() 
-        : total_memory(0), used_memory(0), free_memory(0), 
-          allocation_count(0), deallocation_count(0), fragment_count(0),
-          total_alloc_time(0), total_dealloc_time(0),
-          max_alloc_time(0), max_dealloc_time(0),
-          peak_memory_usage(0), peak_allocation_count(0),
-          allocation_failures(0), deallocation_failures(0),
-          invalid_pointer_errors(0) {
-        creation_time = std::chrono::system_clock::now();
-        last_access_time = creation_time;
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
     }
     
-    // 禁用拷贝构造和赋值操作
-    PoolStats(const PoolStats&) = delete;
-    PoolStats& operator=(const PoolStats&) = delete;
-    
-    // 基本统计方法
-    size_t get_total_memory() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return total_memory;
+    static double nanoseconds_per_tick() {
+        static const double ratio = calibrate();
+        return ratio;
     }
     
-    size_t get_used_memory() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return used_memory;
+    static std::chrono::nanoseconds to_duration(uint64_t ticks) {
+        return std::chrono::nanoseconds(static_cast<int64_t>(ticks * nanoseconds_per_tick()));
     }
     
-    size_t get_free_memory() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return free_memory;
+private:
+    static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+        auto wall_start = std::chrono::steady_clock::now();
+        uint64_t tick_start = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        auto wall_end = std::chrono::steady_clock::now();
+        uint64_t tick_end = now();
+        
+        double elapsed_ns = std::chrono::duration<double, std::nano>(wall_end - wall_start).count();
+        return tick_end > tick_start ? elapsed_ns / (tick_end - tick_start) : 1.0;
+#else
+        return 1.0;
+#endif
     }
+};
+
+// HDR风格的延迟直方图：小于16ns的值各占一个桶，更大的值按2的幂分段、
+// 每段等分为16个子桶，相对误差不超过1/16。记录只是一次relaxed原子加
+class LatencyHistogram {
+public:
+    static constexpr size_t SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t MAX_EXPONENT = 40;   // 2^41ns（约37分钟）以上的值计入最后一个桶
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
     
-    size_t get_allocation_count() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return allocation_count;
-    }
+private:
+    std::atomic<uint64_t> buckets[BUCKET_COUNT] = {};
     
-    size_t get_deallocation_count() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return deallocation_count;
+    static size_t bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        size_t exponent = 63 - __builtin_clzll(value);
+        if (exponent > MAX_EXPONENT) {
+            return BUCKET_COUNT - 1;
+        }
+        size_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
     }
     
-    size_t get_fragment_count() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return fragment_count;
+    // 桶内的最大值
+    static uint64_t bucket_upper_bound(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        size_t exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint64_t lower = uint64_t(SUB_BUCKETS + index % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS);
+        return lower + (uint64_t(1) << (exponent - SUB_BUCKET_BITS)) - 1;
     }
     
-    // 性能统计方法
-    std::chrono::nanoseconds get_total_alloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return total_alloc_time;
-    }
+public:
+    LatencyHistogram() = default;
     
-    std::chrono::nanoseconds get_total_dealloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return total_dealloc_time;
+    LatencyHistogram(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            buckets[i].store(other.buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
     }
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
     
-    size_t get_max_alloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return max_alloc_time;
+    void record(uint64_t value) {
+        buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
     }
     
-    size_t get_max_dealloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return max_dealloc_time;
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            buckets[i].fetch_add(other.buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
     }
     
-    double get_average_alloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        if (allocation_count == 0) {
-            return 0.0;
+    size_t count() const {
+        size_t total = 0;
+        for (const auto& bucket : buckets) {
+            total += bucket.load(std::memory_order_relaxed);
         }
-        return static_cast<double>(total_alloc_time.count()) / allocation_count;
+        return total;
     }
     
-    double get_average_dealloc_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        if (deallocation_count == 0) {
-            return 0.0;
+    // 返回不小于quantile比例样本的最小桶上界，没有样本时返回0
+    uint64_t percentile(double quantile) const {
+        size_t total = count();
+        if (total == 0) {
+            return 0;
+        }
+        
+        size_t target = static_cast<size_t>(std::ceil(quantile * total));
+        target = std::max<size_t>(1, std::min(target, total));
+        
+        size_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) {
+                return bucket_upper_bound(i);
+            }
         }
-        return static_cast<double>(total_dealloc_time.count()) / deallocation_count;
+        return bucket_upper_bound(BUCKET_COUNT - 1);
     }
     
-    // 历史统计方法
-    size_t get_peak_memory_usage() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return peak_memory_usage;
+    void reset() {
+        for (auto& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
     }
+};
+
+// 统计信息类：计数器分散在按缓存行对齐的分片中，前SHARD_COUNT-1个线程各独占一个分片，
+// 更新只是几次relaxed读写；其余线程共用最后一个分片，使用原子加。查询时再汇总各分片。
+// 块大小分布按以2为底的对数分桶
+class PoolStats {
+public:
+    static constexpr size_t SHARD_COUNT = 16;       // 分片数量
+    static constexpr size_t SIZE_BUCKETS = 64;      // 块大小分布的桶数，第k个桶统计[2^k, 2^(k+1))
+    static constexpr size_t PEAK_SAMPLE_INTERVAL = 256; // 每个分片每隔多少次分配刷新一次峰值和最后访问时间
     
-    size_t get_peak_allocation_count() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return peak_allocation_count;
-    }
+private:
+    struct alignas(64) Shard {
+        std::atomic<size_t> allocation_count{0};    // 分配次数
+        std::atomic<size_t> deallocation_count{0};  // 释放次数
+        std::atomic<size_t> allocated_bytes{0};     // 累计分配字节数
+        std::atomic<size_t> deallocated_bytes{0};   // 累计释放字节数
+        std::atomic<size_t> timed_allocations{0};   // 被采样计时的分配次数
+        std::atomic<size_t> timed_deallocations{0}; // 被采样计时的释放次数
+        std::atomic<uint64_t> total_alloc_time{0};  // 被采样分配的总时间（纳秒）
+        std::atomic<uint64_t> total_dealloc_time{0}; // 被采样释放的总时间（纳秒）
+        std::atomic<uint64_t> max_alloc_time{0};    // 最大单次分配时间
+        std::atomic<uint64_t> max_dealloc_time{0};  // 最大单次释放时间
+        std::atomic<size_t> allocation_failures{0}; // 分配失败次数
+        std::atomic<size_t> deallocation_failures{0}; // 释放失败次数
+        std::atomic<size_t> invalid_pointer_errors{0}; // 无效指针错误次数
+        std::atomic<size_t> size_histogram[SIZE_BUCKETS] = {}; // 块大小分布
+    };
     
-    std::chrono::system_clock::time_point get_creation_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return creation_time;
-    }
+    Shard shards[SHARD_COUNT];
+    
+    // 各类操作的延迟直方图，只记录被采样的操作
+    LatencyHistogram latency_histograms[static_cast<size_t>(LatencyOp::COUNT)];
+    
+    // 很少更新的全局量
+    std::atomic<size_t> total_memory{0};        // 总内存大小
+    std::atomic<long> fragment_count{0};        // 碎片数量
+    std::atomic<size_t> peak_memory_usage{0};   // 峰值内存使用量（按PEAK_SAMPLE_INTERVAL采样）
+    std::atomic<int64_t> creation_time{0};      // 创建时间
+    std::atomic<int64_t> last_access_time{0};   // 最后访问时间（按PEAK_SAMPLE_INTERVAL采样）
+    
+    // 大对象统计（超过最大块大小、直接由mmap提供的分配，不计入上面的内存用量）
+    std::atomic<size_t> large_object_count{0};  // 存活的大对象数量
+    std::atomic<size_t> large_object_memory{0}; // 存活大对象的映射字节数
+    std::atomic<size_t> large_cache_hits{0};    // 由span缓存满足的大对象分配次数
+    std::atomic<size_t> large_cache_memory{0};  // span缓存中保留的字节数
+    
+    // 线程到分片的映射，所有PoolStats共用：线程首次更新时认领一个空闲的独占槽位，
+    // 退出时归还；槽位用完后使用最后一个共享分片
+    struct ShardSlot {
+        size_t index = SHARD_COUNT - 1;
+        bool exclusive = false;
+        
+        ShardSlot() {
+            for (size_t i = 0; i < SHARD_COUNT - 1; ++i) {
+                bool expected = false;
+                if (slot_owned()[i].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    index = i;
+                    exclusive = true;
+                    break;
+                }
+            }
+        }
+        
+        ~ShardSlot() {
+            if (exclusive) {
+                slot_owned()[index].store(false, std::memory_order_release);
+            }
+        }
+    };
+    
+    static std::atomic<bool>* slot_owned() {
+        static std::atomic<bool> owned[SHARD_COUNT - 1] = {};
+        return owned;
+    }
+    
+    static const ShardSlot& local_slot() {
+        thread_local ShardSlot slot;
+        return slot;
+    }
+    
+    // 独占分片只有当前线程写入，不需要带锁前缀的读改写
+    template<typename T>
+    static void add(std::atomic<T>& counter, T value, bool exclusive) {
+        if (exclusive) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        } else {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+    
+    static void update_max(std::atomic<uint64_t>& target, uint64_t value, bool exclusive) {
+        uint64_t current = target.load(std::memory_order_relaxed);
+        if (exclusive) {
+            if (value > current) {
+                target.store(value, std::memory_order_relaxed);
+            }
+            return;
+        }
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+    
+    static size_t size_bucket(size_t size) {
+        return size == 0 ? 0 : 63 - __builtin_clzll(size);
+    }
+    
+    static int64_t now_time() {
+        return std::chrono::system_clock::now().time_since_epoch().count();
+    }
+    
+    template<typename Field>
+    uint64_t sum(Field field) const {
+        uint64_t total = 0;
+        for (const Shard& shard : shards) {
+            total += (shard.*field).load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    
+    template<typename Field>
+    uint64_t max_of(Field field) const {
+        uint64_t result = 0;
+        for (const Shard& shard : shards) {
+            result = std::max<uint64_t>(result, (shard.*field).load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+    
+    // 每个分片的分配次数跨过采样间隔时汇总一次当前用量，更新峰值和最后访问时间
+    void sample_peak(size_t previous_count, size_t count) {
+        if (previous_count / PEAK_SAMPLE_INTERVAL == (previous_count + count) / PEAK_SAMPLE_INTERVAL) {
+            return;
+        }
+        
+        uint64_t used = get_used_memory();
+        uint64_t peak = peak_memory_usage.load(std::memory_order_relaxed);
+        while (used > peak && !peak_memory_usage.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+        last_access_time.store(now_time(), std::memory_order_relaxed);
+    }
+    
+public:
+    PoolStats() {
+        creation_time.store(now_time(), std::memory_order_relaxed);
+        last_access_time.store(creation_time.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    
+    // 拷贝构造用于生成快照：各分片汇总到快照的第一个分片，禁用赋值操作
+    PoolStats(const PoolStats& other)
+        : latency_histograms{other.latency_histograms[0], other.latency_histograms[1], other.latency_histograms[2],
+                             other.latency_histograms[3], other.latency_histograms[4]} {
+        static_assert(static_cast<size_t>(LatencyOp::COUNT) == 5, "update the histogram copy list");
+        Shard& snapshot = shards[0];
+        snapshot.allocation_count.store(other.sum(&Shard::allocation_count), std::memory_order_relaxed);
+        snapshot.deallocation_count.store(other.sum(&Shard::deallocation_count), std::memory_order_relaxed);
+        snapshot.allocated_bytes.store(other.sum(&Shard::allocated_bytes), std::memory_order_relaxed);
+        snapshot.deallocated_bytes.store(other.sum(&Shard::deallocated_bytes), std::memory_order_relaxed);
+        snapshot.timed_allocations.store(other.sum(&Shard::timed_allocations), std::memory_order_relaxed);
+        snapshot.timed_deallocations.store(other.sum(&Shard::timed_deallocations), std::memory_order_relaxed);
+        snapshot.total_alloc_time.store(other.sum(&Shard::total_alloc_time), std::memory_order_relaxed);
+        snapshot.total_dealloc_time.store(other.sum(&Shard::total_dealloc_time), std::memory_order_relaxed);
+        snapshot.max_alloc_time.store(other.max_of(&Shard::max_alloc_time), std::memory_order_relaxed);
+        snapshot.max_dealloc_time.store(other.max_of(&Shard::max_dealloc_time), std::memory_order_relaxed);
+        snapshot.allocation_failures.store(other.sum(&Shard::allocation_failures), std::memory_order_relaxed);
+        snapshot.deallocation_failures.store(other.sum(&Shard::deallocation_failures), std::memory_order_relaxed);
+        snapshot.invalid_pointer_errors.store(other.sum(&Shard::invalid_pointer_errors), std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket < SIZE_BUCKETS; ++bucket) {
+            size_t count = 0;
+            for (const Shard& shard : other.shards) {
+                count += shard.size_histogram[bucket].load(std::memory_order_relaxed);
+            }
+            snapshot.size_histogram[bucket].store(count, std::memory_order_relaxed);
+        }
+        
+        total_memory.store(other.total_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        fragment_count.store(other.fragment_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        peak_memory_usage.store(other.get_peak_memory_usage(), std::memory_order_relaxed);
+        creation_time.store(other.creation_time.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        last_access_time.store(other.last_access_time.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_object_count.store(other.large_object_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_object_memory.store(other.large_object_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_cache_hits.store(other.large_cache_hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_cache_memory.store(other.large_cache_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    PoolStats& operator=(const PoolStats&) = delete;
+    
+    // 把另一份统计累加进来，用于汇总多个arena。峰值取各自峰值之和，是汇总后峰值的上界
+    void merge(const PoolStats& other) {
+        Shard& target = shards[0];
+        for (auto field : {&Shard::allocation_count, &Shard::deallocation_count,
+                           &Shard::allocated_bytes, &Shard::deallocated_bytes,
+                           &Shard::timed_allocations, &Shard::timed_deallocations,
+                           &Shard::total_alloc_time, &Shard::total_dealloc_time,
+                           &Shard::allocation_failures, &Shard::deallocation_failures,
+                           &Shard::invalid_pointer_errors}) {
+            (target.*field).fetch_add(other.sum(field), std::memory_order_relaxed);
+        }
+        update_max(target.max_alloc_time, other.max_of(&Shard::max_alloc_time), false);
+        update_max(target.max_dealloc_time, other.max_of(&Shard::max_dealloc_time), false);
+        for (size_t bucket = 0; bucket < SIZE_BUCKETS; ++bucket) {
+            size_t count = 0;
+            for (const Shard& shard : other.shards) {
+                count += shard.size_histogram[bucket].load(std::memory_order_relaxed);
+            }
+            target.size_histogram[bucket].fetch_add(count, std::memory_order_relaxed);
+        }
+        for (size_t op = 0; op < static_cast<size_t>(LatencyOp::COUNT); ++op) {
+            latency_histograms[op].merge(other.latency_histograms[op]);
+        }
+        
+        total_memory.fetch_add(other.total_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        fragment_count.fetch_add(other.fragment_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        peak_memory_usage.fetch_add(other.get_peak_memory_usage(), std::memory_order_relaxed);
+        creation_time.store(std::min(creation_time.load(std::memory_order_relaxed),
+                                     other.creation_time.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        last_access_time.store(std::max(last_access_time.load(std::memory_order_relaxed),
+                                        other.last_access_time.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        large_object_count.fetch_add(other.large_object_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_object_memory.fetch_add(other.large_object_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_cache_hits.fetch_add(other.large_cache_hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        large_cache_memory.fetch_add(other.large_cache_memory.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    
+    // 统计策略接口：为false时内存池不读取时钟
+    static constexpr bool ENABLED = true;
+    
+    // 基本统计方法
+    size_t get_total_memory() const {
+        return total_memory.load(std::memory_order_relaxed);
+    }
+    
+    // 已使用内存由各分片的累计分配和释放字节数相减得到；
+    // 分配和释放可能落在不同分片，只有总和有意义
+    size_t get_used_memory() const {
+        uint64_t allocated = sum(&Shard::allocated_bytes);
+        uint64_t deallocated = sum(&Shard::deallocated_bytes);
+        return allocated > deallocated ? allocated - deallocated : 0;
+    }
+    
+    size_t get_free_memory() const {
+        size_t total = get_total_memory();
+        size_t used = get_used_memory();
+        return total > used ? total - used : 0;
+    }
+    
+    size_t get_allocation_count() const {
+        return sum(&Shard::allocation_count);
+    }
+    
+    size_t get_deallocation_count() const {
+        return sum(&Shard::deallocation_count);
+    }
+    
+    size_t get_fragment_count() const {
+        return std::max<long>(0, fragment_count.load(std::memory_order_relaxed));
+    }
+    
+    // 性能统计方法
+    std::chrono::nanoseconds get_total_alloc_time() const {
+        return std::chrono::nanoseconds(sum(&Shard::total_alloc_time));
+    }
+    
+    std::chrono::nanoseconds get_total_dealloc_time() const {
+        return std::chrono::nanoseconds(sum(&Shard::total_dealloc_time));
+    }
+    
+    size_t get_max_alloc_time() const {
+        return max_of(&Shard::max_alloc_time);
+    }
+    
+    size_t get_max_dealloc_time() const {
+        return max_of(&Shard::max_dealloc_time);
+    }
+    
+    double get_average_alloc_time() const {
+        size_t count = sum(&Shard::timed_allocations);
+        if (count == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(get_total_alloc_time().count()) / count;
+    }
+    
+    double get_average_dealloc_time() const {
+        size_t count = sum(&Shard::timed_deallocations);
+        if (count == 0) {
+            return 0.0;
+        }
+        return static_cast<double>(get_total_dealloc_time().count()) / count;
+    }
+    
+    // 历史统计方法
+    size_t get_peak_memory_usage() const {
+        return std::max<size_t>(peak_memory_usage.load(std::memory_order_relaxed), get_used_memory());
+    }
+    
+    size_t get_peak_allocation_count() const {
+        return get_allocation_count();
+    }
+    
+    std::chrono::system_clock::time_point get_creation_time() const {
+        return std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(creation_time.load(std::memory_order_relaxed)));
+    }
     
     std::chrono::system_clock::time_point get_last_access_time() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return last_access_time;
+        return std::chrono::system_clock::time_point(
+            std::chrono::system_clock::duration(last_access_time.load(std::memory_order_relaxed)));
     }
     
     std::chrono::duration<double> get_uptime() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return std::chrono::system_clock::now() - creation_time;
+        return std::chrono::system_clock::now() - get_creation_time();
     }
     
     // 错误统计方法
     size_t get_allocation_failures() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return allocation_failures;
+        return sum(&Shard::allocation_failures);
     }
     
     size_t get_deallocation_failures() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return deallocation_failures;
+        return sum(&Shard::deallocation_failures);
     }
     
     size_t get_invalid_pointer_errors() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        return invalid_pointer_errors;
+        return sum(&Shard::invalid_pointer_errors);
     }
     
     double get_allocation_failure_rate() const {
-        std::shared_lock<std::shared_mutex> lock(stats_mutex);
-        if (allocation_count == 0) {
+        size_t count = get_allocation_count();
+        if (count == 0) {
             return 0.0;
         }
+        return static_cast<double>(get_allocation_failures()) / count;
     }
     
     double get_deallocation_failure_rate() const {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        if (deallocation_count == 0) {
+        size_t count = get_deallocation_count();
+        if (count == 0) {
             return 0.0;
         }
-        return static_cast<double>(deallocation_failures) / deallocation_count;
+        return static_cast<double>(get_deallocation_failures()) / count;
     }
     
-    // 块大小分布
+    // 块大小分布：键为桶的下界2^k，值为落在[2^k, 2^(k+1))内的分配次数
     const std::map<size_t, size_t> get_block_size_distribution() const {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        return block_size_distribution;
+        std::map<size_t, size_t> distribution;
+        for (size_t bucket = 0; bucket < SIZE_BUCKETS; ++bucket) {
+            size_t count = 0;
+            for (const Shard& shard : shards) {
+                count += shard.size_histogram[bucket].load(std::memory_order_relaxed);
+            }
+            if (count > 0) {
+                distribution[size_t(1) << bucket] = count;
+            }
+        }
+        return distribution;
+    }
+    
+    // 延迟分位数（纳秒），quantile取0到1
+    uint64_t get_latency_percentile(LatencyOp op, double quantile) const {
+        return latency_histograms[static_cast<size_t>(op)].percentile(quantile);
+    }
+    
+    size_t get_latency_sample_count(LatencyOp op) const {
+        return latency_histograms[static_cast<size_t>(op)].count();
+    }
+    
+    // 大对象统计方法
+    size_t get_large_object_count() const {
+        return large_object_count.load(std::memory_order_relaxed);
+    }
+    
+    size_t get_large_object_memory() const {
+        return large_object_memory.load(std::memory_order_relaxed);
+    }
+    
+    size_t get_large_cache_hits() const {
+        return large_cache_hits.load(std::memory_order_relaxed);
+    }
+    
+    size_t get_large_cache_memory() const {
+        return large_cache_memory.load(std::memory_order_relaxed);
     }
     
     // 使用率和碎片率
     double get_memory_usage() const {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        if (total_memory == 0) {
+        size_t total = get_total_memory();
+        if (total == 0) {
             return 0.0;
         }
-        return static_cast<double>(used_memory) / total_memory * 100.0;
+        return static_cast<double>(get_used_memory()) / total * 100.0;
     }
     
     double get_fragmentation_rate() const {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        if (free_memory == 0) {
+        size_t free = get_free_memory();
+        if (free == 0) {
             return 0.0;
         }
-        return static_cast<double>(fragment_count) / (free_memory / MIN_BLOCK_SIZE) * 100.0;
+        return static_cast<double>(get_fragment_count()) / (free / MIN_BLOCK_SIZE) * 100.0;
     }
     
     // 更新方法
-    void update_allocation(size_t size, std::chrono::nanoseconds duration) {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        
-        allocation_count++;
-        used_memory += size;
-        free_memory -= size;
-        total_alloc_time += duration;
-        
-        if (duration.count() > max_alloc_time) {
-            max_alloc_time = duration.count();
+    // timed为false表示本次操作没有被采样计时，duration不参与平均值和最大值
+    void update_allocation(size_t size, std::chrono::nanoseconds duration, bool timed = true) {
+        update_allocation_batch(size, 1, duration, duration, timed ? 1 : 0);
+    }
+    
+    void update_deallocation(size_t size, std::chrono::nanoseconds duration, bool timed = true) {
+        update_deallocation_batch(size, 1, duration, duration, timed ? 1 : 0);
+    }
+    
+    // 批量更新，供线程缓存和批量接口把本地累积的计数一次性合并进来；
+    // duration是其中timed_count次被采样操作的总时间
+    void update_allocation_batch(size_t size, size_t count, 
+                                 std::chrono::nanoseconds duration, 
+                                 std::chrono::nanoseconds max_duration,
+                                 size_t timed_count) {
+        if (count == 0) {
+            return;
         }
         
-        if (used_memory > peak_memory_usage) {
-            peak_memory_usage = used_memory;
+        const ShardSlot& slot = local_slot();
+        Shard& shard = shards[slot.index];
+        size_t previous_count = shard.allocation_count.load(std::memory_order_relaxed);
+        add(shard.allocation_count, count, slot.exclusive);
+        add(shard.allocated_bytes, size * count, slot.exclusive);
+        if (timed_count > 0) {
+            add(shard.timed_allocations, timed_count, slot.exclusive);
+            add<uint64_t>(shard.total_alloc_time, duration.count(), slot.exclusive);
+            update_max(shard.max_alloc_time, max_duration.count(), slot.exclusive);
         }
+        add(shard.size_histogram[size_bucket(size)], count, slot.exclusive);
         
-        if (allocation_count > peak_allocation_count) {
-            peak_allocation_count = allocation_count;
+        sample_peak(previous_count, count);
+    }
+    
+    void update_deallocation_batch(size_t total_size, size_t count, 
+                                   std::chrono::nanoseconds duration, 
+                                   std::chrono::nanoseconds max_duration,
+                                   size_t timed_count) {
+        if (count == 0) {
+            return;
         }
         
-        last_access_time = std::chrono::system_clock::now();
-        
-        // 更新块大小分布
-        block_size_distribution[size]++;
+        const ShardSlot& slot = local_slot();
+        Shard& shard = shards[slot.index];
+        add(shard.deallocation_count, count, slot.exclusive);
+        add(shard.deallocated_bytes, total_size, slot.exclusive);
+        if (timed_count > 0) {
+            add(shard.timed_deallocations, timed_count, slot.exclusive);
+            add<uint64_t>(shard.total_dealloc_time, duration.count(), slot.exclusive);
+            update_max(shard.max_dealloc_time, max_duration.count(), slot.exclusive);
+        }
     }
     
-    void update_deallocation(size_t size, std::chrono::nanoseconds duration) {
-        std::lock_guard<std::mutex> lock(stats_mutex);
+    // 大对象的分配和释放计入分配/释放次数与耗时，字节数单独统计
+    void update_large_allocation(size_t size, std::chrono::nanoseconds duration, bool cache_hit, bool timed = true) {
+        const ShardSlot& slot = local_slot();
+        Shard& shard = shards[slot.index];
+        add<size_t>(shard.allocation_count, 1, slot.exclusive);
+        if (timed) {
+            add<size_t>(shard.timed_allocations, 1, slot.exclusive);
+            add<uint64_t>(shard.total_alloc_time, duration.count(), slot.exclusive);
+            update_max(shard.max_alloc_time, duration.count(), slot.exclusive);
+        }
         
-        deallocation_count++;
-        used_memory -= size;
-        free_memory += size;
-        total_dealloc_time += duration;
+        large_object_count.fetch_add(1, std::memory_order_relaxed);
+        large_object_memory.fetch_add(size, std::memory_order_relaxed);
+        if (cache_hit) {
+            large_cache_hits.fetch_add(1, std::memory_order_relaxed);
+        }
         
-        if (duration.count() > max_dealloc_time) {
-            max_dealloc_time = duration.count();
+        last_access_time.store(now_time(), std::memory_order_relaxed);
+    }
+    
+    void update_large_deallocation(size_t size, std::chrono::nanoseconds duration, bool timed = true) {
+        const ShardSlot& slot = local_slot();
+        Shard& shard = shards[slot.index];
+        add<size_t>(shard.deallocation_count, 1, slot.exclusive);
+        if (timed) {
+            add<size_t>(shard.timed_deallocations, 1, slot.exclusive);
+            add<uint64_t>(shard.total_dealloc_time, duration.count(), slot.exclusive);
+            update_max(shard.max_dealloc_time, duration.count(), slot.exclusive);
         }
         
-        last_access_time = std::chrono::system_clock::now();
+        large_object_count.fetch_sub(1, std::memory_order_relaxed);
+        large_object_memory.fetch_sub(size, std::memory_order_relaxed);
+        
+        last_access_time.store(now_time(), std::memory_order_relaxed);
+    }
+    
+    void set_large_cache_memory(size_t size) {
+        large_cache_memory.store(size, std::memory_order_relaxed);
+    }
+    
+    void record_latency(LatencyOp op, std::chrono::nanoseconds duration) {
+        latency_histograms[static_cast<size_t>(op)].record(duration.count() > 0 ? duration.count() : 0);
     }
     
     void update_allocation_failure() {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        allocation_failures++;
-        last_access_time = std::chrono::system_clock::now();
+        const ShardSlot& slot = local_slot();
+        add<size_t>(shards[slot.index].allocation_failures, 1, slot.exclusive);
+        last_access_time.store(now_time(), std::memory_order_relaxed);
     }
     
     void update_deallocation_failure() {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        deallocation_failures++;
-        last_access_time = std::chrono::system_clock::now();
+        const ShardSlot& slot = local_slot();
+        add<size_t>(shards[slot.index].deallocation_failures, 1, slot.exclusive);
+        last_access_time.store(now_time(), std::memory_order_relaxed);
     }
     
     void update_invalid_pointer_error() {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        invalid_pointer_errors++;
-        last_access_time = std::chrono::system_clock::now();
+        const ShardSlot& slot = local_slot();
+        add<size_t>(shards[slot.index].invalid_pointer_errors, 1, slot.exclusive);
+        last_access_time.store(now_time(), std::memory_order_relaxed);
     }
     
     void update_fragmentation(int delta) {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        fragment_count += delta;
-        last_access_time = std::chrono::system_clock::now();
+        fragment_count.fetch_add(delta, std::memory_order_relaxed);
     }
     
     void set_total_memory(size_t size) {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        total_memory = size;
-        free_memory = size;
-        last_access_time = std::chrono::system_clock::now();
+        total_memory.store(size, std::memory_order_relaxed);
+        last_access_time.store(now_time(), std::memory_order_relaxed);
     }
     
-    // 重置和摘要
+    // 重置和摘要。与并发更新同时进行时，个别计数可能保留在重置之前的值
     void reset() {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        
-        total_memory = 0;
-        used_memory = 0;
-        free_memory = 0;
-        allocation_count = 0;
-        deallocation_count = 0;
-        fragment_count = 0;
-        total_alloc_time = std::chrono::nanoseconds(0);
-        total_dealloc_time = std::chrono::nanoseconds(0);
-        max_alloc_time = 0;
-        max_dealloc_time = 0;
-        peak_memory_usage = 0;
-        peak_allocation_count = 0;
-        allocation_failures = 0;
-        deallocation_failures = 0;
-        invalid_pointer_errors = 0;
-        block_size_distribution.clear();
-        
-        creation_time = std::chrono::system_clock::now();
-        last_access_time = creation_time;
+        for (Shard& shard : shards) {
+            shard.allocation_count.store(0, std::memory_order_relaxed);
+            shard.deallocation_count.store(0, std::memory_order_relaxed);
+            shard.allocated_bytes.store(0, std::memory_order_relaxed);
+            shard.deallocated_bytes.store(0, std::memory_order_relaxed);
+            shard.timed_allocations.store(0, std::memory_order_relaxed);
+            shard.timed_deallocations.store(0, std::memory_order_relaxed);
+            shard.total_alloc_time.store(0, std::memory_order_relaxed);
+            shard.total_dealloc_time.store(0, std::memory_order_relaxed);
+            shard.max_alloc_time.store(0, std::memory_order_relaxed);
+            shard.max_dealloc_time.store(0, std::memory_order_relaxed);
+            shard.allocation_failures.store(0, std::memory_order_relaxed);
+            shard.deallocation_failures.store(0, std::memory_order_relaxed);
+            shard.invalid_pointer_errors.store(0, std::memory_order_relaxed);
+            for (auto& bucket : shard.size_histogram) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        
+        for (auto& histogram : latency_histograms) {
+            histogram.reset();
+        }
+        
+        total_memory.store(0, std::memory_order_relaxed);
+        fragment_count.store(0, std::memory_order_relaxed);
+        peak_memory_usage.store(0, std::memory_order_relaxed);
+        large_object_count.store(0, std::memory_order_relaxed);
+        large_object_memory.store(0, std::memory_order_relaxed);
+        large_cache_hits.store(0, std::memory_order_relaxed);
+        large_cache_memory.store(0, std::memory_order_relaxed);
+        
+        creation_time.store(now_time(), std::memory_order_relaxed);
+        last_access_time.store(creation_time.load(std::memory_order_relaxed), std::memory_order_relaxed);
     }
     
     std::string get_summary() const {
-        std::lock_guard<std::mutex> lock(stats_mutex);
-        
         std::ostringstream oss;
         oss << "Memory Pool Statistics:\n";
-        oss << "  Total Memory: " << total_memory << " bytes\n";
-        oss << "  Used Memory: " << used_memory << " bytes (" << get_memory_usage() << "%)\n";
-        oss << "  Free Memory: " << free_memory << " bytes\n";
-        oss << "  Allocations: " << allocation_count << "\n";
-        oss << "  Deallocations: " << deallocation_count << "\n";
-        oss << "  Fragments: " << fragment_count << " (" << get_fragmentation_rate() << "%)\n";
-        oss << "  Allocation Failures: " << allocation_failures << " (" << get_allocation_failure_rate() * 100 << "%)\n";
+        oss << "  Total Memory: " << get_total_memory() << " bytes\n";
+        oss << "  Used Memory: " << get_used_memory() << " bytes (" << get_memory_usage() << "%)\n";
+        oss << "  Free Memory: " << get_free_memory() << " bytes\n";
+        oss << "  Allocations: " << get_allocation_count() << "\n";
+        oss << "  Deallocations: " << get_deallocation_count() << "\n";
+        oss << "  Fragments: " << get_fragment_count() << " (" << get_fragmentation_rate() << "%)\n";
+        oss << "  Large Objects: " << get_large_object_count() << " (" << get_large_object_memory() << " bytes, "
+            << get_large_cache_hits() << " cache hits, " << get_large_cache_memory() << " bytes cached)\n";
+        oss << "  Allocation Failures: " << get_allocation_failures() << " (" << get_allocation_failure_rate() * 100 << "%)\n";
         oss << "  Average Alloc Time: " << get_average_alloc_time() << " ns\n";
         oss << "  Average Dealloc Time: " << get_average_dealloc_time() << " ns\n";
+        oss << "  Alloc Latency p50/p99/p99.9: " << get_latency_percentile(LatencyOp::ALLOCATE, 0.5) << "/"
+            << get_latency_percentile(LatencyOp::ALLOCATE, 0.99) << "/"
+            << get_latency_percentile(LatencyOp::ALLOCATE, 0.999) << " ns\n";
+        oss << "  Dealloc Latency p50/p99/p99.9: " << get_latency_percentile(LatencyOp::DEALLOCATE, 0.5) << "/"
+            << get_latency_percentile(LatencyOp::DEALLOCATE, 0.99) << "/"
+            << get_latency_percentile(LatencyOp::DEALLOCATE, 0.999) << " ns\n";
         oss << "  Uptime: " << get_uptime().count() << " seconds\n";
         
         return oss.str();
     }
 };
 
-// 内存池类
-class MemoryPool {
+// 空统计策略：与PoolStats接口相同，所有更新都是空操作，查询返回0。
+// 用作内存池的StatsPolicy时统计和计时代码在编译期被消除
+class NullPoolStats {
+public:
+    static constexpr bool ENABLED = false;
+    
+    size_t get_total_memory() const { return 0; }
+    size_t get_used_memory() const { return 0; }
+    size_t get_free_memory() const { return 0; }
+    size_t get_allocation_count() const { return 0; }
+    size_t get_deallocation_count() const { return 0; }
+    size_t get_fragment_count() const { return 0; }
+    std::chrono::nanoseconds get_total_alloc_time() const { return std::chrono::nanoseconds(0); }
+    std::chrono::nanoseconds get_total_dealloc_time() const { return std::chrono::nanoseconds(0); }
+    size_t get_max_alloc_time() const { return 0; }
+    size_t get_max_dealloc_time() const { return 0; }
+    double get_average_alloc_time() const { return 0.0; }
+    double get_average_dealloc_time() const { return 0.0; }
+    size_t get_peak_memory_usage() const { return 0; }
+    size_t get_peak_allocation_count() const { return 0; }
+    std::chrono::system_clock::time_point get_creation_time() const { return {}; }
+    std::chrono::system_clock::time_point get_last_access_time() const { return {}; }
+    std::chrono::duration<double> get_uptime() const { return std::chrono::duration<double>(0); }
+    size_t get_allocation_failures() const { return 0; }
+    size_t get_deallocation_failures() const { return 0; }
+    size_t get_invalid_pointer_errors() const { return 0; }
+    double get_allocation_failure_rate() const { return 0.0; }
+    double get_deallocation_failure_rate() const { return 0.0; }
+    const std::map<size_t, size_t> get_block_size_distribution() const { return {}; }
+    double get_memory_usage() const { return 0.0; }
+    double get_fragmentation_rate() const { return 0.0; }
+    uint64_t get_latency_percentile(LatencyOp, double) const { return 0; }
+    size_t get_latency_sample_count(LatencyOp) const { return 0; }
+    size_t get_large_object_count() const { return 0; }
+    size_t get_large_object_memory() const { return 0; }
+    size_t get_large_cache_hits() const { return 0; }
+    size_t get_large_cache_memory() const { return 0; }
+    
+    void update_allocation(size_t, std::chrono::nanoseconds, bool = true) {}
+    void update_deallocation(size_t, std::chrono::nanoseconds, bool = true) {}
+    void update_allocation_batch(size_t, size_t, std::chrono::nanoseconds, std::chrono::nanoseconds, size_t) {}
+    void update_deallocation_batch(size_t, size_t, std::chrono::nanoseconds, std::chrono::nanoseconds, size_t) {}
+    void update_large_allocation(size_t, std::chrono::nanoseconds, bool, bool = true) {}
+    void update_large_deallocation(size_t, std::chrono::nanoseconds, bool = true) {}
+    void set_large_cache_memory(size_t) {}
+    void record_latency(LatencyOp, std::chrono::nanoseconds) {}
+    void update_allocation_failure() {}
+    void update_deallocation_failure() {}
+    void update_invalid_pointer_error() {}
+    void update_fragmentation(int) {}
+    void set_total_memory(size_t) {}
+    void reset() {}
+    void merge(const NullPoolStats&) {}
+    
+    std::string get_summary() const {
+        return "Memory Pool Statistics: disabled\n";
+    }
+};
+
+// 分配轨迹的事件类型
+enum class TraceEventType : uint8_t {
+    ALLOCATE,          // allocate、allocate_bulk
+    ALLOCATE_ZEROED,   // allocate_zeroed
+    DEALLOCATE         // deallocate、deallocate_bulk
+};
+
+// 轨迹文件中的一条事件，定长32字节。记录时object_id是块地址，
+// TraceRecorder::load按时间排序后把它重新编号为每次分配唯一的序号，地址复用不会混淆
+struct TraceEvent {
+    uint64_t timestamp_ns;      // 相对开始记录的时间
+    uint64_t object_id;
+    uint64_t size;              // 请求大小，释放事件为0
+    uint32_t thread_index;      // 记录线程的序号
+    TraceEventType type;
+    uint8_t alignment_log2;     // 对齐要求的以2为底的对数
+    uint16_t reserved;
+};
+static_assert(sizeof(TraceEvent) == 32, "trace file format expects 32-byte events");
+
+// 轨迹文件头，之后紧跟若干TraceEvent
+struct TraceFileHeader {
+    char magic[8];              // "MPTRACE"
+    uint32_t version;
+    uint32_t event_size;
+};
+
+// 分配轨迹记录器：每个线程把事件追加到自己的块中，不加锁也不与其他线程共享缓存行；
+// 写满的块压入无锁栈，由后台写线程落盘。停止时先等待正在追加事件的线程离开，
+// 再把各线程未写满的块一并写出
+class TraceRecorder {
+public:
+    static constexpr size_t CHUNK_EVENTS = 4096;    // 每块128KiB
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    
 private:
-    // 基本配置
-    void* pool_base;                    // 内存池基地址
-    size_t pool_size;                   // 内存池大小
-    size_t min_block_size;              // 最小块大小
-    size_t max_block_size;              // 最大块大小
-    bool thread_safe;                   // 是否启用线程安全
-    double growth_factor;               // 增长因子
-    size_t max_memory_limit;            // 最大内存限制
+    struct Chunk {
+        Chunk* next = nullptr;
+        size_t count = 0;
+        TraceEvent events[CHUNK_EVENTS];
+    };
     
-    // 线程安全机制
-    mutable std::mutex pool_mutex;      // 互斥锁
-    mutable std::mutex stats_mutex;     // 统计信息锁
-    std::vector<std::mutex> free_list_mutexes; // 自由链表锁
-    std::atomic<size_t> atomic_allocation_count{0}; // 原子分配计数器
-    std::atomic<size_t> atomic_deallocation_count{0}; // 原子释放计数器
+    struct alignas(64) ThreadBuffer {
+        std::atomic<bool> busy{false};  // 正在追加事件，stop据此等待
+        Chunk* chunk = nullptr;         // 当前块，只由所属线程访问（stop在线程离开后接管）
+        uint32_t thread_index = 0;
+    };
     
-    // 内存管理
-    FreeList* free_lists;               // 自由链表数组
-    size_t free_list_count;             // 自由链表数量
-    std::vector<MemorySegment> memory_segments; // 内存段列表
+    const uint64_t recorder_id;                 // 进程内唯一，作为线程本地查找表的键
+    std::atomic<bool> recording{false};
+    std::mutex control_mutex;                   // 串行化start和stop
+    std::mutex buffers_mutex;                   // 保护buffers
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; // 记录过事件的线程，记录器析构前不释放
+    std::atomic<Chunk*> full_chunks{nullptr};   // 写满待落盘的块
+    std::FILE* file = nullptr;
+    uint64_t start_ticks = 0;
+    double ns_per_tick = 1.0;
+    std::atomic<size_t> written_events{0};
     
-    // 统计信息
-    mutable PoolStats stats;            // 统计信息
+    std::thread writer_thread;
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    bool writer_stop = false;
     
-    // 错误处理
-    ErrorHandlingStrategy error_strategy; // 错误处理策略
-    std::function<void(const std::string&)> error_logger; // 错误日志回调
+    static uint64_t next_recorder_id() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
     
-    // 锁管理辅助类，确保异常安全
-    class ScopedLock {
-    private:
-        std::mutex& mutex;
-        bool locked;
+    ThreadBuffer& thread_buffer() {
+        thread_local std::vector<std::pair<uint64_t, ThreadBuffer*>> lookup;
         
-    public:
-        explicit ScopedLock(std::mutex& m) : mutex(m), locked(true) {
-            mutex.lock();
+        for (auto& entry : lookup) {
+            if (entry.first == recorder_id) {
+                return *entry.second;
+            }
         }
         
-        ~ScopedLock() {
-            if (locked) {
-                mutex.unlock();
-            }
+        ThreadBuffer* buffer;
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = buffers.back().get();
+            buffer->thread_index = static_cast<uint32_t>(buffers.size() - 1);
         }
         
-        void unlock() {
-            if (locked) {
-                mutex.unlock();
-                locked = false;
-            }
+        // 已析构的记录器留下的表项不会再被命中，只保留最近的若干项
+        if (lookup.size() >= 16) {
+            lookup.erase(lookup.begin());
         }
-    };
+        lookup.emplace_back(recorder_id, buffer);
+        return *buffer;
+    }
+    
+    void publish(Chunk* chunk) {
+        Chunk* head = full_chunks.load(std::memory_order_relaxed);
+        do {
+            chunk->next = head;
+        } while (!full_chunks.compare_exchange_weak(head, chunk, std::memory_order_release,
+                                                    std::memory_order_relaxed));
+    }
+    
+    // 取走所有写满的块，按发布的先后写入文件
+    void drain() {
+        Chunk* chunk = full_chunks.exchange(nullptr, std::memory_order_acquire);
+        Chunk* ordered = nullptr;
+        while (chunk) {
+            Chunk* next = chunk->next;
+            chunk->next = ordered;
+            ordered = chunk;
+            chunk = next;
+        }
+        
+        while (ordered) {
+            Chunk* next = ordered->next;
+            size_t written = std::fwrite(ordered->events, sizeof(TraceEvent), ordered->count, file);
+            written_events.fetch_add(written, std::memory_order_relaxed);
+            delete ordered;
+            ordered = next;
+        }
+    }
+    
+    void writer_loop() {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        while (!writer_stop) {
+            writer_cv.wait_for(lock, std::chrono::milliseconds(10));
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
     
 public:
-    // 构造函数和析构函数
-    MemoryPool(size_t initial_size = 1024 * 1024, 
-               size_t min_blk_size = MIN_BLOCK_SIZE, 
-               size_t max_blk_size = MAX_BLOCK_SIZE, 
-               bool safe = true, 
-               double factor = DEFAULT_GROWTH_FACTOR)
-        : pool_base(nullptr), pool_size(initial_size), 
-          min_block_size(min_blk_size), max_block_size(max_blk_size),
-          thread_safe(safe), growth_factor(factor), max_memory_limit(0),
-          free_lists(nullptr), free_list_count(0),
-          error_strategy(ErrorHandlingStrategy::THROW_EXCEPTION) {
+    TraceRecorder() : recorder_id(next_recorder_id()) {}
+    
+    ~TraceRecorder() {
+        stop();
+    }
+    
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    
+    bool is_recording() const {
+        return recording.load(std::memory_order_relaxed);
+    }
+    
+    // 创建轨迹文件并开始记录；已在记录或文件无法写入时返回false
+    bool start(const std::string& path) {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        if (recording.load(std::memory_order_relaxed)) {
+            return false;
+        }
         
-        // 验证参数
-        if (min_block_size == 0 || (min_block_size & (min_block_size - 1)) != 0) {
-            throw MemoryPoolException("Minimum block size must be a power of 2", ErrorType::INVALID_ALIGNMENT);
+        std::FILE* trace_file = std::fopen(path.c_str(), "wb");
+        if (!trace_file) {
+            return false;
         }
         
-        if (max_block_size < min_block_size || (max_block_size & (max_block_size - 1)) != 0) {
-            throw MemoryPoolException("Maximum block size must be a power of 2 and greater than or equal to minimum block size", ErrorType::INVALID_ALIGNMENT);
+        TraceFileHeader header = {};
+        std::memcpy(header.magic, "MPTRACE", 8);
+        header.version = FORMAT_VERSION;
+        header.event_size = sizeof(TraceEvent);
+        if (std::fwrite(&header, sizeof(header), 1, trace_file) != 1) {
+            std::fclose(trace_file);
+            return false;
         }
         
-        // 计算自由链表数量
-        free_list_count = static_cast<size_t>(log2(max_block_size) - log2(min_block_size)) + 1;
+        file = trace_file;
+        written_events.store(0, std::memory_order_relaxed);
+        ns_per_tick = CycleClock::nanoseconds_per_tick();
+        start_ticks = CycleClock::now();
+        writer_stop = false;
+        writer_thread = std::thread(&TraceRecorder::writer_loop, this);
+        recording.store(true, std::memory_order_seq_cst);
+        return true;
+    }
+    
+    // 停止记录并写出全部事件，返回写入的事件数；未在记录时返回0
+    size_t stop() {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        if (!recording.load(std::memory_order_relaxed)) {
+            return 0;
+        }
         
-        // 创建自由链表数组
-        free_lists = new FreeList[free_list_count];
-        for (size_t i = 0; i < free_list_count; ++i) {
-            size_t block_size = min_block_size << i;
-            free_lists[i] = FreeList(block_size);
+        // 与record中先置busy再读recording的顺序配对：此后看到busy为false的线程不会再写入本次记录
+        recording.store(false, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+            for (auto& buffer : buffers) {
+                while (buffer->busy.load(std::memory_order_seq_cst)) {
+                    std::this_thread::yield();
+                }
+                if (buffer->chunk) {
+                    publish(buffer->chunk);
+                    buffer->chunk = nullptr;
+                }
+            }
         }
         
-        // 初始化自由链表锁
-        if (thread_safe) {
-            free_list_mutexes.resize(free_list_count);
+        {
+            std::lock_guard<std::mutex> writer_lock(writer_mutex);
+            writer_stop = true;
         }
+        writer_cv.notify_one();
+        writer_thread.join();
         
-        // 初始化内存池
-        initialize_pool(initial_size);
+        drain();
+        std::fclose(file);
+        file = nullptr;
+        return written_events.load(std::memory_order_relaxed);
     }
     
-    ~MemoryPool() {
-        // 释放所有内存段
-        release_all_segments();
+    void record(TraceEventType type, const void* ptr, size_t size, size_t alignment) {
+        ThreadBuffer& buffer = thread_buffer();
+        buffer.busy.store(true, std::memory_order_seq_cst);
         
-        // 释放自由链表数组
-        delete[] free_lists;
-    }
-    
-    // 禁用拷贝构造和赋值操作
-    MemoryPool(const MemoryPool&) = delete;
-    MemoryPool& operator=(const MemoryPool&) = delete;
+        if (recording.load(std::memory_order_seq_cst)) {
+            if (!buffer.chunk) {
+                buffer.chunk = new Chunk;
+            }
+            
+            uint64_t ticks = CycleClock::now();
+            TraceEvent& event = buffer.chunk->events[buffer.chunk->count++];
+            event.timestamp_ns = ticks > start_ticks ? static_cast<uint64_t>((ticks - start_ticks) * ns_per_tick) : 0;
+            event.object_id = reinterpret_cast<uintptr_t>(ptr);
+            event.size = size;
+            event.thread_index = buffer.thread_index;
+            event.type = type;
+            event.alignment_log2 = static_cast<uint8_t>(floor_log2(std::max<size_t>(alignment, 1)));
+            event.reserved = 0;
+            
+            if (buffer.chunk->count == CHUNK_EVENTS) {
+                publish(buffer.chunk);
+                buffer.chunk = nullptr;
+            }
+        }
+        
+        buffer.busy.store(false, std::memory_order_release);
+    }
+    
+    // 读取轨迹文件：按时间排序（时间相同时保持文件中的先后，同一线程的事件顺序不变），
+    // 把块地址重新编号为每次分配唯一的序号，线程序号压缩为从0开始的连续值，
+    // 丢弃找不到对应分配的释放事件。文件无法读取或格式不符时返回false
+    static bool load(const std::string& path, std::vector<TraceEvent>& events) {
+        events.clear();
+        
+        std::FILE* trace_file = std::fopen(path.c_str(), "rb");
+        if (!trace_file) {
+            return false;
+        }
+        
+        TraceFileHeader header;
+        bool valid = std::fread(&header, sizeof(header), 1, trace_file) == 1 &&
+                     std::memcmp(header.magic, "MPTRACE", 8) == 0 &&
+                     header.version == FORMAT_VERSION &&
+                     header.event_size == sizeof(TraceEvent);
+        
+        TraceEvent event;
+        while (valid && std::fread(&event, sizeof(event), 1, trace_file) == 1) {
+            events.push_back(event);
+        }
+        std::fclose(trace_file);
+        if (!valid) {
+            return false;
+        }
+        
+        std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.timestamp_ns < b.timestamp_ns;
+        });
+        
+        std::unordered_map<uint64_t, uint64_t> live_ids;     // 块地址到分配序号
+        std::unordered_map<uint32_t, uint32_t> thread_ids;   // 记录时的线程序号到连续序号
+        uint64_t next_id = 0;
+        size_t kept = 0;
+        
+        for (const TraceEvent& current : events) {
+            TraceEvent renumbered = current;
+            if (current.type == TraceEventType::DEALLOCATE) {
+                auto it = live_ids.find(current.object_id);
+                if (it == live_ids.end()) {
+                    continue;
+                }
+                renumbered.object_id = it->second;
+                live_ids.erase(it);
+            } else {
+                renumbered.object_id = next_id++;
+                live_ids[current.object_id] = renumbered.object_id;
+            }
+            
+            auto thread = thread_ids.emplace(current.thread_index, static_cast<uint32_t>(thread_ids.size())).first;
+            renumbered.thread_index = thread->second;
+            events[kept++] = renumbered;
+        }
+        
+        events.resize(kept);
+        return true;
+    }
+};
+
+// 页映射类：以地址的页号为键的三级基数树，回答"指针属于哪个内存段"。
+// 每级12位，加上12位页内偏移覆盖48位地址空间；节点只增不删，
+// 登记内存段由调用者串行化，查询只需几次原子读取，无需加锁
+class PageMap {
+public:
+    static constexpr size_t PAGE_SHIFT = 12;
+    static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_SHIFT;
+    
+private:
+    static constexpr size_t LEVEL_BITS = 12;
+    static constexpr size_t LEVEL_SIZE = size_t(1) << LEVEL_BITS;
+    static constexpr size_t ADDRESS_BITS = PAGE_SHIFT + 3 * LEVEL_BITS;
+    
+    struct Leaf {
+        std::atomic<MemorySegment*> entries[LEVEL_SIZE];
+        
+        Leaf() {
+            for (auto& entry : entries) {
+                entry.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+    
+    struct Interior {
+        std::atomic<Leaf*> children[LEVEL_SIZE];
+        
+        Interior() {
+            for (auto& child : children) {
+                child.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+    };
+    
+    std::atomic<Interior*> root[LEVEL_SIZE];
+    
+public:
+    PageMap() {
+        for (auto& node : root) {
+            node.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+    
+    ~PageMap() {
+        for (auto& node : root) {
+            Interior* interior = node.load(std::memory_order_relaxed);
+            if (!interior) {
+                continue;
+            }
+            for (auto& child : interior->children) {
+                delete child.load(std::memory_order_relaxed);
+            }
+            delete interior;
+        }
+    }
+    
+    // 禁用拷贝构造和赋值操作
+    PageMap(const PageMap&) = delete;
+    PageMap& operator=(const PageMap&) = delete;
+    
+    // 把[base, base + size)覆盖的所有页登记为segment，内存段需按页对齐分配
+    void insert(const void* base, size_t size, MemorySegment* segment) {
+        uintptr_t first_page = reinterpret_cast<uintptr_t>(base) >> PAGE_SHIFT;
+        uintptr_t last_page = (reinterpret_cast<uintptr_t>(base) + size - 1) >> PAGE_SHIFT;
+        
+        for (uintptr_t page = first_page; page <= last_page; ++page) {
+            leaf_for(page, true)->entries[page & (LEVEL_SIZE - 1)].store(segment, std::memory_order_release);
+        }
+    }
+    
+    // 撤销[base, base + size)覆盖的页的登记，节点保留
+    void erase(const void* base, size_t size) {
+        uintptr_t first_page = reinterpret_cast<uintptr_t>(base) >> PAGE_SHIFT;
+        uintptr_t last_page = (reinterpret_cast<uintptr_t>(base) + size - 1) >> PAGE_SHIFT;
+        
+        for (uintptr_t page = first_page; page <= last_page; ++page) {
+            Leaf* leaf = leaf_for(page, false);
+            if (leaf) {
+                leaf->entries[page & (LEVEL_SIZE - 1)].store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+    
+    // 查找指针所属的内存段，不属于任何内存段时返回nullptr
+    MemorySegment* find(const void* ptr) const {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        if (addr >> ADDRESS_BITS) {
+            return nullptr;
+        }
+        
+        Leaf* leaf = const_cast<PageMap*>(this)->leaf_for(addr >> PAGE_SHIFT, false);
+        if (!leaf) {
+            return nullptr;
+        }
+        
+        MemorySegment* segment = leaf->entries[(addr >> PAGE_SHIFT) & (LEVEL_SIZE - 1)].load(std::memory_order_acquire);
+        
+        // 内存段末页超出段大小的部分不属于该段
+        return segment && segment->contains(ptr) ? segment : nullptr;
+    }
+    
+private:
+    Leaf* leaf_for(uintptr_t page, bool create) {
+        size_t root_index = (page >> (2 * LEVEL_BITS)) & (LEVEL_SIZE - 1);
+        size_t interior_index = (page >> LEVEL_BITS) & (LEVEL_SIZE - 1);
+        
+        Interior* interior = root[root_index].load(std::memory_order_acquire);
+        if (!interior) {
+            if (!create) {
+                return nullptr;
+            }
+            interior = new Interior();
+            root[root_index].store(interior, std::memory_order_release);
+        }
+        
+        Leaf* leaf = interior->children[interior_index].load(std::memory_order_acquire);
+        if (!leaf) {
+            if (!create) {
+                return nullptr;
+            }
+            leaf = new Leaf();
+            interior->children[interior_index].store(leaf, std::memory_order_release);
+        }
+        
+        return leaf;
+    }
+};
+
+// 多arena前端的共享段索引：各arena把自己的内存段同时登记到这里，
+// 释放时查到内存段即可由MemorySegment::arena_index找到所属arena。
+// 登记和注销由mutex串行化（各arena持有不同的pool_mutex），查询无锁
+struct ArenaSegmentIndex {
+    PageMap page_map;
+    std::mutex mutex;
+};
+
+// 加锁策略：决定内存池是否加锁以及使用的互斥量类型
+struct NullMutex {
+    void lock() {}
+    void unlock() {}
+};
+
+// 不加锁，只能在单线程中使用
+struct NullLockPolicy {
+    using mutex_type = NullMutex;
+    
+    explicit NullLockPolicy(bool = false) {}
+    static constexpr bool is_thread_safe() { return false; }
+    void set_thread_safe(bool) {}  // 编译期固定，忽略
+};
+
+// 始终加锁
+struct MutexLockPolicy {
+    using mutex_type = std::mutex;
+    
+    explicit MutexLockPolicy(bool = true) {}
+    static constexpr bool is_thread_safe() { return true; }
+    void set_thread_safe(bool) {}  // 编译期固定，忽略
+};
+
+// 运行时通过set_thread_safe切换是否加锁
+struct RuntimeLockPolicy {
+    using mutex_type = std::mutex;
+    bool thread_safe;
+    
+    explicit RuntimeLockPolicy(bool safe = true) : thread_safe(safe) {}
+    bool is_thread_safe() const { return thread_safe; }
+    void set_thread_safe(bool enabled) { thread_safe = enabled; }
+};
+
+// 增长策略：根据当前总大小和本次需要的大小返回新内存段的大小，返回0表示不允许扩展
+struct FactorGrowthPolicy {
+    double growth_factor;
+    
+    explicit FactorGrowthPolicy(double factor = DEFAULT_GROWTH_FACTOR) : growth_factor(factor) {}
+    
+    size_t next_segment_size(size_t current_total, size_t required_size) const {
+        return std::max(static_cast<size_t>(current_total * (growth_factor - 1.0)), required_size);
+    }
+};
+
+// 只使用初始内存段
+struct NoGrowthPolicy {
+    explicit NoGrowthPolicy(double = 0.0) {}
+    static constexpr size_t next_segment_size(size_t, size_t) { return 0; }
+};
+
+// 块大小范围：MinBlock和MaxBlock为编译期常量时，阶数和自由链表下标都在编译期确定
+template<size_t MinBlock, size_t MaxBlock>
+struct PoolGeometry {
+    static_assert(MinBlock != 0 && MaxBlock != 0, "MinBlock and MaxBlock must both be fixed or both be 0");
+    static_assert((MinBlock & (MinBlock - 1)) == 0, "Minimum block size must be a power of 2");
+    static_assert((MaxBlock & (MaxBlock - 1)) == 0 && MaxBlock >= MinBlock,
+                  "Maximum block size must be a power of 2 and greater than or equal to minimum block size");
+    static_assert(MinBlock >= sizeof(MemoryBlockDescriptor), "Minimum block size is too small to hold a free block descriptor");
+    
+    static constexpr size_t min_block_size = MinBlock;
+    static constexpr size_t max_block_size = MaxBlock;
+    static constexpr size_t min_block_shift = floor_log2(MinBlock);
+    static constexpr size_t free_list_count = floor_log2(MaxBlock) - floor_log2(MinBlock) + 1;
+    
+    PoolGeometry(size_t min_blk_size, size_t max_blk_size) {
+        if (min_blk_size != MinBlock || max_blk_size != MaxBlock) {
+            throw MemoryPoolException("Block size arguments differ from the compile-time block sizes", ErrorType::INVALID_ALIGNMENT);
+        }
+    }
+    
+    // 2的幂次方块大小对应的自由链表下标
+    static constexpr size_t block_list_index(size_t block_size) {
+        return floor_log2(block_size) - min_block_shift;
+    }
+};
+
+// MinBlock和MaxBlock为0：块大小范围在构造时指定
+template<>
+struct PoolGeometry<0, 0> {
+    size_t min_block_size;              // 最小块大小
+    size_t max_block_size;              // 最大块大小
+    size_t min_block_shift;             // log2(min_block_size)
+    size_t free_list_count;             // 自由链表数量
+    
+    PoolGeometry(size_t min_blk_size, size_t max_blk_size)
+        : min_block_size(min_blk_size), max_block_size(max_blk_size) {
+        // 验证参数
+        if (min_block_size == 0 || (min_block_size & (min_block_size - 1)) != 0) {
+            throw MemoryPoolException("Minimum block size must be a power of 2", ErrorType::INVALID_ALIGNMENT);
+        }
+        
+        if (max_block_size < min_block_size || (max_block_size & (max_block_size - 1)) != 0) {
+            throw MemoryPoolException("Maximum block size must be a power of 2 and greater than or equal to minimum block size", ErrorType::INVALID_ALIGNMENT);
+        }
+        
+        // 空闲块内需要容纳侵入式描述符
+        if (min_block_size < sizeof(MemoryBlockDescriptor)) {
+            throw MemoryPoolException("Minimum block size is too small to hold a free block descriptor", ErrorType::INVALID_ALIGNMENT);
+        }
+        
+        min_block_shift = floor_log2(min_block_size);
+        free_list_count = floor_log2(max_block_size) - min_block_shift + 1;
+    }
+    
+    size_t block_list_index(size_t block_size) const {
+        return floor_log2(block_size) - min_block_shift;
+    }
+};
+
+// 内存池类模板
+//   LockPolicy   - 加锁策略：NullLockPolicy / MutexLockPolicy / RuntimeLockPolicy
+//   StatsPolicy  - 统计策略：PoolStats / NullPoolStats
+//   GrowthPolicy - 增长策略：FactorGrowthPolicy / NoGrowthPolicy
+//   MinBlock, MaxBlock - 编译期块大小范围，均为0时在构造时指定
+//   FreeListPolicy - 自由链表同步策略：MutexFreeListPolicy / LockFreeFreeListPolicy。
+//                    内存池只在pool_mutex下操作自由链表，无锁策略只省去链表内部的加锁
+// 空策略对应的加锁、计时和统计代码在编译期被消除
+template<typename LockPolicy = RuntimeLockPolicy,
+         typename StatsPolicy = PoolStats,
+         typename GrowthPolicy = FactorGrowthPolicy,
+         size_t MinBlock = 0, size_t MaxBlock = 0,
+         typename FreeListPolicy = MutexFreeListPolicy>
+class BasicMemoryPool : private PoolGeometry<MinBlock, MaxBlock> {
+private:
+    using Geometry = PoolGeometry<MinBlock, MaxBlock>;
+    using mutex_type = typename LockPolicy::mutex_type;
+    using FreeList = BasicFreeList<FreeListPolicy>;
+    
+    using Geometry::min_block_size;
+    using Geometry::max_block_size;
+    using Geometry::min_block_shift;
+    using Geometry::free_list_count;
+    using Geometry::block_list_index;
+    
+    // 基本配置
+    void* pool_base;                    // 内存池基地址
+    size_t pool_size;                   // 内存池大小
+    LockPolicy lock_policy;             // 加锁策略
+    GrowthPolicy growth_policy;         // 增长策略
+    size_t max_memory_limit;            // 最大内存限制
+    
+    // 线程安全机制
+    mutable mutex_type pool_mutex;      // 互斥锁
+    mutable mutex_type stats_mutex;     // 统计信息锁
+    std::vector<std::mutex> free_list_mutexes; // 自由链表锁
+    std::atomic<size_t> atomic_allocation_count{0}; // 原子分配计数器
+    std::atomic<size_t> atomic_deallocation_count{0}; // 原子释放计数器
+    
+    // 内存管理
+    FreeList* free_lists;               // 自由链表数组
+    std::deque<MemorySegment> memory_segments; // 内存段列表（deque保证扩展时已有元素地址不变）
+    PageMap page_map;                   // 指针到内存段的页映射
+    ArenaSegmentIndex* arena_segments = nullptr; // 作为arena时共享的段索引
+    size_t arena_index = 0;             // 作为arena时的序号
+    
+    // 小对象slab：每个slab占一个伙伴块，切分成同一大小类的定长对象
+    struct SlabClass {
+        size_t object_size = 0;         // 对象大小
+        size_t object_count = 0;        // 每个slab的对象数量
+        size_t first_object_offset = 0; // 第一个对象相对slab起始的偏移
+        uint64_t index_multiplier = 0;  // floor(2^32/object_size)+1，slab内偏移乘以它再右移32位即为对象序号
+        SlabHeader* partial = nullptr;  // 仍有空闲对象的slab链表
+    };
+    std::vector<SlabClass> slab_classes;    // slab大小类，按对象大小升序
+    std::vector<uint8_t> slab_class_lookup; // 大小/SLAB_OBJECT_ALIGNMENT（向上取整）到大小类序号
+    size_t slab_block_size;             // slab块大小
+    size_t slab_list_index;             // slab块对应的自由链表索引
+    size_t slab_max_object_size;        // 由slab分配的最大对象大小，0表示不使用slab
+    std::vector<size_t> size_class_sizes; // 线程缓存大小类：先是slab大小类，再是更大的伙伴块
+    size_t first_buddy_class_index;     // 线程缓存中第一个伙伴块大小类对应的自由链表索引
+    
+    // 大对象层：超过max_block_size的请求直接由页对齐的mmap提供
+    struct LargeSpan {
+        void* base = nullptr;
+        size_t size = 0;                // 映射长度，页大小的整数倍
+        uint64_t freed_at = 0;          // 进入span缓存的时间
+    };
+    mutable mutex_type large_mutex;     // 保护大对象索引和span缓存
+    std::unordered_map<void*, size_t> large_objects; // 存活大对象：起始地址到映射长度
+    std::vector<LargeSpan> large_span_cache; // 最近释放的span，按释放先后排列
+    size_t large_span_cache_bytes;      // span缓存中的字节数
+    size_t large_span_cache_limit;      // span缓存的字节上限，0表示释放时立即解除映射
+    
+    // 线程本地缓存
+    struct ThreadCacheRegistry;
+    std::atomic<bool> thread_cache_enabled{false}; // 是否启用线程本地缓存
+    size_t thread_cache_max_block_size; // 可缓存的最大块大小
+    size_t thread_cache_max_bytes;      // 每个线程缓存的最大字节数
+    std::atomic<size_t> cache_epoch{0}; // 缓存纪元，reset后递增使各线程缓存失效
+    std::shared_ptr<ThreadCacheRegistry> cache_registry; // 线程缓存与内存池的生命周期纽带
+    
+    // 后台回收
+    std::thread scavenger_thread;       // 回收线程
+    std::mutex scavenger_mutex;         // 保护回收配置和停止标志
+    std::condition_variable scavenger_cv; // 通知回收线程退出
+    bool scavenger_stop = false;        // 回收线程退出标志
+    ScavengerConfig scavenger_config;   // 回收配置
+    std::mutex scavenge_mutex;          // 串行化回收轮次与reset，先于pool_mutex获取
+    std::atomic<size_t> scavenger_passes{0};    // 回收轮数
+    std::atomic<size_t> scavenged_bytes{0};     // 通过madvise归还的字节数
+    std::atomic<size_t> unmapped_bytes{0};      // 解除映射的字节数
+    std::atomic<size_t> unmapped_segments{0};   // 解除映射的内存段数量
+    
+    // 分配轨迹
+    TraceRecorder trace_recorder;       // 未开启记录时每次操作只多一次relaxed读
+    
+    // 可重定位分配：句柄表整体预留在按需清零的数组中，槽位地址固定，pin无锁查找槽位。
+    // 槽位全零即为空闲初值；空闲链表、size和代数只在pool_mutex下修改
+    static constexpr uint32_t HANDLE_MOVING = UINT32_MAX; // pins的特殊值：压缩器正在搬移该块
+    static constexpr uint32_t HANDLE_FREED = UINT32_MAX - 1; // pins的特殊值：free_handle已认领该槽位
+    struct HandleSlot {
+        std::atomic<void*> ptr;             // 块的当前地址，nullptr表示槽位空闲
+        std::atomic<uint32_t> pins;         // 固定次数
+        std::atomic<uint32_t> generation;   // 槽位每次释放后加一，使旧句柄失效
+        size_t size;                        // 请求大小，搬移时只复制这么多字节
+        size_t next_free;                   // 空闲槽位链表中下一个槽位的序号加一，0表示链表结束
+    };
+    ZeroedArray<HandleSlot> handle_slots; // 首次分配句柄时预留
+    size_t handle_slot_count = 0;       // 用过的槽位数（高水位）
+    size_t handle_free_head = 0;        // 空闲槽位链表头，序号加一
+    size_t compaction_cursor = 0;       // 压缩器下一次检查的槽位
+    MemorySegment* compaction_victim = nullptr; // 正在搬空的内存段
+    size_t untouched_segment = 0;       // 第一个可能还有未切分部分的内存段
+    size_t compaction_idle_scanned = 0; // 自上次搬移以来检查过的槽位数
+    std::atomic<size_t> compaction_steps{0};            // 压缩步数
+    std::atomic<size_t> compacted_blocks{0};            // 搬移的块数
+    std::atomic<size_t> compacted_bytes{0};             // 搬移的块字节数
+    std::atomic<size_t> compaction_released_segments{0}; // 压缩后解除映射的内存段数
+    std::atomic<size_t> compaction_released_bytes{0};   // 压缩后解除映射的字节数
+    std::atomic<int64_t> compaction_max_pause_ns{0};    // 单步持锁时长的最大值
+    
+    // 统计信息
+    mutable StatsPolicy stats;          // 统计信息
+    std::atomic<size_t> timing_sample_rate{DEFAULT_TIMING_SAMPLE_RATE}; // 每多少次操作计时一次，0表示不计时
+    
+    // 错误处理
+    ErrorHandlingStrategy error_strategy; // 错误处理策略
+    std::function<void(const std::string&)> error_logger; // 错误日志回调
+    
+    // 锁管理辅助类，确保异常安全
+    class ScopedLock {
+    private:
+        mutex_type& mutex;
+        bool locked;
+        
+    public:
+        explicit ScopedLock(mutex_type& m) : mutex(m), locked(true) {
+            mutex.lock();
+        }
+        
+        ~ScopedLock() {
+            if (locked) {
+                mutex.unlock();
+            }
+        }
+        
+        void unlock() {
+            if (locked) {
+                mutex.unlock();
+                locked = false;
+            }
+        }
+    };
+    
+    // 线程缓存注册信息：线程缓存通过shared_ptr持有它，
+    // 内存池析构时置空pool，线程退出时据此判断是否还能归还缓存的块
+    struct ThreadCacheRegistry {
+        std::mutex mutex;
+        BasicMemoryPool* pool;
+        
+        explicit ThreadCacheRegistry(BasicMemoryPool* owner) : pool(owner) {}
+    };
+    
+    // 线程本地缓存：每个大小类（slab大小类和伙伴块阶数）一个侵入式单链表（next指针存放在空闲块自身中），
+    // 释放的指针先暂存在本地，满一批后在一次加锁内解析大小并归入对应的大小类
+    class ThreadCache {
+    public:
+        struct Bin {
+            void* head = nullptr;          // 缓存块链表头
+            size_t count = 0;              // 缓存块数量
+            size_t capacity = 0;           // 最大缓存块数量
+            size_t batch = 0;              // 批量填充/归还的块数
+            size_t pending_allocs = 0;     // 尚未合并到PoolStats的分配次数
+            size_t pending_timed_allocs = 0; // 其中被采样计时的次数
+            std::chrono::nanoseconds pending_alloc_time{0};
+            std::chrono::nanoseconds pending_alloc_max{0};
+        };
+        
+        std::shared_ptr<ThreadCacheRegistry> registry;
+        std::vector<Bin> bins;
+        void* pending_frees[THREAD_CACHE_FREE_BATCH];
+        size_t pending_free_count = 0;
+        size_t pending_timed_frees = 0;
+        std::chrono::nanoseconds pending_dealloc_time{0};
+        std::chrono::nanoseconds pending_dealloc_max{0};
+        size_t cached_bytes = 0;
+        size_t epoch = 0;
+        
+        ThreadCache(std::shared_ptr<ThreadCacheRegistry> reg, const std::vector<size_t>& class_sizes, size_t current_epoch)
+            : registry(std::move(reg)), bins(class_sizes.size()), epoch(current_epoch) {
+            for (size_t i = 0; i < class_sizes.size(); ++i) {
+                size_t block_size = class_sizes[i];
+                bins[i].capacity = std::max<size_t>(2, std::min(THREAD_CACHE_MAX_BIN_COUNT, THREAD_CACHE_BIN_BYTES / block_size));
+                bins[i].batch = std::max<size_t>(1, bins[i].capacity / 2);
+            }
+        }
+        
+        // 线程退出时把缓存的块归还给内存池
+        ~ThreadCache() {
+            std::lock_guard<std::mutex> lock(registry->mutex);
+            if (registry->pool) {
+                try {
+                    registry->pool->release_thread_cache(*this);
+                } catch (...) {
+                    // 析构函数中不能抛出异常，归还失败的块随内存段一起释放
+                }
+            }
+        }
+        
+        ThreadCache(const ThreadCache&) = delete;
+        ThreadCache& operator=(const ThreadCache&) = delete;
+        
+        void* pop(size_t index) {
+            Bin& bin = bins[index];
+            void* block = bin.head;
+            if (block) {
+                bin.head = *static_cast<void**>(block);
+                bin.count--;
+            }
+            return block;
+        }
+        
+        void push(size_t index, void* block, size_t block_size) {
+            Bin& bin = bins[index];
+            *static_cast<void**>(block) = bin.head;
+            bin.head = block;
+            bin.count++;
+            cached_bytes += block_size;
+        }
+        
+        // 丢弃所有缓存内容（内存池reset后这些块已经重新属于自由链表）
+        void discard(size_t current_epoch) {
+            for (auto& bin : bins) {
+                bin.head = nullptr;
+                bin.count = 0;
+                bin.pending_allocs = 0;
+                bin.pending_timed_allocs = 0;
+                bin.pending_alloc_time = std::chrono::nanoseconds(0);
+                bin.pending_alloc_max = std::chrono::nanoseconds(0);
+            }
+            pending_free_count = 0;
+            pending_timed_frees = 0;
+            pending_dealloc_time = std::chrono::nanoseconds(0);
+            pending_dealloc_max = std::chrono::nanoseconds(0);
+            cached_bytes = 0;
+            epoch = current_epoch;
+        }
+    };
+    
+public:
+    // 构造函数和析构函数
+    BasicMemoryPool(size_t initial_size = 1024 * 1024, 
+                    size_t min_blk_size = MinBlock ? MinBlock : MIN_BLOCK_SIZE, 
+                    size_t max_blk_size = MaxBlock ? MaxBlock : MAX_BLOCK_SIZE, 
+                    bool safe = true, 
+                    double factor = DEFAULT_GROWTH_FACTOR)
+        : Geometry(min_blk_size, max_blk_size),
+          pool_base(nullptr), pool_size(initial_size), 
+          lock_policy(safe), growth_policy(factor), max_memory_limit(0),
+          free_lists(nullptr),
+          slab_block_size(0), slab_list_index(0), slab_max_object_size(0), first_buddy_class_index(0),
+          large_span_cache_bytes(0), large_span_cache_limit(LARGE_SPAN_CACHE_BYTES),
+          thread_cache_max_block_size(std::min(THREAD_CACHE_MAX_BLOCK_SIZE, max_blk_size)),
+          thread_cache_max_bytes(THREAD_CACHE_MAX_BYTES),
+          cache_registry(std::make_shared<ThreadCacheRegistry>(this)),
+          error_strategy(ErrorHandlingStrategy::THROW_EXCEPTION) {
+        
+        // 创建自由链表数组
+        free_lists = new FreeList[free_list_count];
+        for (size_t i = 0; i < free_list_count; ++i) {
+            size_t block_size = min_block_size << i;
+            free_lists[i].set_block_size(block_size);
+        }
+        
+        // 初始化自由链表锁
+        if (is_thread_safe()) {
+            free_list_mutexes = std::vector<std::mutex>(free_list_count);
+        }
+        
+        // 划分slab大小类和线程缓存大小类
+        initialize_size_classes();
+        
+        // 在构造时完成TSC校准，避免第一次被采样的操作承担校准时间
+        if constexpr (StatsPolicy::ENABLED) {
+            CycleClock::nanoseconds_per_tick();
+        }
+        
+        // 初始化内存池
+        initialize_pool(initial_size);
+    }
+    
+    ~BasicMemoryPool() {
+        stop_scavenger();
+        stop_trace();
+        
+        // 断开线程缓存，之后退出的线程不再向本内存池归还块
+        {
+            std::lock_guard<std::mutex> lock(cache_registry->mutex);
+            cache_registry->pool = nullptr;
+        }
+        
+        // 释放所有内存段和大对象
+        release_all_segments();
+        release_large_objects();
+        
+        // 释放自由链表数组
+        delete[] free_lists;
+    }
+    
+    // 禁用拷贝构造和赋值操作
+    BasicMemoryPool(const BasicMemoryPool&) = delete;
+    BasicMemoryPool& operator=(const BasicMemoryPool&) = delete;
     
     // 内存分配和释放
     void* allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
-        if (size == 0) {
-            return nullptr;
+        void* result = allocate_block(size, alignment);
+        if (result && trace_recorder.is_recording()) {
+            trace_recorder.record(TraceEventType::ALLOCATE, result, size, alignment);
+        }
+        return result;
+    }
+    
+    template<typename T>
+    T* allocate_type(size_t count = 1) {
+        size_t size = sizeof(T) * count;
+        size_t alignment = alignof(T);
+        return static_cast<T*>(allocate(size, alignment));
+    }
+    
+    // 分配并清零。内存段来自匿名mmap，从未被释放过块的页仍由内核按需清零，
+    // 只需清零块头部（空闲时存放链表指针）和被使用过的页
+    void* allocate_zeroed(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        void* ptr;
+        if (size > max_block_size) {
+            ptr = allocate_large(size, alignment, true);
+        } else {
+            ptr = allocate_block(size, alignment);
+            if (ptr) {
+                zero_fill(ptr, size);
+            }
+        }
+        
+        if (ptr && trace_recorder.is_recording()) {
+            trace_recorder.record(TraceEventType::ALLOCATE_ZEROED, ptr, size, alignment);
+        }
+        return ptr;
+    }
+    
+    void deallocate(void* ptr) {
+        if (!ptr) {
+            return;
+        }
+        
+        // 在块可能被复用之前登记，保证轨迹中释放事件早于同一地址的下一次分配
+        if (trace_recorder.is_recording()) {
+            trace_recorder.record(TraceEventType::DEALLOCATE, ptr, 0, 0);
+        }
+        
+        // 不属于任何内存段的指针交给大对象层，无效指针也在那里报错
+        MemorySegment* segment = find_segment(ptr);
+        if (!segment) {
+            deallocate_large(ptr);
+            return;
+        }
+        
+        if (is_thread_safe() && thread_cache_enabled.load(std::memory_order_relaxed)) {
+            deallocate_cached(*segment, ptr);
+            return;
+        }
+        
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            
+            try {
+                size_t size = deallocate_from_pool(ptr);
+                
+                // 使用原子操作更新计数器
+                atomic_deallocation_count.fetch_add(1, std::memory_order_relaxed);
+                
+                auto duration = finish_timing(timer);
+                
+                // 更新统计信息
+                stats.update_deallocation(size, duration, timer.sampled());
+                
+            } catch (...) {
+                // 确保异常情况下锁能正确释放
+                stats.update_deallocation_failure();
+                handle_error("Memory deallocation failed", ErrorType::INVALID_POINTER);
+                throw;
+            }
+        } else {
+            // 单线程模式，无需加锁
+            try {
+                size_t size = deallocate_from_pool(ptr);
+                
+                auto duration = finish_timing(timer);
+                
+                // 更新统计信息
+                stats.update_deallocation(size, duration, timer.sampled());
+                
+            } catch (...) {
+                stats.update_deallocation_failure();
+                handle_error("Memory deallocation failed", ErrorType::INVALID_POINTER);
+                throw;
+            }
+        }
+    }
+    
+    void* safe_allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        try {
+            return allocate(size, alignment);
+        } catch (const MemoryPoolException&) {
+            return nullptr;
+        }
+    }
+    
+    bool safe_deallocate(void* ptr) {
+        try {
+            deallocate(ptr);
+            return true;
+        } catch (const MemoryPoolException&) {
+            return false;
+        }
+    }
+    
+    // 批量分配count个大小相同的块写入out。整个批次只加一次锁、只读两次时钟、
+    // 只更新一次统计，不经过线程缓存；任何一个块分配失败时已取得的块全部归还并抛出异常
+    void allocate_bulk(size_t size, size_t count, void** out, size_t alignment = DEFAULT_ALIGNMENT) {
+        if (count == 0) {
+            return;
+        }
+        
+        if (size == 0) {
+            std::fill(out, out + count, nullptr);
+            return;
+        }
+        
+        // 大对象逐个映射，批量接口没有额外收益
+        if (size > max_block_size) {
+            for (size_t i = 0; i < count; ++i) {
+                try {
+                    out[i] = allocate_large(size, alignment, false);
+                } catch (...) {
+                    for (size_t j = 0; j < i; ++j) {
+                        deallocate_large(out[j]);
+                    }
+                    throw;
+                }
+            }
+            trace_allocations(out, count, size, alignment);
+            return;
+        }
+        
+        Timer timer = timing_start(LatencyOp::ALLOCATE);
+        size_t block_size = calculate_block_size(size, alignment);
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            allocate_bulk_from_pool(block_size, count, out);
+            atomic_allocation_count.fetch_add(count, std::memory_order_relaxed);
+        } else {
+            allocate_bulk_from_pool(block_size, count, out);
+        }
+        
+        auto duration = timing_elapsed(timer);
+        stats.update_allocation_batch(block_size, count, duration, duration / count, timer.sampled() ? count : 0);
+        trace_allocations(out, count, size, alignment);
+    }
+    
+    // 批量释放，整个批次只加一次锁、只更新一次统计。无效指针和重复释放被跳过，
+    // 其余指针照常释放后再统一报错；nullptr忽略
+    void deallocate_bulk(void** ptrs, size_t count) {
+        if (trace_recorder.is_recording()) {
+            for (size_t i = 0; i < count; ++i) {
+                if (ptrs[i]) {
+                    trace_recorder.record(TraceEventType::DEALLOCATE, ptrs[i], 0, 0);
+                }
+            }
+        }
+        
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        
+        size_t freed_bytes = 0;
+        size_t freed_count = 0;
+        size_t invalid_count = 0;
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            deallocate_bulk_to_pool(ptrs, count, freed_bytes, freed_count, invalid_count);
+            atomic_deallocation_count.fetch_add(freed_count, std::memory_order_relaxed);
+        } else {
+            deallocate_bulk_to_pool(ptrs, count, freed_bytes, freed_count, invalid_count);
+        }
+        
+        auto duration = timing_elapsed(timer);
+        if (freed_count > 0) {
+            stats.update_deallocation_batch(freed_bytes, freed_count, duration, duration / freed_count,
+                                            timer.sampled() ? freed_count : 0);
+        }
+        
+        // 不属于任何内存段的指针逐个交给大对象层
+        for (size_t i = 0; i < count; ++i) {
+            if (ptrs[i] && !find_segment(ptrs[i])) {
+                try {
+                    deallocate_large(ptrs[i]);
+                } catch (const MemoryPoolException&) {
+                    invalid_count++;
+                }
+            }
+        }
+        
+        if (invalid_count > 0) {
+            handle_error("Invalid pointer passed to deallocate_bulk", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to deallocate_bulk", ErrorType::INVALID_POINTER);
+        }
+    }
+
+    // 延迟释放：在调用线程上无锁地把块标记为已释放，之后由release_deferred批量归还。
+    // 无效指针和重复释放（包括块已标记但尚未归还时）在这里当场报错。只接受内存段中的块
+    void defer_deallocate(void* ptr) {
+        if (trace_recorder.is_recording()) {
+            trace_recorder.record(TraceEventType::DEALLOCATE, ptr, 0, 0);
+        }
+
+        MemorySegment* segment = find_segment(ptr);
+        if (!segment || mark_deferred_free(*segment, ptr) == 0) {
+            stats.update_invalid_pointer_error();
+            stats.update_deallocation_failure();
+            handle_error("Invalid pointer passed to defer_deallocate", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to defer_deallocate", ErrorType::INVALID_POINTER);
+        }
+    }
+
+    // 归还defer_deallocate标记过的块，整个批次只加一次锁、只更新一次统计
+    void release_deferred(void** ptrs, size_t count) {
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        size_t freed_bytes = 0;
+
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            for (size_t i = 0; i < count; ++i) {
+                freed_bytes += deallocate_from_pool(ptrs[i], true);
+            }
+            atomic_deallocation_count.fetch_add(count, std::memory_order_relaxed);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                freed_bytes += deallocate_from_pool(ptrs[i], true);
+            }
+        }
+
+        auto duration = timing_elapsed(timer);
+        if (count > 0) {
+            stats.update_deallocation_batch(freed_bytes, count, duration, duration / count,
+                                            timer.sampled() ? count : 0);
+        }
+    }
+
+    // 内存池管理
+    void reset() {
+        // 等待进行中的回收轮次结束，避免其摘下的块在reset后被重新分配时又被madvise
+        std::lock_guard<std::mutex> pass_lock(scavenge_mutex);
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            reset_pool();
+        } else {
+            reset_pool();
+        }
+        
+        // 各线程缓存中的块已经回到自由链表，使其失效
+        cache_epoch.fetch_add(1, std::memory_order_release);
+        
+        release_large_objects();
+    }
+    
+    // 通过页映射查询，无需加锁
+    bool is_valid_pointer(void* ptr) const {
+        if (!ptr) {
+            return false;
+        }
+        
+        return is_valid_pointer_internal(ptr);
+    }
+    
+    // 返回已分配块的实际大小；ptr不是某个存活分配的起始地址时返回0。
+    // 页映射和阶数表都可以无锁读取
+    size_t get_block_size(void* ptr) const {
+        if (!ptr) {
+            return 0;
+        }
+        
+        return get_block_size_internal(ptr);
+    }
+    
+    // 超过该大小的请求由大对象层提供
+    size_t get_max_block_size() const {
+        return max_block_size;
+    }
+    
+    // 线程安全控制
+    // 加锁策略在编译期固定时忽略
+    void set_thread_safe(bool enabled) {
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            lock_policy.set_thread_safe(enabled);
+        } else {
+            lock_policy.set_thread_safe(enabled);
+        }
+    }
+    
+    bool is_thread_safe() const {
+        return lock_policy.is_thread_safe();
+    }
+    
+    // 线程本地缓存控制：仅在线程安全模式下生效。
+    // 关闭后各线程已缓存的块保留到线程退出时归还
+    void set_thread_cache_enabled(bool enabled) {
+        ScopedLock pool_lock(pool_mutex);
+        thread_cache_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    
+    bool is_thread_cache_enabled() const {
+        return thread_cache_enabled.load(std::memory_order_relaxed);
+    }
+    
+    void set_thread_cache_limits(size_t max_cached_block_size, size_t max_bytes_per_thread) {
+        ScopedLock pool_lock(pool_mutex);
+        thread_cache_max_block_size = std::min(max_cached_block_size, max_block_size);
+        thread_cache_max_bytes = max_bytes_per_thread;
+    }
+    
+    // 大对象span缓存的字节上限，0表示释放时立即解除映射
+    void set_large_span_cache_limit(size_t max_bytes) {
+        std::vector<LargeSpan> evicted;
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            large_span_cache_limit = max_bytes;
+            trim_large_span_cache(evicted);
+        } else {
+            large_span_cache_limit = max_bytes;
+            trim_large_span_cache(evicted);
+        }
+        
+        for (const LargeSpan& span : evicted) {
+            deallocate_system_memory(span.base, span.size);
+        }
+    }
+    
+    // 后台回收：定期把空闲超过阈值的最大块通过madvise归还给操作系统，并解除映射
+    // 完全空闲的内存段。回收线程只在线程安全模式下可用，单线程模式可以自行调用scavenge()
+    void start_scavenger(const ScavengerConfig& config = ScavengerConfig()) {
+        if (!is_thread_safe()) {
+            handle_error("Scavenger thread requires a thread-safe pool", ErrorType::UNKNOWN_ERROR);
+            throw MemoryPoolException("Scavenger thread requires a thread-safe pool", ErrorType::UNKNOWN_ERROR);
+        }
+        
+        stop_scavenger();
+        {
+            std::lock_guard<std::mutex> lock(scavenger_mutex);
+            scavenger_config = config;
+            scavenger_stop = false;
+        }
+        scavenger_thread = std::thread([this]() { scavenger_loop(); });
+    }
+    
+    void stop_scavenger() {
+        if (!scavenger_thread.joinable()) {
+            return;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(scavenger_mutex);
+            scavenger_stop = true;
+        }
+        scavenger_cv.notify_all();
+        scavenger_thread.join();
+    }
+    
+    bool is_scavenger_running() const {
+        return scavenger_thread.joinable();
+    }
+    
+    void set_scavenger_config(const ScavengerConfig& config) {
+        std::lock_guard<std::mutex> lock(scavenger_mutex);
+        scavenger_config = config;
+    }
+    
+    // 立即执行一轮回收，返回本轮归还给操作系统的字节数。
+    // 每次持锁最多摘取batch_size个块或一个内存段，madvise和munmap在锁外进行
+    size_t scavenge() {
+        std::lock_guard<std::mutex> pass_lock(scavenge_mutex);
+        
+        ScavengerConfig config;
+        {
+            std::lock_guard<std::mutex> lock(scavenger_mutex);
+            config = scavenger_config;
+        }
+        
+        uint64_t now = now_ticks();
+        uint64_t threshold = std::chrono::duration_cast<std::chrono::nanoseconds>(config.idle_threshold).count();
+        uint64_t cutoff = now > threshold ? now - threshold : 0;
+        
+#ifdef MADV_FREE
+        int advice = config.use_madv_free ? MADV_FREE : MADV_DONTNEED;
+#else
+        int advice = MADV_DONTNEED;
+#endif
+        
+        size_t returned = release_idle_large_spans(cutoff);
+        size_t segment_index = 0;
+        size_t block_index = 0;
+        bool done = false;
+        
+        while (!done) {
+            ScavengeBatch batch;
+            if (is_thread_safe()) {
+                ScopedLock pool_lock(pool_mutex);
+                done = collect_scavenge_batch(config, cutoff, segment_index, block_index, batch);
+            } else {
+                done = collect_scavenge_batch(config, cutoff, segment_index, block_index, batch);
+            }
+            
+            // 系统调用在锁外进行
+            for (void* block : batch.blocks) {
+                madvise(block, max_block_size, advice);
+            }
+            returned += batch.blocks.size() * max_block_size;
+            scavenged_bytes.fetch_add(batch.blocks.size() * max_block_size, std::memory_order_relaxed);
+            
+            if (batch.retired.base) {
+                deallocate_system_memory(batch.retired.base, batch.retired.size);
+                returned += batch.retired.size;
+                unmapped_bytes.fetch_add(batch.retired.size, std::memory_order_relaxed);
+                unmapped_segments.fetch_add(1, std::memory_order_relaxed);
+            }
+            
+            if (!batch.blocks.empty()) {
+                if (is_thread_safe()) {
+                    ScopedLock pool_lock(pool_mutex);
+                    restore_scavenged_blocks(batch, advice == MADV_DONTNEED);
+                } else {
+                    restore_scavenged_blocks(batch, advice == MADV_DONTNEED);
+                }
+            }
+        }
+        
+        scavenger_passes.fetch_add(1, std::memory_order_relaxed);
+        return returned;
+    }
+    
+    ScavengerStats get_scavenger_stats() const {
+        ScavengerStats result;
+        result.passes = scavenger_passes.load(std::memory_order_relaxed);
+        result.released_bytes = scavenged_bytes.load(std::memory_order_relaxed);
+        result.unmapped_bytes = unmapped_bytes.load(std::memory_order_relaxed);
+        result.unmapped_segments = unmapped_segments.load(std::memory_order_relaxed);
+        return result;
+    }
+    
+    // 分配轨迹：把之后的分配和释放事件（大小、对齐、线程、时间、对象）写入path，
+    // 供mpool_replay离线回放。reset释放的块不产生释放事件
+    void start_trace(const std::string& path) {
+        if (!trace_recorder.start(path)) {
+            handle_error("Failed to start allocation trace: " + path, ErrorType::UNKNOWN_ERROR);
+            throw MemoryPoolException("Failed to start allocation trace: " + path, ErrorType::UNKNOWN_ERROR);
+        }
+    }
+    
+    // 停止记录并落盘，返回写入的事件数
+    size_t stop_trace() {
+        return trace_recorder.stop();
+    }
+    
+    bool is_tracing() const {
+        return trace_recorder.is_recording();
+    }
+    
+    // 可重定位分配：返回句柄而不是指针，访问前用pin取得块的当前地址，用完后尽快unpin。
+    // 未被固定的块可能被compact_step搬到别处，之前取得的地址随之失效。句柄块直接取自
+    // 伙伴系统（不经过slab和线程缓存，也不记入分配轨迹），只能用free_handle释放
+    MemoryHandle allocate_handle(size_t size) {
+        if (size == 0 || size > max_block_size) {
+            handle_error("Handle allocation size out of range", ErrorType::OUT_OF_MEMORY);
+            throw MemoryPoolException("Handle allocation size out of range", ErrorType::OUT_OF_MEMORY);
+        }
+        
+        size_t block_size = min_block_size;
+        while (block_size < size) {
+            block_size <<= 1;
+        }
+        
+        Timer timer = timing_start(LatencyOp::ALLOCATE);
+        
+        try {
+            if (is_thread_safe()) {
+                ScopedLock pool_lock(pool_mutex);
+                return allocate_handle_locked(size, block_size, timer);
+            } else {
+                return allocate_handle_locked(size, block_size, timer);
+            }
+        } catch (...) {
+            stats.update_allocation_failure();
+            handle_error("Handle allocation failed", ErrorType::OUT_OF_MEMORY);
+            throw;
+        }
+    }
+    
+    // 释放句柄，被固定的句柄不能释放
+    void free_handle(MemoryHandle handle) {
+        if (handle == 0) {
+            return;
+        }
+        
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            free_handle_locked(handle, timer);
+        } else {
+            free_handle_locked(handle, timer);
+        }
+    }
+    
+    // 固定句柄并返回块的当前地址，固定期间块不会被搬移。可以在多个线程中同时固定，
+    // 不需要获取pool_mutex；压缩器正在搬移该块时等待搬移完成
+    void* pin(MemoryHandle handle) {
+        HandleSlot* slot = find_handle_slot(handle);
+        if (!slot) {
+            handle_error("Invalid handle passed to pin", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid handle passed to pin", ErrorType::INVALID_POINTER);
+        }
+        
+        uint32_t pins = slot->pins.load(std::memory_order_relaxed);
+        while (true) {
+            if (pins == HANDLE_MOVING) {
+                std::this_thread::yield();
+                pins = slot->pins.load(std::memory_order_relaxed);
+            } else if (pins == HANDLE_FREED) {
+                handle_error("Handle passed to pin is being freed", ErrorType::INVALID_POINTER);
+                throw MemoryPoolException("Handle passed to pin is being freed", ErrorType::INVALID_POINTER);
+            } else if (slot->pins.compare_exchange_weak(pins, pins + 1, std::memory_order_acquire,
+                                                        std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        
+        // 查找槽位之后句柄可能已被释放、槽位被新句柄复用。释放时先递增代数再放开pins，
+        // CAS的acquire之后能看到新的代数，不符时撤销这次固定
+        if (slot->generation.load(std::memory_order_relaxed) != static_cast<uint32_t>(handle >> 32)) {
+            slot->pins.fetch_sub(1, std::memory_order_release);
+            handle_error("Invalid handle passed to pin", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid handle passed to pin", ErrorType::INVALID_POINTER);
+        }
+        
+        // 与压缩器搬移后放开pins的release配对，读到的是搬移后的地址
+        return slot->ptr.load(std::memory_order_relaxed);
+    }
+    
+    void unpin(MemoryHandle handle) {
+        HandleSlot* slot = find_handle_slot(handle);
+        uint32_t pins = slot ? slot->pins.load(std::memory_order_relaxed) : 0;
+        if (pins == 0 || pins == HANDLE_MOVING || pins == HANDLE_FREED) {
+            handle_error("Handle passed to unpin is not pinned", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Handle passed to unpin is not pinned", ErrorType::INVALID_POINTER);
+        }
+        
+        // release保证固定期间的写入在压缩器复制之前可见
+        slot->pins.fetch_sub(1, std::memory_order_release);
+    }
+    
+    // 作用域内固定句柄
+    class PinnedHandle {
+    private:
+        BasicMemoryPool* pool;
+        MemoryHandle handle;
+        void* ptr;
+        
+    public:
+        PinnedHandle(BasicMemoryPool& p, MemoryHandle h) : pool(&p), handle(h), ptr(p.pin(h)) {}
+        
+        PinnedHandle(PinnedHandle&& other) noexcept : pool(other.pool), handle(other.handle), ptr(other.ptr) {
+            other.pool = nullptr;
+        }
+        
+        ~PinnedHandle() {
+            if (pool) {
+                pool->unpin(handle);
+            }
+        }
+        
+        PinnedHandle(const PinnedHandle&) = delete;
+        PinnedHandle& operator=(const PinnedHandle&) = delete;
+        PinnedHandle& operator=(PinnedHandle&&) = delete;
+        
+        void* get() const {
+            return ptr;
+        }
+        
+        template<typename T>
+        T* as() const {
+            return static_cast<T*>(ptr);
+        }
+    };
+    
+    // 分配时请求的大小，句柄无效时返回0。无锁
+    size_t get_handle_size(MemoryHandle handle) const {
+        const HandleSlot* slot = find_handle_slot(handle);
+        return slot ? slot->size : 0;
+    }
+    
+    // 在线压缩的一步：把未被固定的句柄块搬进同阶空洞，使原位置与空闲的伙伴合并；
+    // 使用率低的内存段中的句柄块搬到其他内存段，搬空后整体解除映射。
+    // 单步持锁时长受config限制，应用可以在空闲时或定时反复调用
+    CompactionResult compact_step(const CompactionConfig& config = CompactionConfig()) {
+        // 与回收轮次互斥：回收在锁外madvise的块暂时不在自由链表中，此时不能摘除所在内存段
+        std::lock_guard<std::mutex> pass_lock(scavenge_mutex);
+        
+        CompactionResult result;
+        std::vector<MemorySegment> retired;
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            auto start = std::chrono::steady_clock::now();
+            compact_locked(config, result, retired);
+            result.pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            compact_locked(config, result, retired);
+            result.pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        }
+        
+        // 系统调用在锁外进行
+        for (const MemorySegment& segment : retired) {
+            deallocate_system_memory(segment.base, segment.size);
+            result.released_bytes += segment.size;
+        }
+        result.released_segments = retired.size();
+        
+        compaction_steps.fetch_add(1, std::memory_order_relaxed);
+        compacted_blocks.fetch_add(result.moved_blocks, std::memory_order_relaxed);
+        compacted_bytes.fetch_add(result.moved_bytes, std::memory_order_relaxed);
+        compaction_released_segments.fetch_add(result.released_segments, std::memory_order_relaxed);
+        compaction_released_bytes.fetch_add(result.released_bytes, std::memory_order_relaxed);
+        int64_t pause = result.pause.count();
+        int64_t max_pause = compaction_max_pause_ns.load(std::memory_order_relaxed);
+        while (pause > max_pause &&
+               !compaction_max_pause_ns.compare_exchange_weak(max_pause, pause, std::memory_order_relaxed)) {
+        }
+        
+        return result;
+    }
+    
+    // 反复执行compact_step直到没有可做的搬移，步与步之间释放锁。
+    // 返回各步的累计结果，pause为单步的最大值
+    CompactionResult compact(const CompactionConfig& config = CompactionConfig()) {
+        CompactionResult total;
+        while (!total.complete) {
+            CompactionResult step = compact_step(config);
+            total.moved_blocks += step.moved_blocks;
+            total.moved_bytes += step.moved_bytes;
+            total.skipped_pinned += step.skipped_pinned;
+            total.released_segments += step.released_segments;
+            total.released_bytes += step.released_bytes;
+            total.pause = std::max(total.pause, step.pause);
+            total.complete = step.complete;
+        }
+        return total;
+    }
+    
+    CompactionStats get_compaction_stats() const {
+        CompactionStats result;
+        result.steps = compaction_steps.load(std::memory_order_relaxed);
+        result.moved_blocks = compacted_blocks.load(std::memory_order_relaxed);
+        result.moved_bytes = compacted_bytes.load(std::memory_order_relaxed);
+        result.released_segments = compaction_released_segments.load(std::memory_order_relaxed);
+        result.released_bytes = compaction_released_bytes.load(std::memory_order_relaxed);
+        result.max_pause = std::chrono::nanoseconds(compaction_max_pause_ns.load(std::memory_order_relaxed));
+        return result;
+    }
+    
+    // 作为多arena前端的第index个arena：已有和之后新增的内存段都登记到共享段索引
+    void join_arena(ArenaSegmentIndex& segments, size_t index) {
+        auto join = [&]() {
+            arena_segments = &segments;
+            arena_index = index;
+            std::lock_guard<std::mutex> lock(segments.mutex);
+            for (auto& segment : memory_segments) {
+                if (segment.base) {
+                    segment.arena_index = index;
+                    segments.page_map.insert(segment.base, segment.size, &segment);
+                }
+            }
+        };
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            join();
+        } else {
+            join();
+        }
+    }
+    
+    // 统计和监控
+    StatsPolicy get_stats() const {
+        if (is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(stats_mutex);
+            return stats;
+        } else {
+            return stats;
+        }
+    }
+    
+    MemoryUsage get_memory_usage() const {
+        StatsPolicy current_stats = get_stats();
+        
+        MemoryUsage usage;
+        usage.total = current_stats.get_total_memory();
+        usage.used = current_stats.get_used_memory();
+        usage.free = current_stats.get_free_memory();
+        usage.usage_percent = current_stats.get_memory_usage();
+        
+        return usage;
+    }
+    
+    // 计时采样率：每rate次操作（按操作类型分别计数）读取一次TSC，
+    // 1表示每次操作都计时，0表示关闭计时。平均值、最大值和分位数都只反映被采样的操作
+    void set_timing_sample_rate(size_t rate) {
+        timing_sample_rate.store(rate, std::memory_order_relaxed);
+    }
+    
+    size_t get_timing_sample_rate() const {
+        return timing_sample_rate.load(std::memory_order_relaxed);
+    }
+    
+    PerformanceMetrics get_performance_metrics() const {
+        StatsPolicy current_stats = get_stats();
+        
+        auto summarize = [&current_stats](LatencyOp op) {
+            LatencySummary summary;
+            summary.samples = current_stats.get_latency_sample_count(op);
+            summary.p50_ns = current_stats.get_latency_percentile(op, 0.5);
+            summary.p99_ns = current_stats.get_latency_percentile(op, 0.99);
+            summary.p999_ns = current_stats.get_latency_percentile(op, 0.999);
+            return summary;
+        };
+        
+        PerformanceMetrics metrics;
+        metrics.avg_alloc_time_ns = current_stats.get_average_alloc_time();
+        metrics.avg_dealloc_time_ns = current_stats.get_average_dealloc_time();
+        metrics.max_alloc_time_ns = current_stats.get_max_alloc_time();
+        metrics.max_dealloc_time_ns = current_stats.get_max_dealloc_time();
+        metrics.allocation_count = current_stats.get_allocation_count();
+        metrics.deallocation_count = current_stats.get_deallocation_count();
+        metrics.alloc_latency = summarize(LatencyOp::ALLOCATE);
+        metrics.dealloc_latency = summarize(LatencyOp::DEALLOCATE);
+        metrics.split_latency = summarize(LatencyOp::SPLIT);
+        metrics.merge_latency = summarize(LatencyOp::MERGE);
+        metrics.expand_latency = summarize(LatencyOp::EXPAND);
+        
+        return metrics;
+    }
+    
+    ErrorStats get_error_stats() const {
+        StatsPolicy current_stats = get_stats();
+        
+        ErrorStats error_stats;
+        error_stats.allocation_failures = current_stats.get_allocation_failures();
+        error_stats.deallocation_failures = current_stats.get_deallocation_failures();
+        error_stats.invalid_pointer_errors = current_stats.get_invalid_pointer_errors();
+        error_stats.alloc_failure_rate = current_stats.get_allocation_failure_rate();
+        error_stats.dealloc_failure_rate = current_stats.get_deallocation_failure_rate();
+        
+        return error_stats;
+    }
+    
+    HealthReport get_health_report() const {
+        StatsPolicy current_stats = get_stats();
+        
+        HealthReport report;
+        report.fragmentation_rate = current_stats.get_fragmentation_rate();
+        report.memory_usage = current_stats.get_memory_usage();
+        report.error_rate = (current_stats.get_allocation_failure_rate() + 
+                            current_stats.get_deallocation_failure_rate()) * 100.0;
+        
+        // 根据各种指标确定健康状态
+        if (report.error_rate > 10.0 || report.fragmentation_rate > 50.0) {
+            report.status = HealthStatus::CRITICAL;
+            report.message = "Memory pool is in critical condition";
+        } else if (report.error_rate > 5.0 || report.fragmentation_rate > 30.0) {
+            report.status = HealthStatus::WARNING;
+            report.message = "Memory pool has warnings";
+        } else {
+            report.status = HealthStatus::HEALTHY;
+            report.message = "Memory pool is healthy";
+        }
+        
+        return report;
+    }
+    
+    std::string get_detailed_report() const {
+        StatsPolicy current_stats = get_stats();
+        return current_stats.get_summary();
+    }
+    
+    void reset_stats() {
+        if (is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(stats_mutex);
+            stats.reset();
+        } else {
+            stats.reset();
+        }
+    }
+    
+    // 错误处理
+    void set_error_handling_strategy(ErrorHandlingStrategy strategy) {
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            error_strategy = strategy;
+        } else {
+            error_strategy = strategy;
+        }
+    }
+    
+    void set_error_logger(std::function<void(const std::string&)> logger) {
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            error_logger = logger;
+        } else {
+            error_logger = logger;
+        }
+    }
+    
+private:
+    // 一次持锁摘取的回收工作：已从自由链表摘下、等待madvise的最大块，
+    // 以及已从内存池摘除、等待解除映射的空闲内存段
+    struct ScavengeBatch {
+        std::vector<void*> blocks;
+        MemorySegment retired;
+    };
+    
+    void scavenger_loop() {
+        std::unique_lock<std::mutex> lock(scavenger_mutex);
+        while (!scavenger_stop) {
+            scavenger_cv.wait_for(lock, scavenger_config.interval, [this]() { return scavenger_stop; });
+            if (scavenger_stop) {
+                break;
+            }
+            
+            lock.unlock();
+            try {
+                scavenge();
+            } catch (...) {
+                // 回收失败不影响内存池的正常使用，下一轮重试
+            }
+            lock.lock();
+        }
+    }
+    
+    // 调用者需持有pool_mutex。从(segment_index, block_index)继续扫描，
+    // 返回true表示所有内存段都已扫描完
+    bool collect_scavenge_batch(const ScavengerConfig& config, uint64_t cutoff,
+                                size_t& segment_index, size_t& block_index, ScavengeBatch& batch) {
+        const size_t top = free_list_count - 1;
+        size_t scanned = 0;
+        
+        while (segment_index < memory_segments.size()) {
+            MemorySegment& segment = memory_segments[segment_index];
+            
+            // 完全空闲且空闲时间足够长的内存段整体解除映射，初始内存段保留
+            if (block_index == 0 && segment.base && segment_index > 0 && config.release_empty_segments &&
+                segment.allocated_bytes == 0 && is_segment_idle(segment, cutoff)) {
+                detach_segment(segment, batch.retired);
+                segment_index++;
+                return segment_index >= memory_segments.size();
+            }
+            
+            while (block_index < segment.top_free_since.size()) {
+                if (batch.blocks.size() >= config.batch_size || scanned >= SCAVENGER_SCAN_LIMIT) {
+                    return false;
+                }
+                
+                size_t index = block_index++;
+                size_t offset = index * max_block_size;
+                scanned++;
+                
+                if (offset >= segment.untouched_offset) {
+                    // reset后还没切出的部分：按切分顺序切出后与空闲的顶层块一样回收，
+                    // 已经归还过的直接放入自由链表，使后面的块也能切出
+                    if (offset != segment.untouched_offset || segment.size - offset < max_block_size ||
+                        (!segment.top_released[index] && segment.untouched_since > cutoff)) {
+                        block_index = segment.top_free_since.size();
+                        break;
+                    }
+                    segment.untouched_offset += max_block_size;
+                    segment.top_free_since[index] = segment.untouched_since;
+                    if (segment.top_released[index]) {
+                        push_free_block(segment, block_address(segment, offset), top);
+                    } else {
+                        batch.blocks.push_back(block_address(segment, offset));
+                    }
+                    continue;
+                }
+                
+                if (!segment.top_released[index] && segment.top_free_since[index] <= cutoff &&
+                    is_block_free(segment, top, offset)) {
+                    void* addr = block_address(segment, offset);
+                    free_lists[top].remove(static_cast<MemoryBlockDescriptor*>(addr));
+                    set_free_bit(segment, top, offset, false);
+                    batch.blocks.push_back(addr);
+                }
+            }
+            
+            segment_index++;
+            block_index = 0;
+        }
+        
+        return true;
+    }
+    
+    // 调用者需持有pool_mutex。MADV_DONTNEED之后这些页重新由内核按需清零
+    void restore_scavenged_blocks(const ScavengeBatch& batch, bool pages_zeroed) {
+        const size_t top = free_list_count - 1;
+        for (void* addr : batch.blocks) {
+            MemorySegment& segment = *find_segment(addr);
+            size_t offset = segment_offset(segment, addr);
+            
+            if (pages_zeroed) {
+                size_t last_page = (offset + max_block_size - 1) >> PageMap::PAGE_SHIFT;
+                for (size_t page = offset >> PageMap::PAGE_SHIFT; page <= last_page; ++page) {
+                    segment.dirty_pages[page / 64].fetch_and(~(uint64_t(1) << (page % 64)), std::memory_order_relaxed);
+                }
+            }
+            
+            push_free_block(segment, addr, top);
+            segment.top_released[offset / max_block_size] = 1;
+        }
+    }
+    
+    bool is_segment_idle(const MemorySegment& segment, uint64_t cutoff) const {
+        if (segment.top_free_since.empty()) {
+            return false;
+        }
+        size_t carved = std::min(segment.untouched_offset / max_block_size, segment.top_free_since.size());
+        for (size_t i = 0; i < carved; ++i) {
+            if (segment.top_free_since[i] > cutoff) {
+                return false;
+            }
+        }
+        return carved == segment.top_free_since.size() || segment.untouched_since <= cutoff;
+    }
+    
+    // 调用者需持有pool_mutex。把完全空闲的内存段从自由链表和页映射中摘除并移入retired，
+    // deque中的槽位保留（页映射曾引用其地址），之后扩展时复用
+    void detach_segment(MemorySegment& segment, MemorySegment& retired) {
+        // 未切分的部分不在自由链表中
+        for_each_initial_block(segment, [this, &segment](size_t offset, size_t list_index) {
+            if (offset < segment.untouched_offset) {
+                free_lists[list_index].remove(static_cast<MemoryBlockDescriptor*>(block_address(segment, offset)));
+            }
+        });
+        
+        page_map.erase(segment.base, segment.size);
+        if (arena_segments) {
+            std::lock_guard<std::mutex> lock(arena_segments->mutex);
+            arena_segments->page_map.erase(segment.base, segment.size);
+        }
+        stats.set_total_memory(stats.get_total_memory() - segment.size);
+        
+        retired = std::move(segment);
+        segment = MemorySegment();
+    }
+    
+    // 大对象分配：优先复用span缓存中大小相近且满足对齐的span，否则新建映射。
+    // 系统调用在large_mutex之外进行
+    void* allocate_large(size_t size, size_t alignment, bool zeroed) {
+        Timer timer = timing_start(LatencyOp::ALLOCATE);
+        
+        size_t length = MemoryAlignment::align_up(size, PageMap::PAGE_SIZE);
+        alignment = std::max(alignment, PageMap::PAGE_SIZE);
+        
+        LargeSpan span;
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            span = take_cached_span(length, alignment);
+        } else {
+            span = take_cached_span(length, alignment);
+        }
+        
+        bool cache_hit = span.base != nullptr;
+        if (cache_hit) {
+            // 缓存的span保留着上一次使用的内容
+            if (zeroed) {
+                std::memset(span.base, 0, size);
+            }
+        } else {
+            span.base = map_aligned(length, alignment);
+            span.size = length;
+            if (!span.base) {
+                stats.update_allocation_failure();
+                handle_error("Failed to map large object", ErrorType::OUT_OF_MEMORY);
+                throw MemoryPoolException("Failed to map large object", ErrorType::OUT_OF_MEMORY);
+            }
+        }
+        
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            large_objects.emplace(span.base, span.size);
+        } else {
+            large_objects.emplace(span.base, span.size);
+        }
+        
+        stats.update_large_allocation(span.size, finish_timing(timer), cache_hit, timer.sampled());
+        return span.base;
+    }
+    
+    void deallocate_large(void* ptr) {
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        
+        std::vector<LargeSpan> evicted;
+        size_t size = 0;
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            size = release_large_object(ptr, evicted);
+        } else {
+            size = release_large_object(ptr, evicted);
+        }
+        
+        if (size == 0) {
+            stats.update_invalid_pointer_error();
+            stats.update_deallocation_failure();
+            handle_error("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+        }
+        
+        for (const LargeSpan& span : evicted) {
+            deallocate_system_memory(span.base, span.size);
+        }
+        
+        stats.update_large_deallocation(size, finish_timing(timer), timer.sampled());
+    }
+    
+    // 调用者需持有large_mutex。取出能容纳length且浪费不超过1/4的最小span
+    LargeSpan take_cached_span(size_t length, size_t alignment) {
+        size_t best = SIZE_MAX;
+        for (size_t i = 0; i < large_span_cache.size(); ++i) {
+            const LargeSpan& span = large_span_cache[i];
+            if (span.size >= length && span.size - length <= length / 4 &&
+                MemoryAlignment::is_aligned(span.base, alignment) &&
+                (best == SIZE_MAX || span.size < large_span_cache[best].size)) {
+                best = i;
+            }
+        }
+        
+        if (best == SIZE_MAX) {
+            return LargeSpan();
+        }
+        
+        LargeSpan span = large_span_cache[best];
+        large_span_cache.erase(large_span_cache.begin() + best);
+        large_span_cache_bytes -= span.size;
+        stats.set_large_cache_memory(large_span_cache_bytes);
+        return span;
+    }
+    
+    // 调用者需持有large_mutex。返回大对象的映射长度，ptr不是存活大对象时返回0；
+    // 需要解除映射的span放入evicted，由调用者在锁外处理
+    size_t release_large_object(void* ptr, std::vector<LargeSpan>& evicted) {
+        auto it = large_objects.find(ptr);
+        if (it == large_objects.end()) {
+            return 0;
+        }
+        
+        size_t size = it->second;
+        large_objects.erase(it);
+        
+        LargeSpan span;
+        span.base = ptr;
+        span.size = size;
+        span.freed_at = now_ticks();
+        if (size <= large_span_cache_limit) {
+            large_span_cache.push_back(span);
+            large_span_cache_bytes += size;
+            trim_large_span_cache(evicted);
+        } else {
+            evicted.push_back(span);
+        }
+        
+        return size;
+    }
+    
+    // 调用者需持有large_mutex。按释放先后淘汰span直到满足字节和数量上限
+    void trim_large_span_cache(std::vector<LargeSpan>& evicted) {
+        size_t count = 0;
+        while (count < large_span_cache.size() &&
+               (large_span_cache_bytes > large_span_cache_limit ||
+                large_span_cache.size() - count > LARGE_SPAN_CACHE_COUNT)) {
+            evicted.push_back(large_span_cache[count]);
+            large_span_cache_bytes -= large_span_cache[count].size;
+            count++;
+        }
+        
+        large_span_cache.erase(large_span_cache.begin(), large_span_cache.begin() + count);
+        stats.set_large_cache_memory(large_span_cache_bytes);
+    }
+    
+    // 解除映射在span缓存中空闲超过阈值的span，返回归还的字节数
+    size_t release_idle_large_spans(uint64_t cutoff) {
+        std::vector<LargeSpan> idle;
+        auto collect = [this, cutoff, &idle]() {
+            auto keep = std::stable_partition(large_span_cache.begin(), large_span_cache.end(),
+                                              [cutoff](const LargeSpan& span) { return span.freed_at > cutoff; });
+            for (auto it = keep; it != large_span_cache.end(); ++it) {
+                idle.push_back(*it);
+                large_span_cache_bytes -= it->size;
+            }
+            large_span_cache.erase(keep, large_span_cache.end());
+            stats.set_large_cache_memory(large_span_cache_bytes);
+        };
+        
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            collect();
+        } else {
+            collect();
+        }
+        
+        size_t released = 0;
+        for (const LargeSpan& span : idle) {
+            deallocate_system_memory(span.base, span.size);
+            released += span.size;
+        }
+        unmapped_bytes.fetch_add(released, std::memory_order_relaxed);
+        return released;
+    }
+    
+    // 解除映射所有存活大对象和缓存的span（reset和析构时）
+    void release_large_objects() {
+        std::vector<LargeSpan> spans;
+        auto collect = [this, &spans]() {
+            for (const auto& object : large_objects) {
+                LargeSpan span;
+                span.base = object.first;
+                span.size = object.second;
+                spans.push_back(span);
+            }
+            spans.insert(spans.end(), large_span_cache.begin(), large_span_cache.end());
+            large_objects.clear();
+            large_span_cache.clear();
+            large_span_cache_bytes = 0;
+        };
+        
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            collect();
+        } else {
+            collect();
+        }
+        
+        for (const LargeSpan& span : spans) {
+            deallocate_system_memory(span.base, span.size);
+        }
+    }
+    
+    size_t find_large_object(void* ptr) const {
+        if (is_thread_safe()) {
+            ScopedLock large_lock(large_mutex);
+            auto it = large_objects.find(ptr);
+            return it == large_objects.end() ? 0 : it->second;
+        } else {
+            auto it = large_objects.find(ptr);
+            return it == large_objects.end() ? 0 : it->second;
+        }
+    }
+    
+    static uint64_t now_ticks() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    // 一次计时：start为开始时的周期计数，0表示本次操作未被采样
+    struct Timer {
+        uint64_t start = 0;
+        LatencyOp op = LatencyOp::ALLOCATE;
+        
+        bool sampled() const {
+            return start != 0;
+        }
+    };
+    
+    // 每种操作各自计数，每timing_sample_rate次采样一次；统计关闭时不读取时钟
+    Timer timing_start(LatencyOp op) {
+        Timer timer;
+        timer.op = op;
+        
+        if constexpr (StatsPolicy::ENABLED) {
+            size_t rate = timing_sample_rate.load(std::memory_order_relaxed);
+            if (rate == 0) {
+                return timer;
+            }
+            
+            // 扩展很少发生，只要计时开启就每次都计时
+            if (op == LatencyOp::EXPAND) {
+                timer.start = CycleClock::now();
+                return timer;
+            }
+            
+            thread_local size_t countdown[static_cast<size_t>(LatencyOp::COUNT)] = {};
+            size_t& remaining = countdown[static_cast<size_t>(op)];
+            if (remaining == 0 || remaining > rate) {
+                remaining = rate;
+            }
+            if (--remaining == 0) {
+                timer.start = CycleClock::now();
+            }
+        }
+        
+        return timer;
+    }
+    
+    std::chrono::nanoseconds timing_elapsed(const Timer& timer) const {
+        if (!timer.sampled()) {
+            return std::chrono::nanoseconds(0);
+        }
+        return CycleClock::to_duration(CycleClock::now() - timer.start);
+    }
+    
+    // 结束计时并把被采样的延迟记入对应操作的直方图
+    std::chrono::nanoseconds finish_timing(const Timer& timer) {
+        std::chrono::nanoseconds duration = timing_elapsed(timer);
+        if (timer.sampled()) {
+            stats.record_latency(timer.op, duration);
+        }
+        return duration;
+    }
+    
+    // 线程缓存实现
+    ThreadCache& get_thread_cache() {
+        thread_local std::vector<std::unique_ptr<ThreadCache>> caches;
+        
+        for (auto& cache : caches) {
+            if (cache->registry == cache_registry) {
+                size_t current_epoch = cache_epoch.load(std::memory_order_acquire);
+                if (cache->epoch != current_epoch) {
+                    cache->discard(current_epoch);
+                }
+                return *cache;
+            }
+        }
+        
+        // 清理已经析构的内存池留下的缓存
+        for (auto it = caches.begin(); it != caches.end();) {
+            std::unique_lock<std::mutex> lock((*it)->registry->mutex);
+            bool dead = (*it)->registry->pool == nullptr;
+            lock.unlock();
+            it = dead ? caches.erase(it) : it + 1;
+        }
+        
+        caches.push_back(std::make_unique<ThreadCache>(cache_registry, size_class_sizes,
+                                                       cache_epoch.load(std::memory_order_acquire)));
+        return *caches.back();
+    }
+    
+    void* allocate_cached(size_t block_size) {
+        Timer timer = timing_start(LatencyOp::ALLOCATE);
+        
+        ThreadCache& cache = get_thread_cache();
+        size_t class_index = size_class_index(block_size);
+        
+        void* result = cache.pop(class_index);
+        if (!result) {
+            refill_thread_cache(cache, class_index, block_size);
+            result = cache.pop(class_index);
+        }
+        cache.cached_bytes -= block_size;
+        clear_deferred_free(result);
+        
+        typename ThreadCache::Bin& bin = cache.bins[class_index];
+        bin.pending_allocs++;
+        if (timer.sampled()) {
+            auto duration = finish_timing(timer);
+            bin.pending_timed_allocs++;
+            bin.pending_alloc_time += duration;
+            bin.pending_alloc_max = std::max(bin.pending_alloc_max, duration);
+        }
+        
+        return result;
+    }
+    
+    void deallocate_cached(MemorySegment& segment, void* ptr) {
+        Timer timer = timing_start(LatencyOp::DEALLOCATE);
+        
+        // 指针归属已在deallocate中通过页映射检查。放入待归还数组之前先把块标记为延迟释放，
+        // 非块起始地址和重复释放（包括块还在待归还数组或缓存中时）在这里当场报错
+        if (mark_deferred_free(segment, ptr) == 0) {
+            stats.update_invalid_pointer_error();
+            stats.update_deallocation_failure();
+            handle_error("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+        }
+        
+        ThreadCache& cache = get_thread_cache();
+        cache.pending_frees[cache.pending_free_count++] = ptr;
+        
+        if (timer.sampled()) {
+            auto duration = finish_timing(timer);
+            cache.pending_timed_frees++;
+            cache.pending_dealloc_time += duration;
+            cache.pending_dealloc_max = std::max(cache.pending_dealloc_max, duration);
+        }
+        
+        if (cache.pending_free_count == THREAD_CACHE_FREE_BATCH) {
+            ScopedLock pool_lock(pool_mutex);
+            flush_pending_frees(cache);
+            flush_cache_stats(cache);
+        }
+    }
+    
+    // 先消化本线程延迟释放的块，仍不足时从自由链表批量取块；整个过程只加一次锁
+    void refill_thread_cache(ThreadCache& cache, size_t class_index, size_t block_size) {
+        ScopedLock pool_lock(pool_mutex);
+        
+        flush_pending_frees(cache);
+        flush_cache_stats(cache);
+        
+        typename ThreadCache::Bin& bin = cache.bins[class_index];
+        if (bin.count > 0) {
+            return;
+        }
+        
+        size_t batch = bin.batch;
+        if (cache.cached_bytes + batch * block_size > thread_cache_max_bytes) {
+            batch = std::max<size_t>(1, (thread_cache_max_bytes - std::min(cache.cached_bytes, thread_cache_max_bytes)) / block_size);
+        }
+        
+        // 缓存中的块都带有延迟释放标记，分配出去时才清除
+        try {
+            // 第一个块允许触发扩展，其余块只取现有的空闲块
+            void* block = allocate_from_pool(block_size);
+            mark_deferred_free(*find_segment(block), block);
+            cache.push(class_index, block, block_size);
+        } catch (...) {
+            stats.update_allocation_failure();
+            handle_error("Memory allocation failed", ErrorType::OUT_OF_MEMORY);
+            throw;
+        }
+        
+        bool from_slab = block_size <= slab_max_object_size;
+        size_t list_index = from_slab ? 0 : block_list_index(block_size);
+        for (size_t i = 1; i < batch; ++i) {
+            void* block = from_slab ? allocate_from_slab(class_index, false)
+                                    : allocate_from_free_list(list_index, block_size);
+            if (!block) {
+                break;
+            }
+            mark_deferred_free(*find_segment(block), block);
+            cache.push(class_index, block, block_size);
+        }
+    }
+    
+    // 调用者需持有pool_mutex。待归还的块在释放时已经验证并标记过
+    void flush_pending_frees(ThreadCache& cache) {
+        size_t freed_bytes = 0;
+        size_t freed_count = 0;
+        
+        for (size_t i = 0; i < cache.pending_free_count; ++i) {
+            void* ptr = cache.pending_frees[i];
+            size_t size = deferred_block_size(ptr);
+            size_t class_index = size_class_index(size);
+            freed_bytes += size;
+            freed_count++;
+            
+            if (size > thread_cache_max_block_size) {
+                deallocate_from_pool(ptr, true);
+                continue;
+            }
+            
+            // 大小类已满或超过线程上限时，先批量归还一半
+            typename ThreadCache::Bin& bin = cache.bins[class_index];
+            if (bin.count >= bin.capacity || cache.cached_bytes + size > thread_cache_max_bytes) {
+                release_cached_blocks(cache, class_index, bin.batch);
+            }
+            
+            if (cache.cached_bytes + size > thread_cache_max_bytes) {
+                deallocate_from_pool(ptr, true);
+            } else {
+                MemorySegment& segment = *find_segment(ptr);
+                mark_pages_dirty(segment, segment_offset(segment, ptr), size);
+                cache.push(class_index, ptr, size);
+            }
+        }
+        
+        stats.update_deallocation_batch(freed_bytes, freed_count, cache.pending_dealloc_time, cache.pending_dealloc_max,
+                                        cache.pending_timed_frees);
+        cache.pending_free_count = 0;
+        cache.pending_timed_frees = 0;
+        cache.pending_dealloc_time = std::chrono::nanoseconds(0);
+        cache.pending_dealloc_max = std::chrono::nanoseconds(0);
+    }
+    
+    // 调用者需持有pool_mutex
+    void release_cached_blocks(ThreadCache& cache, size_t class_index, size_t count) {
+        size_t block_size = size_class_sizes[class_index];
+        for (size_t i = 0; i < count; ++i) {
+            void* block = cache.pop(class_index);
+            if (!block) {
+                break;
+            }
+            cache.cached_bytes -= block_size;
+            deallocate_from_pool(block, true);
+        }
+    }
+    
+    // 调用者需持有pool_mutex
+    void flush_cache_stats(ThreadCache& cache) {
+        for (size_t i = 0; i < cache.bins.size(); ++i) {
+            typename ThreadCache::Bin& bin = cache.bins[i];
+            if (bin.pending_allocs == 0) {
+                continue;
+            }
+            
+            stats.update_allocation_batch(size_class_sizes[i], bin.pending_allocs, 
+                                          bin.pending_alloc_time, bin.pending_alloc_max, bin.pending_timed_allocs);
+            atomic_allocation_count.fetch_add(bin.pending_allocs, std::memory_order_relaxed);
+            bin.pending_allocs = 0;
+            bin.pending_timed_allocs = 0;
+            bin.pending_alloc_time = std::chrono::nanoseconds(0);
+            bin.pending_alloc_max = std::chrono::nanoseconds(0);
+        }
+    }
+    
+    // 线程退出时调用，调用者持有registry锁
+    void release_thread_cache(ThreadCache& cache) {
+        ScopedLock pool_lock(pool_mutex);
+        
+        if (cache.epoch != cache_epoch.load(std::memory_order_acquire)) {
+            return;
+        }
+        
+        flush_pending_frees(cache);
+        flush_cache_stats(cache);
+        
+        for (size_t i = 0; i < cache.bins.size(); ++i) {
+            release_cached_blocks(cache, i, cache.bins[i].count);
+        }
+    }
+    
+    // 可重定位分配辅助方法，带_locked后缀的调用者需持有pool_mutex
+    MemoryHandle allocate_handle_locked(size_t size, size_t block_size, const Timer& timer) {
+        void* block = allocate_buddy_block(block_size);
+        
+        size_t index;
+        try {
+            index = acquire_handle_slot();
+        } catch (...) {
+            deallocate_from_pool(block);
+            throw;
+        }
+        
+        HandleSlot& slot = handle_slots[index];
+        slot.size = size;
+        slot.ptr.store(block, std::memory_order_release);
+        find_segment(block)->handle_bytes += block_size;
+        
+        stats.update_allocation(block_size, finish_timing(timer), timer.sampled());
+        return (static_cast<MemoryHandle>(slot.generation.load(std::memory_order_relaxed)) << 32) | (index + 1);
+    }
+    
+    // pin不获取pool_mutex，先把pins从0原子地换成HANDLE_FREED认领槽位，之后的pin会失败
+    void free_handle_locked(MemoryHandle handle, const Timer& timer) {
+        HandleSlot* slot = find_handle_slot(handle);
+        uint32_t expected = 0;
+        if (!slot || !slot->pins.compare_exchange_strong(expected, HANDLE_FREED, std::memory_order_acquire,
+                                                         std::memory_order_relaxed)) {
+            stats.update_deallocation_failure();
+            handle_error("Invalid or pinned handle passed to free_handle", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid or pinned handle passed to free_handle", ErrorType::INVALID_POINTER);
+        }
+        
+        void* ptr = slot->ptr.load(std::memory_order_relaxed);
+        MemorySegment& segment = *find_segment(ptr);
+        size_t size = deallocate_from_pool(ptr);
+        segment.handle_bytes -= size;
+        release_handle_slot(static_cast<size_t>(handle & 0xffffffff) - 1);
+        stats.update_deallocation(size, finish_timing(timer), timer.sampled());
+    }
+    
+    // 句柄对应的槽位；空句柄、越界、槽位已释放或代数不符时返回nullptr。无锁
+    const HandleSlot* find_handle_slot(MemoryHandle handle) const {
+        size_t index = static_cast<size_t>(handle & 0xffffffff);
+        if (index == 0 || index > handle_slots.size()) {
+            return nullptr;
+        }
+        
+        const HandleSlot& slot = handle_slots[index - 1];
+        if (slot.generation.load(std::memory_order_relaxed) != static_cast<uint32_t>(handle >> 32) ||
+            !slot.ptr.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slot;
+    }
+    
+    HandleSlot* find_handle_slot(MemoryHandle handle) {
+        return const_cast<HandleSlot*>(static_cast<const BasicMemoryPool*>(this)->find_handle_slot(handle));
+    }
+    
+    // 优先复用空闲槽位；句柄表在第一次分配句柄时预留
+    size_t acquire_handle_slot() {
+        if (handle_free_head != 0) {
+            size_t index = handle_free_head - 1;
+            handle_free_head = handle_slots[index].next_free;
+            return index;
+        }
+        
+        if (handle_slots.size() == 0) {
+            handle_slots.reset(HANDLE_TABLE_CAPACITY);
+        }
+        if (handle_slot_count == handle_slots.size()) {
+            handle_error("Handle table is full", ErrorType::POOL_FULL);
+            throw MemoryPoolException("Handle table is full", ErrorType::POOL_FULL);
+        }
+        return handle_slot_count++;
+    }
+    
+    // 代数加一使旧句柄失效，槽位放回空闲链表。代数要在放开pins之前更新，
+    // 使之后CAS成功的pin一定能看到新的代数
+    void release_handle_slot(size_t index) {
+        HandleSlot& slot = handle_slots[index];
+        slot.generation.store(slot.generation.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        slot.ptr.store(nullptr, std::memory_order_relaxed);
+        slot.pins.store(0, std::memory_order_release);
+        slot.next_free = handle_free_head;
+        handle_free_head = index + 1;
+    }
+    
+    // reset后所有块都已空闲，全部句柄随之失效
+    void reset_handles() {
+        handle_free_head = 0;
+        for (size_t i = handle_slot_count; i-- > 0;) {
+            release_handle_slot(i);
+        }
+        compaction_cursor = 0;
+        compaction_idle_scanned = 0;
+        compaction_victim = nullptr;
+    }
+    
+    enum class MoveOutcome {
+        MOVED,          // 已搬移
+        SKIPPED,        // 不需要或无法搬移
+        OUT_OF_BUDGET   // 查找目标时用完了本步的检查预算，下一步重试该块
+    };
+    
+    // 从上一步停下的槽位继续检查，预算用完或检查完整个句柄表时停止；之后解除映射搬空的内存段
+    void compact_locked(const CompactionConfig& config, CompactionResult& result, std::vector<MemorySegment>& retired) {
+        if (!compaction_victim || compaction_victim->allocated_bytes != compaction_victim->handle_bytes) {
+            compaction_victim = select_compaction_victim(config);
+        }
+        
+        // 句柄和候选空闲块共用一份检查预算
+        size_t budget = config.max_scan;
+        size_t scanned = 0;
+        while (budget > 0 && scanned < handle_slot_count && result.moved_blocks < config.max_moves) {
+            if (compaction_cursor >= handle_slot_count) {
+                compaction_cursor = 0;
+            }
+            budget--;
+            
+            // 本步第一个块就用完预算时视为跳过，保证每一步都有进展
+            MoveOutcome outcome = move_handle_block(handle_slots[compaction_cursor], config, result, budget);
+            if (outcome == MoveOutcome::OUT_OF_BUDGET && scanned > 0) {
+                break;
+            }
+            
+            compaction_cursor++;
+            scanned++;
+            compaction_idle_scanned = outcome == MoveOutcome::MOVED ? 0 : compaction_idle_scanned + 1;
+        }
+        
+        // 检查完一整轮仍没有搬移时放弃当前的搬空目标，下一步重新挑选
+        result.complete = compaction_idle_scanned >= handle_slot_count;
+        if (result.complete) {
+            compaction_victim = nullptr;
+        }
+        
+        // 初始内存段保留
+        for (size_t i = 1; i < memory_segments.size(); ++i) {
+            MemorySegment& segment = memory_segments[i];
+            if (segment.base && segment.allocated_bytes == 0) {
+                if (&segment == compaction_victim) {
+                    compaction_victim = nullptr;
+                }
+                retired.emplace_back();
+                detach_segment(segment, retired.back());
+            }
+        }
+    }
+    
+    // 挑选要搬空的内存段：只含句柄块、使用率不高于阈值、其余内存段的空闲字节足以容纳它的块，
+    // 满足条件的内存段中已分配字节最少的一个；没有时返回nullptr
+    MemorySegment* select_compaction_victim(const CompactionConfig& config) {
+        size_t free_bytes = 0;
+        for (const auto& segment : memory_segments) {
+            if (segment.base) {
+                free_bytes += segment.size - segment.allocated_bytes;
+            }
+        }
+        
+        MemorySegment* victim = nullptr;
+        for (size_t i = 1; i < memory_segments.size(); ++i) {
+            MemorySegment& segment = memory_segments[i];
+            if (!segment.base || segment.allocated_bytes == 0 || segment.allocated_bytes != segment.handle_bytes ||
+                static_cast<double>(segment.allocated_bytes) > segment.size * config.evacuate_threshold ||
+                free_bytes - (segment.size - segment.allocated_bytes) < segment.allocated_bytes) {
+                continue;
+            }
+            if (!victim || segment.allocated_bytes < victim->allocated_bytes) {
+                victim = &segment;
+            }
+        }
+        return victim;
+    }
+    
+    // 两类搬移：搬空目标中的块搬到其他内存段，允许分割更大的空闲块；
+    // 其余块只在伙伴空闲时搬进别处的同阶空洞，原位置随即与伙伴合并。
+    // 后者不分割更大的块，每次搬移都使空闲块数量严格减少，不会来回搬动
+    MoveOutcome move_handle_block(HandleSlot& slot, const CompactionConfig& config, CompactionResult& result,
+                                  size_t& budget) {
+        void* ptr = slot.ptr.load(std::memory_order_relaxed);
+        if (!ptr) {
+            return MoveOutcome::SKIPPED;
+        }
+        
+        MemorySegment& segment = *find_segment(ptr);
+        size_t list_index = segment.get_order_entry(order_map_index(segment, ptr)) - 1;
+        size_t block_size = min_block_size << list_index;
+        if (result.moved_bytes + block_size > config.max_bytes) {
+            return MoveOutcome::SKIPPED;
+        }
+        
+        bool evacuate = &segment == compaction_victim;
+        void* buddy = nullptr;
+        if (!evacuate) {
+            size_t buddy_offset = segment_offset(segment, ptr) ^ block_size;
+            if (list_index + 1 >= free_list_count || !is_block_free(segment, list_index, buddy_offset)) {
+                return MoveOutcome::SKIPPED;
+            }
+            buddy = block_address(segment, buddy_offset);
+        }
+        
+        // 只搬移未被固定的块，搬移期间pin等待
+        uint32_t expected = 0;
+        if (!slot.pins.compare_exchange_strong(expected, HANDLE_MOVING, std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            result.skipped_pinned++;
+            return MoveOutcome::SKIPPED;
+        }
+        
+        void* target = take_compaction_target(list_index, evacuate, buddy, budget);
+        if (target) {
+            std::memcpy(target, ptr, slot.size);
+            slot.ptr.store(target, std::memory_order_relaxed);
+        }
+        slot.pins.store(0, std::memory_order_release);
+        
+        if (!target && budget == 0) {
+            return MoveOutcome::OUT_OF_BUDGET;
+        }
+        
+        // 其他内存段已经找不到合适的空闲块时放弃搬空，避免之后每个块都重复一次失败的查找
+        if (!target) {
+            if (evacuate) {
+                compaction_victim = nullptr;
+            }
+            return MoveOutcome::SKIPPED;
+        }
+        
+        find_segment(target)->handle_bytes += block_size;
+        segment.handle_bytes -= block_size;
+        deallocate_from_pool(ptr);
+        result.moved_blocks++;
+        result.moved_bytes += block_size;
+        return MoveOutcome::MOVED;
+    }
+    
+    // 为list_index阶的块挑选搬移目标，跳过exclude（源块的伙伴）和搬空目标中的块。
+    // 每阶只检查自由链表开头的若干块，每检查一块消耗一份预算，预算用完时返回nullptr
+    void* take_compaction_target(size_t list_index, bool allow_split, const void* exclude, size_t& budget) {
+        size_t end_index = allow_split ? free_list_count : list_index + 1;
+        for (size_t i = list_index; i < end_index; ++i) {
+            MemoryBlockDescriptor* block = free_lists[i].get_head();
+            for (size_t checked = 0; block && checked < COMPACTION_TARGET_SCAN; ++checked, block = block->get_next()) {
+                if (budget == 0) {
+                    return nullptr;
+                }
+                budget--;
+                
+                void* addr = block->get_address();
+                MemorySegment& segment = *find_segment(addr);
+                if (addr == exclude || &segment == compaction_victim) {
+                    continue;
+                }
+                
+                free_lists[i].remove(block);
+                return claim_free_block(segment, addr, i, list_index, min_block_size << list_index);
+            }
+        }
+        
+        // 自由链表中没有合适的块时从reset后未切分的部分再切出一块
+        if (budget > 0 && carve_untouched_block()) {
+            budget--;
+            return take_compaction_target(list_index, allow_split, exclude, budget);
+        }
+        return nullptr;
+    }
+    
+    void trace_allocations(void** ptrs, size_t count, size_t size, size_t alignment) {
+        if (trace_recorder.is_recording()) {
+            for (size_t i = 0; i < count; ++i) {
+                trace_recorder.record(TraceEventType::ALLOCATE, ptrs[i], size, alignment);
+            }
+        }
+    }
+    
+    // 内部实现方法
+    // allocate的实现，不登记分配轨迹
+    void* allocate_block(size_t size, size_t alignment) {
+        if (size == 0) {
+            return nullptr;
+        }
+        
+        // 超过最大块大小的请求由大对象层直接映射
+        if (size > max_block_size) {
+            return allocate_large(size, alignment, false);
+        }
+        
+        // 线程缓存命中时不需要获取pool_mutex
+        if (is_thread_safe() && thread_cache_enabled.load(std::memory_order_relaxed)) {
+            size_t block_size = calculate_block_size(size, alignment);
+            if (block_size <= thread_cache_max_block_size) {
+                return allocate_cached(block_size);
+            }
+        }
+        
+        Timer timer = timing_start(LatencyOp::ALLOCATE);
+        
+        if (is_thread_safe()) {
+            ScopedLock pool_lock(pool_mutex);
+            
+            try {
+                void* result = allocate_from_pool(size, alignment);
+                
+                // 使用原子操作更新计数器
+                atomic_allocation_count.fetch_add(1, std::memory_order_relaxed);
+                
+                auto duration = finish_timing(timer);
+                
+                // 更新统计信息
+                size_t actual_size = calculate_block_size(size, alignment);
+                stats.update_allocation(actual_size, duration, timer.sampled());
+                
+                return result;
+            } catch (...) {
+                // 确保异常情况下锁能正确释放
+                stats.update_allocation_failure();
+                handle_error("Memory allocation failed", ErrorType::OUT_OF_MEMORY);
+                throw;
+            }
+        } else {
+            // 单线程模式，无需加锁
+            try {
+                void* result = allocate_from_pool(size, alignment);
+                
+                auto duration = finish_timing(timer);
+                
+                // 更新统计信息
+                size_t actual_size = calculate_block_size(size, alignment);
+                stats.update_allocation(actual_size, duration, timer.sampled());
+                
+                return result;
+            } catch (...) {
+                stats.update_allocation_failure();
+                handle_error("Memory allocation failed", ErrorType::OUT_OF_MEMORY);
+                throw;
+            }
+        }
+    }
+    
+    void* allocate_from_pool(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        // 计算需要的块大小
+        size_t block_size = calculate_block_size(size, alignment);
+        
+        // 检查是否超过最大块大小
+        if (block_size > max_block_size) {
+            handle_error("Requested size exceeds maximum block size", ErrorType::OUT_OF_MEMORY);
+            throw MemoryPoolException("Requested size exceeds maximum block size", ErrorType::OUT_OF_MEMORY);
+        }
+        
+        // 小对象从对应大小类的slab中分配
+        if (block_size <= slab_max_object_size) {
+            return allocate_from_slab(slab_class_lookup[block_size / SLAB_OBJECT_ALIGNMENT], true);
+        }
+        
+        return allocate_buddy_block(block_size);
+    }
+    
+    // 分配一个block_size（2的幂次方）大小的伙伴块，没有空闲块时扩展内存池
+    void* allocate_buddy_block(size_t block_size) {
+        // 计算对应的自由链表索引
+        size_t list_index = block_list_index(block_size);
+        
+        // 尝试从对应的自由链表获取块
+        void* result = allocate_from_free_list(list_index, block_size);
+        
+        if (!result) {
+            // 如果没有可用块，尝试扩展内存池
+            expand_pool(block_size);
+            
+            // 扩展后再次尝试分配
+            result = allocate_from_free_list(list_index, block_size);
+            
+            if (!result) {
+                handle_error("Failed to allocate memory after pool expansion", ErrorType::OUT_OF_MEMORY);
+                throw MemoryPoolException("Failed to allocate memory after pool expansion", ErrorType::OUT_OF_MEMORY);
+            }
+        }
+        
+        return result;
+    }
+    
+    void* allocate_from_free_list(size_t list_index, size_t block_size) {
+        // 检查索引是否有效
+        if (list_index >= free_list_count) {
+            return nullptr;
+        }
+        
+        do {
+            // 从当前链表开始，找到第一个非空的链表
+            for (size_t i = list_index; i < free_list_count; ++i) {
+                MemoryBlockDescriptor* block = free_lists[i].pop_locked();
+                
+                if (block) {
+                    void* addr = block->get_address();
+                    return claim_free_block(*find_segment(addr), addr, i, list_index, block_size);
+                }
+            }
+        } while (carve_untouched_block());
+        
+        return nullptr;
+    }
+    
+    // 从reset后还没有放入自由链表的部分按初始切分的顺序切出一个块，放入对应的自由链表。
+    // 所有内存段都已切分完时返回false
+    bool carve_untouched_block() {
+        for (; untouched_segment < memory_segments.size(); ++untouched_segment) {
+            MemorySegment& segment = memory_segments[untouched_segment];
+            if (!segment.base || segment.size - segment.untouched_offset < min_block_size) {
+                continue;
+            }
+            
+            size_t offset = segment.untouched_offset;
+            size_t list_index = free_list_count - 1;
+            while ((min_block_size << list_index) > segment.size - offset) {
+                list_index--;
+            }
+            
+            segment.untouched_offset += min_block_size << list_index;
+            push_free_block(segment, block_address(segment, offset), list_index);
+            if (list_index + 1 == free_list_count) {
+                // 从reset起就是空闲的；top_released保持reset前的值，已归还的块后台回收不再处理
+                segment.top_free_since[offset / max_block_size] = segment.untouched_since;
+            }
+            return true;
+        }
+        return false;
+    }
+    
+    // addr是刚从i阶自由链表取下的块，按需分割到list_index阶后登记为已分配
+    void* claim_free_block(MemorySegment& segment, void* addr, size_t i, size_t list_index, size_t block_size) {
+        set_free_bit(segment, i, segment_offset(segment, addr), false);
+        if (i + 1 == free_list_count) {
+            segment.top_released[segment_offset(segment, addr) / max_block_size] = 0;
+        }
+        
+        // 块比需要的大时逐级分割
+        if (i > list_index) {
+            Timer timer = timing_start(LatencyOp::SPLIT);
+            split_block(segment, addr, i, list_index);
+            finish_timing(timer);
+        }
+        
+        set_block_order(segment, addr, list_index);
+        segment.allocated_bytes += block_size;
+        return addr;
+    }
+    
+    // 返回被释放块的大小。deferred为true时ptr已由mark_deferred_free标记并验证过
+    size_t deallocate_from_pool(void* ptr, bool deferred = false) {
+        // 检查指针是否为存活分配的起始地址（同时拦截重复释放）
+        MemorySegment* segment = find_segment(ptr);
+        
+        size_t class_index = 0;
+        SlabHeader* slab = segment ? find_slab(*segment, ptr, class_index) : nullptr;
+        if (slab) {
+            return deallocate_from_slab(*segment, slab, class_index, ptr, deferred);
+        }
+        
+        size_t map_index = segment ? order_map_index(*segment, ptr) : SIZE_MAX;
+        uint8_t entry = map_index != SIZE_MAX ? segment->get_order_entry(map_index) : 0;
+        
+        // 锁外的延迟释放标记可能同时认领同一个块，用比较交换清除记录，只有一方能成功
+        bool claimed = deferred ? (entry & DEFERRED_FREE_FLAG) != 0
+                                : entry != 0 && !(entry & DEFERRED_FREE_FLAG) &&
+                                  segment->exchange_order_entry(map_index, entry, 0);
+        if (!claimed) {
+            stats.update_invalid_pointer_error();
+            handle_error("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+        }
+        
+        // 标记过的块没有其他释放方能再修改表项，直接清除
+        if (deferred) {
+            segment->set_order_entry(map_index, 0);
+        }
+        
+        size_t list_index = (entry & ~DEFERRED_FREE_FLAG) - 1;
+        size_t size = min_block_size << list_index;
+        segment->allocated_bytes -= size;
+        mark_pages_dirty(*segment, segment_offset(*segment, ptr), size);
+        
+        // 与空闲的伙伴块合并后放回自由链表
+        Timer timer = timing_start(LatencyOp::MERGE);
+        merge_blocks(*segment, ptr, list_index);
+        finish_timing(timer);
+        
+        return size;
+    }
+    
+    // 从class_index大小类的slab中取一个对象。没有部分空闲的slab时新建一个：
+    // allow_expand为true时可以扩展内存池，否则只使用现有的空闲块，取不到时返回nullptr
+    void* allocate_from_slab(size_t class_index, bool allow_expand) {
+        SlabClass& slab_class = slab_classes[class_index];
+        SlabHeader* slab = slab_class.partial;
+        
+        if (!slab) {
+            void* block = allow_expand ? allocate_buddy_block(slab_block_size)
+                                       : allocate_from_free_list(slab_list_index, slab_block_size);
+            if (!block) {
+                return nullptr;
+            }
+            slab = create_slab(block, class_index);
+        }
+        
+        // 从上次命中的位图字开始查找空闲对象
+        size_t word_count = (slab_class.object_count + 63) / 64;
+        size_t index = SIZE_MAX;
+        for (size_t i = 0; i < word_count; ++i) {
+            size_t word = slab->search_hint + i;
+            if (word >= word_count) {
+                word -= word_count;
+            }
+            
+            uint64_t bits = slab->free_bitmap[word].load(std::memory_order_relaxed);
+            if (bits) {
+                index = word * 64 + lowest_set_bit(bits);
+                slab->search_hint = word;
+                break;
+            }
+        }
+        
+        assert(index != SIZE_MAX);
+        slab->set_free(index, false);
+        
+        // 最后一个空闲对象被取走后slab离开部分空闲链表
+        if (--slab->free_count == 0) {
+            unlink_slab(slab);
+        }
+        
+        return reinterpret_cast<char*>(slab) + slab_class.first_object_offset + index * slab_class.object_size;
+    }
+    
+    // 调用者需持有pool_mutex。批量分配的内部实现，失败时归还已取得的块
+    void allocate_bulk_from_pool(size_t block_size, size_t count, void** out) {
+        size_t taken = 0;
+        try {
+            if (block_size <= slab_max_object_size) {
+                allocate_slab_bulk(slab_class_lookup[block_size / SLAB_OBJECT_ALIGNMENT], count, out, taken);
+            } else {
+                for (; taken < count; ++taken) {
+                    out[taken] = allocate_buddy_block(block_size);
+                }
+            }
+        } catch (...) {
+            for (size_t i = 0; i < taken; ++i) {
+                deallocate_from_pool(out[i]);
+            }
+            stats.update_allocation_failure();
+            handle_error("Bulk allocation failed", ErrorType::OUT_OF_MEMORY);
+            throw;
+        }
+    }
+    
+    // 调用者需持有pool_mutex。从class_index大小类的slab中连续取count个对象，
+    // 每个位图字只读写一次；taken记录已写入out的对象数，供失败时回滚
+    void allocate_slab_bulk(size_t class_index, size_t count, void** out, size_t& taken) {
+        SlabClass& slab_class = slab_classes[class_index];
+        
+        while (taken < count) {
+            SlabHeader* slab = slab_class.partial;
+            if (!slab) {
+                slab = create_slab(allocate_buddy_block(slab_block_size), class_index);
+            }
+            
+            char* objects = reinterpret_cast<char*>(slab) + slab_class.first_object_offset;
+            size_t word_count = (slab_class.object_count + 63) / 64;
+            
+            for (size_t word = slab->search_hint; word < word_count && taken < count; ++word) {
+                uint64_t bits = slab->free_bitmap[word].load(std::memory_order_relaxed);
+                size_t word_taken = 0;
+                
+                while (bits && taken < count) {
+                    out[taken++] = objects + (word * 64 + lowest_set_bit(bits)) * slab_class.object_size;
+                    bits &= bits - 1;
+                    word_taken++;
+                }
+                
+                if (word_taken > 0) {
+                    slab->free_bitmap[word].store(bits, std::memory_order_relaxed);
+                    slab->free_count -= word_taken;
+                    slab->search_hint = word;
+                }
+            }
+            
+            // search_hint之前的字也可能有空闲对象（释放时会把提示前移），slab未取空时下一轮从头查找
+            if (slab->free_count == 0) {
+                unlink_slab(slab);
+            } else if (taken < count) {
+                slab->search_hint = 0;
+            }
+        }
+    }
+    
+    // 调用者需持有pool_mutex。释放属于内存段的指针，大对象留给调用者在锁外处理
+    void deallocate_bulk_to_pool(void** ptrs, size_t count, size_t& freed_bytes,
+                                 size_t& freed_count, size_t& invalid_count) {
+        for (size_t i = 0; i < count; ++i) {
+            void* ptr = ptrs[i];
+            if (!ptr || !find_segment(ptr)) {
+                continue;
+            }
+            
+            // 非块起始地址或重复释放（包括同一批次内的重复）
+            size_t size = get_block_size_internal(ptr);
+            if (size == 0) {
+                stats.update_invalid_pointer_error();
+                stats.update_deallocation_failure();
+                invalid_count++;
+                continue;
+            }
+            
+            deallocate_from_pool(ptr);
+            freed_bytes += size;
+            freed_count++;
+        }
+    }
+    
+    // 释放slab中的对象，返回对象大小。slab变空且该大小类还有其他部分空闲的slab时，
+    // 把slab块归还给伙伴系统；每个大小类保留一个空slab，避免在边界上反复创建和归还
+    size_t deallocate_from_slab(MemorySegment& segment, SlabHeader* slab, size_t class_index, void* ptr,
+                                bool deferred) {
+        SlabClass& slab_class = slab_classes[class_index];
+        size_t index = slab_object_index(slab, class_index, ptr);
+        
+        // 与mark_deferred_free竞争同一对象时，先置位延迟释放位的一方获胜
+        if (index == SIZE_MAX || slab->is_free(index) || (!deferred && !slab->mark_deferred(index))) {
+            stats.update_invalid_pointer_error();
+            handle_error("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+            throw MemoryPoolException("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+        }
+        
+        slab->set_free(index, true);
+        slab->clear_deferred(index);
+        slab->search_hint = std::min(slab->search_hint, index / 64);
+        mark_pages_dirty(segment, segment_offset(segment, ptr), slab_class.object_size);
+        
+        if (++slab->free_count == 1) {
+            link_slab(slab);
+        }
+        
+        if (slab->free_count == slab_class.object_count && (slab_class.partial != slab || slab->next)) {
+            // slab头部也已写过，整个块都不再保证为零
+            unlink_slab(slab);
+            segment.set_order_entry(order_map_index(segment, slab), 0);
+            segment.allocated_bytes -= slab_block_size;
+            mark_pages_dirty(segment, segment_offset(segment, slab), slab_block_size);
+            Timer timer = timing_start(LatencyOp::MERGE);
+            merge_blocks(segment, slab, slab_list_index);
+            finish_timing(timer);
+        }
+        
+        return slab_class.object_size;
+    }
+    
+    // 在刚分配的伙伴块上构造slab，并在阶数表中把该块标记为slab
+    SlabHeader* create_slab(void* block, size_t class_index) {
+        const SlabClass& slab_class = slab_classes[class_index];
+        SlabHeader* slab = new (block) SlabHeader();
+        slab->class_index = class_index;
+        slab->free_count = slab_class.object_count;
+        
+        for (size_t i = 0; i < slab_class.object_count / 64; ++i) {
+            slab->free_bitmap[i].store(~uint64_t(0), std::memory_order_relaxed);
+        }
+        if (slab_class.object_count % 64) {
+            slab->free_bitmap[slab_class.object_count / 64].store((uint64_t(1) << (slab_class.object_count % 64)) - 1,
+                                                                  std::memory_order_relaxed);
+        }
+        
+        MemorySegment& segment = *find_segment(block);
+        segment.set_order_entry(order_map_index(segment, block), static_cast<uint8_t>(SLAB_ORDER_FLAG | class_index));
+        
+        link_slab(slab);
+        return slab;
+    }
+    
+    void link_slab(SlabHeader* slab) {
+        SlabClass& slab_class = slab_classes[slab->class_index];
+        slab->prev = nullptr;
+        slab->next = slab_class.partial;
+        if (slab_class.partial) {
+            slab_class.partial->prev = slab;
+        }
+        slab_class.partial = slab;
+    }
+    
+    void unlink_slab(SlabHeader* slab) {
+        SlabClass& slab_class = slab_classes[slab->class_index];
+        if (slab->prev) {
+            slab->prev->next = slab->next;
+        } else {
+            slab_class.partial = slab->next;
+        }
+        if (slab->next) {
+            slab->next->prev = slab->prev;
+        }
+        slab->next = nullptr;
+        slab->prev = nullptr;
+    }
+    
+    // ptr所在的slab；ptr不在slab块中时返回nullptr。slab块按自身大小对齐，
+    // 其起始位置在阶数表中带有SLAB_ORDER_FLAG，低7位是大小类序号
+    SlabHeader* find_slab(const MemorySegment& segment, const void* ptr, size_t& class_index) const {
+        if (slab_max_object_size == 0) {
+            return nullptr;
+        }
+        
+        size_t slab_offset = segment_offset(segment, ptr) & ~(slab_block_size - 1);
+        uint8_t entry = segment.get_order_entry(slab_offset >> min_block_shift);
+        if (!(entry & SLAB_ORDER_FLAG)) {
+            return nullptr;
+        }
+        
+        class_index = entry & ~SLAB_ORDER_FLAG;
+        return static_cast<SlabHeader*>(block_address(segment, slab_offset));
+    }
+    
+    // 对象在slab中的序号，ptr不是对象起始地址时返回SIZE_MAX。释放路径每次都要计算，
+    // 用乘法代替除法：偏移小于slab块大小（不超过2^16），乘以index_multiplier后右移32位的结果是精确的
+    size_t slab_object_index(const SlabHeader* slab, size_t class_index, const void* ptr) const {
+        const SlabClass& slab_class = slab_classes[class_index];
+        size_t offset = static_cast<const char*>(ptr) - reinterpret_cast<const char*>(slab);
+        if (offset < slab_class.first_object_offset) {
+            return SIZE_MAX;
+        }
+        
+        offset -= slab_class.first_object_offset;
+        size_t index = static_cast<size_t>((offset * slab_class.index_multiplier) >> 32);
+        if (index * slab_class.object_size != offset || index >= slab_class.object_count) {
+            return SIZE_MAX;
+        }
+        return index;
+    }
+    
+    static size_t lowest_set_bit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_ctzll(bits));
+#else
+        size_t index = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+    
+    // 把current_list_index阶的块逐级对半分割到target_list_index阶，
+    // 每一级的后半块（伙伴块）放回自由链表，前半块继续分割
+    void split_block(MemorySegment& segment, void* addr, size_t current_list_index, size_t target_list_index) {
+        while (current_list_index > target_list_index) {
+            current_list_index--;
+            
+            void* second_addr = static_cast<char*>(addr) + (min_block_size << current_list_index);
+            push_free_block(segment, second_addr, current_list_index);
+            
+            // 更新碎片统计
+            stats.update_fragmentation(1);
+        }
+    }
+    
+    // 通过空闲位图O(1)判断伙伴是否空闲，逐级向上合并，最后把结果块放回自由链表
+    void merge_blocks(MemorySegment& segment, void* addr, size_t list_index) {
+        size_t offset = segment_offset(segment, addr);
+        
+        // 最大块不再向上合并
+        while (list_index + 1 < free_list_count) {
+            size_t buddy_offset = offset ^ (min_block_size << list_index);
+            if (!is_block_free(segment, list_index, buddy_offset)) {
+                break;
+            }
+            
+            // 从自由链表中摘除伙伴块
+            MemoryBlockDescriptor* buddy = static_cast<MemoryBlockDescriptor*>(block_address(segment, buddy_offset));
+            free_lists[list_index].remove(buddy);
+            set_free_bit(segment, list_index, buddy_offset, false);
+            
+            // 伙伴的描述符成为合并后块的内部数据，所在页未被使用过时清掉，保持该页全零
+            if (!segment.is_page_dirty(buddy_offset >> PageMap::PAGE_SHIFT)) {
+                std::memset(static_cast<void*>(buddy), 0, sizeof(MemoryBlockDescriptor));
+            }
+            
+            offset = std::min(offset, buddy_offset);
+            list_index++;
+            
+            // 更新碎片统计
+            stats.update_fragmentation(-1);
+        }
+        
+        push_free_block(segment, block_address(segment, offset), list_index);
+    }
+    
+    // 伙伴系统辅助方法，调用者需持有pool_mutex
+    size_t segment_offset(const MemorySegment& segment, const void* ptr) const {
+        return static_cast<const char*>(ptr) - static_cast<const char*>(segment.base);
+    }
+    
+    void* block_address(const MemorySegment& segment, size_t offset) const {
+        return static_cast<char*>(segment.base) + offset;
+    }
+    
+    bool is_block_free(const MemorySegment& segment, size_t list_index, size_t offset) const {
+        size_t bit = offset >> (min_block_shift + list_index);
+        const ZeroedArray<uint64_t>& bitmap = segment.free_bitmaps[list_index];
+        if (bit / 64 >= bitmap.size()) {
+            return false;
+        }
+        return (bitmap[bit / 64] >> (bit % 64)) & 1;
+    }
+    
+    void set_free_bit(MemorySegment& segment, size_t list_index, size_t offset, bool free) {
+        size_t bit = offset >> (min_block_shift + list_index);
+        uint64_t mask = uint64_t(1) << (bit % 64);
+        if (free) {
+            segment.free_bitmaps[list_index][bit / 64] |= mask;
+        } else {
+            segment.free_bitmaps[list_index][bit / 64] &= ~mask;
+        }
+    }
+    
+    // 标记[offset, offset + size)覆盖的页为已使用
+    void mark_pages_dirty(MemorySegment& segment, size_t offset, size_t size) {
+        size_t last_page = (offset + size - 1) >> PageMap::PAGE_SHIFT;
+        for (size_t page = offset >> PageMap::PAGE_SHIFT; page <= last_page; ++page) {
+            segment.mark_page_dirty(page);
+        }
+    }
+    
+    // 清零刚分配的块的前size字节：块头部总是清零，其余部分只清零已使用过的页
+    void zero_fill(void* ptr, size_t size) {
+        size_t head = std::min(size, sizeof(MemoryBlockDescriptor));
+        std::memset(ptr, 0, head);
+        
+        const MemorySegment& segment = *find_segment(ptr);
+        size_t offset = segment_offset(segment, ptr) + head;
+        size_t end = segment_offset(segment, ptr) + size;
+        
+        while (offset < end) {
+            size_t page = offset >> PageMap::PAGE_SHIFT;
+            size_t page_end = std::min(end, (page + 1) << PageMap::PAGE_SHIFT);
+            if (segment.is_page_dirty(page)) {
+                std::memset(block_address(segment, offset), 0, page_end - offset);
+            }
+            offset = page_end;
+        }
+    }
+    
+    void push_free_block(MemorySegment& segment, void* addr, size_t list_index) {
+        free_lists[list_index].push_locked(MemoryBlockDescriptor::create(addr));
+        set_free_bit(segment, list_index, segment_offset(segment, addr), true);
+        
+        // 记录最大块开始空闲的时间，供后台回收判断
+        if (list_index + 1 == free_list_count) {
+            segment.top_free_since[segment_offset(segment, addr) / max_block_size] = now_ticks();
+        }
+    }
+    
+    size_t calculate_block_size(size_t requested_size, size_t alignment = DEFAULT_ALIGNMENT) {
+        // 对齐要求超过slab粒度时按对齐向上取整，得到的大小类天然满足该对齐
+        if (alignment > SLAB_OBJECT_ALIGNMENT) {
+            requested_size = MemoryAlignment::align_up(requested_size, alignment);
+        }
+        
+        // 小对象使用能容纳它的最小slab大小类
+        if (requested_size <= slab_max_object_size) {
+            size_t lookup_index = (requested_size + SLAB_OBJECT_ALIGNMENT - 1) / SLAB_OBJECT_ALIGNMENT;
+            return slab_classes[slab_class_lookup[lookup_index]].object_size;
+        }
+        
+        // 确保块大小至少为最小块大小
+        size_t size = std::max(requested_size, min_block_size);
+        
+        // 计算向上对齐的2的幂次方
+        size_t power = 1;
+        while (power < size) {
+            power <<= 1;
+        }
+        
+        return power;
+    }
+    
+    // slab大小类：128字节以内按16字节递增，之后每翻一倍划分4个大小类；
+    // 小于min_block_size的大小类不使用，slab块小于一页时不启用slab
+    void initialize_size_classes() {
+        slab_block_size = std::min(SLAB_BLOCK_SIZE, max_block_size);
+        
+        if (slab_block_size >= PageMap::PAGE_SIZE && slab_block_size > min_block_size) {
+            slab_list_index = block_list_index(slab_block_size);
+            size_t max_object_size = std::min(SLAB_MAX_OBJECT_SIZE, slab_block_size / 8);
+            
+            size_t size = SLAB_OBJECT_ALIGNMENT;
+            while (size <= max_object_size) {
+                if (size >= min_block_size) {
+                    // 第一个对象按对象大小的自然对齐（2的幂因子）放置，
+                    // 这样2的幂次方大小的对象与伙伴块一样按自身大小对齐
+                    SlabClass slab_class;
+                    slab_class.object_size = size;
+                    slab_class.first_object_offset = MemoryAlignment::align_up(sizeof(SlabHeader), size & (~size + 1));
+                    slab_class.object_count = (slab_block_size - slab_class.first_object_offset) / size;
+                    slab_class.index_multiplier = ((uint64_t(1) << 32) / size) + 1;
+                    slab_classes.push_back(slab_class);
+                }
+                
+                size_t power = 1;
+                while (power * 2 <= size) {
+                    power <<= 1;
+                }
+                size += size < 128 ? SLAB_OBJECT_ALIGNMENT : power / 4;
+            }
+        }
+        
+        if (!slab_classes.empty()) {
+            slab_max_object_size = slab_classes.back().object_size;
+            slab_class_lookup.resize(slab_max_object_size / SLAB_OBJECT_ALIGNMENT + 1);
+            size_t class_index = 0;
+            for (size_t i = 0; i < slab_class_lookup.size(); ++i) {
+                while (slab_classes[class_index].object_size < i * SLAB_OBJECT_ALIGNMENT) {
+                    class_index++;
+                }
+                slab_class_lookup[i] = static_cast<uint8_t>(class_index);
+            }
+        }
+        
+        // 线程缓存的大小类：先是全部slab大小类，再是大于slab上限的各阶伙伴块
+        for (const auto& slab_class : slab_classes) {
+            size_class_sizes.push_back(slab_class.object_size);
+        }
+        first_buddy_class_index = 0;
+        while ((min_block_size << first_buddy_class_index) <= slab_max_object_size) {
+            first_buddy_class_index++;
+        }
+        for (size_t i = first_buddy_class_index; i < free_list_count; ++i) {
+            size_class_sizes.push_back(min_block_size << i);
+        }
+    }
+    
+    // calculate_block_size返回的块大小在线程缓存中的大小类序号
+    size_t size_class_index(size_t block_size) const {
+        if (block_size <= slab_max_object_size) {
+            return slab_class_lookup[block_size / SLAB_OBJECT_ALIGNMENT];
+        }
+        size_t list_index = block_list_index(block_size);
+        return slab_classes.size() + list_index - first_buddy_class_index;
+    }
+    
+    void initialize_pool(size_t initial_size) {
+        // 分配初始内存
+        void* memory = allocate_system_memory(initial_size);
+        
+        if (!memory) {
+            handle_error("Failed to allocate initial memory pool", ErrorType::OUT_OF_MEMORY);
+            throw MemoryPoolException("Failed to allocate initial memory pool", ErrorType::OUT_OF_MEMORY);
+        }
+        
+        // 添加到内存段列表
+        add_memory_segment(memory, initial_size);
+        
+        // 初始化自由链表
+        initialize_free_lists();
+    }
+    
+    void initialize_free_lists() {
+        // 清空所有自由链表
+        for (size_t i = 0; i < free_list_count; ++i) {
+            free_lists[i].clear();
+        }
+        
+        // 遍历所有内存段，初始化自由链表
+        for (auto& segment : memory_segments) {
+            initialize_segment(segment);
+        }
+    }
+    
+    void initialize_segment(MemorySegment& segment) {
+        for_each_initial_block(segment, [this, &segment](size_t offset, size_t list_index) {
+            push_free_block(segment, block_address(segment, offset), list_index);
+        });
+        segment.untouched_offset = segment.size;
+    }
+    
+    // 按从大到小的2的幂次方切分内存段，每个块的段内偏移都是其大小的整数倍。
+    // 内存段完全空闲时，合并后的空闲块恰好就是这些块
+    template<typename Visitor>
+    void for_each_initial_block(const MemorySegment& segment, Visitor visit) const {
+        size_t offset = 0;
+        size_t list_index = free_list_count - 1;
+        
+        while (true) {
+            size_t block_size = min_block_size << list_index;
+            
+            while (segment.size - offset >= block_size) {
+                visit(offset, list_index);
+                offset += block_size;
+            }
+            
+            if (list_index == 0) {
+                break;
+            }
+            list_index--;
+        }
+    }
+    
+    MemorySegment& add_memory_segment(void* base, size_t size) {
+        // 优先复用已解除映射的内存段留下的槽位
+        MemorySegment* slot = nullptr;
+        for (auto& segment : memory_segments) {
+            if (!segment.base) {
+                slot = &segment;
+                break;
+            }
+        }
+        if (!slot) {
+            memory_segments.emplace_back();
+            slot = &memory_segments.back();
+        }
+        
+        MemorySegment& segment = *slot;
+        segment.base = base;
+        segment.size = size;
+        segment.owned = true;
+        // 末尾不足一个最小块的部分也占一项，保证段内任意地址都有对应的表项
+        segment.order_map.reset((size + min_block_size - 1) / min_block_size);
+        segment.free_bitmaps.resize(free_list_count);
+        for (size_t i = 0; i < free_list_count; ++i) {
+            size_t block_count = (size >> (min_block_shift + i)) + 1;
+            segment.free_bitmaps[i].reset((block_count + 63) / 64);
+        }
+        segment.dirty_pages.reset(((size + PageMap::PAGE_SIZE - 1) / PageMap::PAGE_SIZE + 63) / 64);
+        segment.allocated_bytes = 0;
+        segment.top_free_since.assign(size / max_block_size, 0);
+        segment.top_released.assign(size / max_block_size, 0);
+        
+        // 内存段初始化完成后再发布到页映射
+        segment.arena_index = arena_index;
+        page_map.insert(base, size, &segment);
+        if (arena_segments) {
+            std::lock_guard<std::mutex> lock(arena_segments->mutex);
+            arena_segments->page_map.insert(base, size, &segment);
+        }
+        
+        stats.set_total_memory(stats.get_total_memory() + size);
+        return segment;
+    }
+    
+    void release_all_segments() {
+        for (auto& segment : memory_segments) {
+            if (arena_segments && segment.base) {
+                std::lock_guard<std::mutex> lock(arena_segments->mutex);
+                arena_segments->page_map.erase(segment.base, segment.size);
+            }
+            if (segment.owned && segment.base) {
+                deallocate_system_memory(segment.base, segment.size);
+            }
+        }
+        memory_segments.clear();
+    }
+    
+    // 内存段来自匿名mmap并按最大块大小对齐：不预先清零，页在首次访问时由内核分配并清零
+    void* allocate_system_memory(size_t size) {
+        return map_aligned(size, std::max(max_block_size, PageMap::PAGE_SIZE));
+    }
+    
+    // 映射按alignment（页大小的整数倍）对齐的匿名内存：多映射一个对齐量，再把首尾多余部分解除映射
+    static void* map_aligned(size_t size, size_t alignment) {
+        size_t length = MemoryAlignment::align_up(size, PageMap::PAGE_SIZE);
+        size_t mapped_length = length + alignment - PageMap::PAGE_SIZE;
+        
+        void* mapped = mmap(nullptr, mapped_length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            return nullptr;
+        }
+        
+        char* start = static_cast<char*>(mapped);
+        char* aligned = reinterpret_cast<char*>(MemoryAlignment::align_up(reinterpret_cast<uintptr_t>(start), alignment));
+        if (aligned > start) {
+            munmap(start, aligned - start);
+        }
+        if (start + mapped_length > aligned + length) {
+            munmap(aligned + length, start + mapped_length - (aligned + length));
+        }
+        
+        return aligned;
+    }
+    
+    static void deallocate_system_memory(void* ptr, size_t size) {
+        munmap(ptr, MemoryAlignment::align_up(size, PageMap::PAGE_SIZE));
+    }
+    
+    void expand_pool(size_t required_size) {
+        Timer timer = timing_start(LatencyOp::EXPAND);
+        
+        // 计算需要扩展的大小
+        size_t current_total = 0;
+        for (const auto& segment : memory_segments) {
+            current_total += segment.size;
+        }
+        
+        size_t expand_size = growth_policy.next_segment_size(current_total, required_size);
+        if (expand_size == 0) {
+            handle_error("Memory pool growth is disabled", ErrorType::POOL_FULL);
+            throw MemoryPoolException("Memory pool growth is disabled", ErrorType::POOL_FULL);
+        }
+        
+        // 确保扩展大小是最大块大小的整数倍
+        expand_size = MemoryAlignment::align_up(expand_size, max_block_size);
+        
+        // 检查是否超过最大内存限制
+        if (max_memory_limit > 0 && current_total + expand_size > max_memory_limit) {
+            handle_error("Memory pool has reached maximum size limit", ErrorType::POOL_FULL);
+            throw MemoryPoolException("Memory pool has reached maximum size limit", ErrorType::POOL_FULL);
+        }
+        
+        // 分配新的内存段
+        void* new_segment = allocate_system_memory(expand_size);
+        
+        if (!new_segment) {
+            handle_error("Failed to allocate system memory for pool expansion", ErrorType::OUT_OF_MEMORY);
+            throw MemoryPoolException("Failed to allocate system memory for pool expansion", ErrorType::OUT_OF_MEMORY);
+        }
+        
+        // 添加到内存段列表并初始化新段的自由链表
+        initialize_segment(add_memory_segment(new_segment, expand_size));
+        
+        finish_timing(timer);
+    }
+    
+    // 只清除每个内存段的元数据，不逐块重建自由链表：各段整体标记为未切分，
+    // 之后分配时再按需切出块，耗时与内存段数成正比而不是与最大块数成正比
+    void reset_pool() {
+        // 清空所有自由链表
+        for (size_t i = 0; i < free_list_count; ++i) {
+            free_lists[i].clear();
+        }
+        
+        // slab块随内存段一起重新变为空闲
+        for (auto& slab_class : slab_classes) {
+            slab_class.partial = nullptr;
+        }
+        
+        // 所有块重新变为空闲。物理页不归还内核，留给后台回收按空闲时间处理；
+        // 页中的旧内容还在，先按空闲位图补记脏页，allocate_zeroed据此清零
+        size_t total_memory = 0;
+        uint64_t now = now_ticks();
+        for (auto& segment : memory_segments) {
+            if (!segment.base) {
+                continue;
+            }
+            total_memory += segment.size;
+            mark_reset_pages_dirty(segment);
+            segment.allocated_bytes = 0;
+            segment.handle_bytes = 0;
+            segment.untouched_offset = 0;
+            segment.untouched_since = now;
+            segment.order_map.clear();
+            for (auto& bitmap : segment.free_bitmaps) {
+                bitmap.clear();
+            }
+        }
+        untouched_segment = 0;
+        
+        reset_handles();
+        
+        // 重置统计信息，内存段仍然保留
+        stats.reset();
+        stats.set_total_memory(total_memory);
+    }
+
+    
+    // reset前调用。段内已切分的部分里，只有整页落在空闲块中的页保留原来的脏页记录；
+    // 其余页上有存活块、slab或线程缓存中的块，一律标记为已使用。这些空闲块起始处的描述符
+    // 在所在页未使用过时清零。只扫描块不小于一页的各阶空闲位图，不遍历自由链表
+    void mark_reset_pages_dirty(MemorySegment& segment) {
+        size_t page_count = (segment.untouched_offset + PageMap::PAGE_SIZE - 1) >> PageMap::PAGE_SHIFT;
+        std::vector<uint64_t> free_pages((page_count + 63) / 64, 0);
+        
+        for (size_t i = 0; i < free_list_count; ++i) {
+            size_t pages_per_block = (min_block_size << i) >> PageMap::PAGE_SHIFT;
+            if (pages_per_block == 0) {
+                continue;
+            }
+            
+            const ZeroedArray<uint64_t>& bitmap = segment.free_bitmaps[i];
+            for (size_t word = 0; word < bitmap.size(); ++word) {
+                for (uint64_t bits = bitmap[word]; bits; bits &= bits - 1) {
+                    size_t offset = (word * 64 + lowest_set_bit(bits)) << (min_block_shift + i);
+                    size_t first_page = offset >> PageMap::PAGE_SHIFT;
+                    if (!segment.is_page_dirty(first_page)) {
+                        std::memset(block_address(segment, offset), 0, sizeof(MemoryBlockDescriptor));
+                    }
+                    set_bit_range(free_pages.data(), first_page, pages_per_block);
+                }
+            }
+        }
+        
+        for (size_t word = 0; word < free_pages.size(); ++word) {
+            uint64_t carved = (word + 1) * 64 <= page_count ? ~uint64_t(0) : (uint64_t(1) << (page_count % 64)) - 1;
+            if (uint64_t used = carved & ~free_pages[word]) {
+                segment.dirty_pages[word].fetch_or(used, std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // 把位图中[first, first + count)的位置1，整字部分一次写入
+    static void set_bit_range(uint64_t* words, size_t first, size_t count) {
+        size_t end = first + count;
+        while (first < end) {
+            size_t bit = first % 64;
+            size_t n = std::min<size_t>(64 - bit, end - first);
+            words[first / 64] |= (n == 64 ? ~uint64_t(0) : ((uint64_t(1) << n) - 1) << bit);
+            first += n;
+        }
+    }
+    
+    bool is_valid_pointer_internal(void* ptr) const {
+        // 检查指针是否在任何内存段范围内，或是存活大对象的起始地址
+        return find_segment(ptr) != nullptr || find_large_object(ptr) != 0;
+    }
+    
+    MemorySegment* find_segment(void* ptr) {
+        return page_map.find(ptr);
+    }
+    
+    const MemorySegment* find_segment(void* ptr) const {
+        return page_map.find(ptr);
+    }
+    
+    // 指针在阶数表中的下标，不是最小块边界时返回SIZE_MAX
+    size_t order_map_index(const MemorySegment& segment, void* ptr) const {
+        size_t offset = static_cast<char*>(ptr) - static_cast<char*>(segment.base);
+        if (offset & (min_block_size - 1)) {
+            return SIZE_MAX;
+        }
+        return offset >> min_block_shift;
+    }
+    
+    // 记录刚分配出去的块的阶数
+    void set_block_order(MemorySegment& segment, void* ptr, size_t list_index) {
+        segment.set_order_entry(order_map_index(segment, ptr), static_cast<uint8_t>(list_index + 1));
+    }
+    
+    // 已释放但尚未归还（延迟释放）的块返回0
+    size_t get_block_size_internal(void* ptr) const {
+        const MemorySegment* segment = find_segment(ptr);
+        if (!segment) {
+            return find_large_object(ptr);
+        }
+        
+        size_t class_index = 0;
+        if (const SlabHeader* slab = find_slab(*segment, ptr, class_index)) {
+            size_t index = slab_object_index(slab, class_index, ptr);
+            return index == SIZE_MAX || slab->is_free(index) || slab->is_deferred(index)
+                ? 0 : slab_classes[class_index].object_size;
+        }
+        
+        size_t map_index = order_map_index(*segment, ptr);
+        if (map_index == SIZE_MAX) {
+            return 0;
+        }
+        
+        uint8_t entry = segment->get_order_entry(map_index);
+        return entry == 0 || (entry & DEFERRED_FREE_FLAG) ? 0 : min_block_size << (entry - 1);
+    }
+    
+    // 无锁地把存活分配标记为延迟释放，返回块大小；ptr不是存活分配的起始地址
+    // （包括已经标记过）时返回0。标记后的块对get_block_size和其他释放路径都是已释放状态，
+    // 之后由deallocate_from_pool(ptr, true)在锁内归还
+    size_t mark_deferred_free(MemorySegment& segment, void* ptr) {
+        size_t class_index = 0;
+        if (SlabHeader* slab = find_slab(segment, ptr, class_index)) {
+            size_t index = slab_object_index(slab, class_index, ptr);
+            if (index == SIZE_MAX || slab->is_free(index) || !slab->mark_deferred(index)) {
+                return 0;
+            }
+            // 检查空闲位和置位之间，对象可能刚被锁内的释放路径归还
+            if (slab->is_free(index)) {
+                slab->clear_deferred(index);
+                return 0;
+            }
+            return slab_classes[class_index].object_size;
         }
         
-        auto start_time = std::chrono::high_resolution_clock::now();
+        size_t map_index = order_map_index(segment, ptr);
+        uint8_t entry = map_index != SIZE_MAX ? segment.get_order_entry(map_index) : 0;
+        if (entry == 0 || (entry & (SLAB_ORDER_FLAG | DEFERRED_FREE_FLAG)) ||
+            !segment.exchange_order_entry(map_index, entry, entry | DEFERRED_FREE_FLAG)) {
+            return 0;
+        }
+        return min_block_size << (entry - 1);
+    }
+    
+    // 线程缓存把块重新分配出去时清除延迟释放标记。块由本线程独占，其他释放方在标记期间无法认领它
+    void clear_deferred_free(void* ptr) {
+        MemorySegment& segment = *find_segment(ptr);
+        size_t class_index = 0;
+        if (SlabHeader* slab = find_slab(segment, ptr, class_index)) {
+            slab->clear_deferred(slab_object_index(slab, class_index, ptr));
+        } else {
+            size_t map_index = order_map_index(segment, ptr);
+            segment.set_order_entry(map_index, segment.get_order_entry(map_index) & ~DEFERRED_FREE_FLAG);
+        }
+    }
+    
+    // 已由mark_deferred_free标记的块的大小
+    size_t deferred_block_size(void* ptr) const {
+        const MemorySegment& segment = *find_segment(ptr);
+        size_t class_index = 0;
+        if (find_slab(segment, ptr, class_index)) {
+            return slab_classes[class_index].object_size;
+        }
         
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            
-            try {
-                void* result = allocate_from_pool(size, alignment);
-                
-                // 使用原子操作更新计数器
-                atomic_allocation_count.fetch_add(1, std::memory_order_relaxed);
+        uint8_t entry = segment.get_order_entry(order_map_index(segment, ptr));
+        return min_block_size << ((entry & ~DEFERRED_FREE_FLAG) - 1);
+    }
+    
+    void handle_error(const std::string& error_msg, ErrorType error_type) {
+        // 根据错误处理策略处理错误
+        switch (error_strategy) {
+            case ErrorHandlingStrategy::THROW_EXCEPTION:
+                throw MemoryPoolException(error_msg, error_type);
                 
-                auto end_time = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
+            case ErrorHandlingStrategy::RETURN_NULLPTR:
+                // 对于分配操作，返回空指针
+                // 对于释放操作，直接返回
+                break;
                 
-                // 更新统计信息
-                size_t actual_size = calculate_block_size(size);
-                stats.update_allocation(actual_size, duration);
+            case ErrorHandlingStrategy::LOG_ERROR:
+                if (error_logger) {
+                    error_logger(error_msg);
+                }
+                break;
                 
-                return result;
-            } catch (...) {
-                // 确保异常情况下锁能正确释放
-                stats.update_allocation_failure();
-                handle_error("Memory allocation failed", ErrorType::OUT_OF_MEMORY);
-                throw;
+            case ErrorHandlingStrategy::TERMINATE:
+                std::cerr << "Fatal error: " << error_msg << std::endl;
+                std::terminate();
+                break;
+        }
+    }
+};
+
+// 默认配置：运行时决定是否加锁，记录完整统计，按增长因子扩展，块大小范围在构造时指定
+using MemoryPool = BasicMemoryPool<>;
+
+// 线程到arena的指派方式
+enum class ArenaAssignment {
+    ROUND_ROBIN,    // 线程第一次分配时轮流指派，之后固定
+    BY_CPU          // 每次分配按当前运行的CPU选择
+};
+
+// 多arena前端：持有多个互相独立的内存池（arena），各有自己的锁、自由链表和内存段，
+// 不同线程的分配落在不同arena上，互不竞争。释放通过共享段索引找到块所属的arena，
+// 可以在任意线程进行：其他arena的块压入所属arena的远程释放链表，不获取它的锁。
+// 超过最大块大小的大对象统一由第0个arena管理
+template<typename Pool = MemoryPool>
+class BasicArenaPool {
+public:
+    using stats_type = decltype(std::declval<const Pool&>().get_stats());
+    
+private:
+    // 远程释放链表（MPSC）：其他线程先在所属arena上把块标记为延迟释放，再用CAS把块压入，
+    // next指针写在块自身中；所属arena下次分配时一次取走整条链表并批量归还，与压入方之间没有ABA问题
+    struct alignas(64) RemoteFreeList {
+        std::atomic<void*> head{nullptr};
+        std::atomic<size_t> pushed{0};  // 累计压入的块数
+    };
+    
+    ArenaSegmentIndex segment_index;    // 先于arenas构造、后于arenas析构
+    std::vector<std::unique_ptr<Pool>> arenas;
+    std::unique_ptr<RemoteFreeList[]> remote_frees; // 每个arena一条
+    std::atomic<bool> remote_free_enabled{true};
+    ArenaAssignment assignment;
+    const uint64_t front_id;            // 进程内唯一，作为线程本地指派表的键
+    std::atomic<size_t> next_arena{0};  // 轮流指派的计数器
+    size_t max_block_size;
+    
+    static uint64_t next_front_id() {
+        static std::atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    
+    size_t round_robin_arena() {
+        thread_local std::vector<std::pair<uint64_t, size_t>> assigned;
+        
+        for (auto& entry : assigned) {
+            if (entry.first == front_id) {
+                return entry.second;
             }
-        } else {
-            // 单线程模式，无需加锁
-            try {
-                void* result = allocate_from_pool(size, alignment);
-                
-                auto end_time = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-                
-                // 更新统计信息
-                size_t actual_size = calculate_block_size(size);
-                stats.update_allocation(actual_size, duration);
-                
-                return result;
-            } catch (...) {
-                stats.update_allocation_failure();
-                handle_error("Memory allocation failed", ErrorType::OUT_OF_MEMORY);
-                throw;
+        }
+        
+        size_t index = next_arena.fetch_add(1, std::memory_order_relaxed) % arenas.size();
+        // 已析构的前端留下的表项不会再被命中，只保留最近的若干项
+        if (assigned.size() >= 16) {
+            assigned.erase(assigned.begin());
+        }
+        assigned.emplace_back(front_id, index);
+        return index;
+    }
+    
+    size_t current_arena_index() {
+        if (assignment == ArenaAssignment::BY_CPU) {
+            int cpu = sched_getcpu();
+            if (cpu >= 0) {
+                return static_cast<size_t>(cpu) % arenas.size();
+            }
+        }
+        return round_robin_arena();
+    }
+    
+    // 当前线程的arena，先归还其他线程释放到这里的块
+    Pool& current_arena() {
+        size_t index = current_arena_index();
+        if (remote_frees[index].head.load(std::memory_order_relaxed)) {
+            drain_remote_frees(index);
+        }
+        return *arenas[index];
+    }
+    
+    void push_remote_free(size_t index, void* ptr) {
+        RemoteFreeList& list = remote_frees[index];
+        void* head = list.head.load(std::memory_order_relaxed);
+        do {
+            *static_cast<void**>(ptr) = head;
+        } while (!list.head.compare_exchange_weak(head, ptr, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+        list.pushed.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // 取走整条远程释放链表，按REMOTE_FREE_BATCH个一批归还，每批只加一次锁
+    void drain_remote_frees(size_t index) {
+        void* block = remote_frees[index].head.exchange(nullptr, std::memory_order_acquire);
+        void* batch[REMOTE_FREE_BATCH];
+        size_t count = 0;
+        
+        while (block) {
+            void* next = *static_cast<void**>(block);
+            batch[count++] = block;
+            if (count == REMOTE_FREE_BATCH) {
+                arenas[index]->release_deferred(batch, count);
+                count = 0;
+            }
+            block = next;
+        }
+        
+        if (count > 0) {
+            arenas[index]->release_deferred(batch, count);
+        }
+    }
+    
+    // 内存段中的块交回所属arena；其他指针（大对象或无效指针）交给第0个arena处理
+    Pool& owner_arena(void* ptr) const {
+        MemorySegment* segment = segment_index.page_map.find(ptr);
+        return segment ? *arenas[segment->arena_index] : *arenas[0];
+    }
+    
+public:
+    explicit BasicArenaPool(size_t arena_count = std::max(1u, std::thread::hardware_concurrency()),
+                            size_t initial_size_per_arena = 1024 * 1024,
+                            ArenaAssignment mode = ArenaAssignment::ROUND_ROBIN)
+        : assignment(mode), front_id(next_front_id()) {
+        if (arena_count == 0) {
+            throw MemoryPoolException("Arena count must be positive", ErrorType::UNKNOWN_ERROR);
+        }
+        
+        arenas.reserve(arena_count);
+        for (size_t i = 0; i < arena_count; ++i) {
+            arenas.push_back(std::make_unique<Pool>(initial_size_per_arena));
+            arenas.back()->join_arena(segment_index, i);
+        }
+        remote_frees = std::make_unique<RemoteFreeList[]>(arena_count);
+        max_block_size = arenas[0]->get_max_block_size();
+    }
+    
+    BasicArenaPool(const BasicArenaPool&) = delete;
+    BasicArenaPool& operator=(const BasicArenaPool&) = delete;
+    
+    void* allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        if (size > max_block_size) {
+            return arenas[0]->allocate(size, alignment);
+        }
+        return current_arena().allocate(size, alignment);
+    }
+    
+    void* allocate_zeroed(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        if (size > max_block_size) {
+            return arenas[0]->allocate_zeroed(size, alignment);
+        }
+        return current_arena().allocate_zeroed(size, alignment);
+    }
+    
+    void deallocate(void* ptr) {
+        if (!ptr) {
+            return;
+        }
+        
+        MemorySegment* segment = segment_index.page_map.find(ptr);
+        if (!segment) {
+            arenas[0]->deallocate(ptr);
+            return;
+        }
+        
+        size_t owner = segment->arena_index;
+        // 压入前把块标记为延迟释放：无效指针和重复释放（包括块还在链表中时）在这里同步报错，
+        // 同一个块不会被压入两次
+        if (remote_free_enabled.load(std::memory_order_relaxed) && owner != current_arena_index()) {
+            arenas[owner]->defer_deallocate(ptr);
+            push_remote_free(owner, ptr);
+            return;
+        }
+        arenas[owner]->deallocate(ptr);
+    }
+    
+    bool is_valid_pointer(void* ptr) const {
+        return ptr && owner_arena(ptr).is_valid_pointer(ptr);
+    }
+    
+    size_t get_block_size(void* ptr) const {
+        return ptr ? owner_arena(ptr).get_block_size(ptr) : 0;
+    }
+    
+    // 各arena的配置（线程缓存、后台回收等）通过arena(i)单独设置
+    size_t arena_count() const {
+        return arenas.size();
+    }
+    
+    Pool& arena(size_t index) {
+        return *arenas.at(index);
+    }
+    
+    ArenaAssignment get_assignment() const {
+        return assignment;
+    }
+    
+    void set_thread_cache_enabled(bool enabled) {
+        for (auto& pool : arenas) {
+            pool->set_thread_cache_enabled(enabled);
+        }
+    }
+    
+    // 关闭后其他arena的块直接在所属arena上加锁释放
+    void set_remote_free_enabled(bool enabled) {
+        remote_free_enabled.store(enabled, std::memory_order_relaxed);
+    }
+    
+    bool is_remote_free_enabled() const {
+        return remote_free_enabled.load(std::memory_order_relaxed);
+    }
+    
+    // 累计经远程释放链表归还的块数
+    size_t get_remote_free_count() const {
+        size_t total = 0;
+        for (size_t i = 0; i < arenas.size(); ++i) {
+            total += remote_frees[i].pushed.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+    
+    // 立即归还所有arena远程释放链表中的块。arena只在自己的下一次分配时取走链表，
+    // 不再有线程分配的arena需要由这里（或scavenge）归还
+    void drain_remote_frees() {
+        for (size_t i = 0; i < arenas.size(); ++i) {
+            drain_remote_frees(i);
+        }
+    }
+    
+    size_t scavenge() {
+        drain_remote_frees();
+        size_t released = 0;
+        for (auto& pool : arenas) {
+            released += pool->scavenge();
+        }
+        return released;
+    }
+    
+    // reset后链表中的块已经随arena一起变为空闲，直接丢弃
+    void reset() {
+        for (size_t i = 0; i < arenas.size(); ++i) {
+            remote_frees[i].head.store(nullptr, std::memory_order_relaxed);
+            arenas[i]->reset();
+        }
+    }
+    
+    // 统计：单个arena的快照，以及所有arena的汇总。远程释放链表中尚未归还的块仍计为已使用，
+    // 需要精确用量时先调用drain_remote_frees
+    stats_type get_arena_stats(size_t index) const {
+        return arenas.at(index)->get_stats();
+    }
+    
+    stats_type get_stats() const {
+        stats_type total;
+        for (const auto& pool : arenas) {
+            total.merge(pool->get_stats());
+        }
+        return total;
+    }
+    
+    // 每个arena一行的用量概览，之后是汇总统计
+    std::string get_arena_report() const {
+        std::ostringstream oss;
+        for (size_t i = 0; i < arenas.size(); ++i) {
+            stats_type arena_stats = arenas[i]->get_stats();
+            oss << "Arena " << i << ": " << arena_stats.get_used_memory() << "/" << arena_stats.get_total_memory()
+                << " bytes used, " << arena_stats.get_allocation_count() << " allocations, "
+                << arena_stats.get_deallocation_count() << " deallocations\n";
+        }
+        oss << get_stats().get_summary();
+        return oss.str();
+    }
+};
+
+using ArenaPool = BasicArenaPool<>;
+
+// 单调分配区：从内存池取最大块，块内按指针递增分配，单个对象不释放。
+// 检查点记录当前位置，回退时把之后取得的块一次归还；release把全部块归还。
+// 归还的代价只与块数有关，与分配过的对象个数无关，对象也不经过伙伴合并。
+// 本身不加锁，供单个线程在一次请求或一个作用域内使用，底层内存池可以被多个分配区共享
+template<typename Pool = MemoryPool>
+class BasicMonotonicArena {
+private:
+    // 每个块起始处的链表节点，块按取得的先后串成栈
+    struct alignas(std::max_align_t) BlockHeader {
+        BlockHeader* prev;
+        size_t size;                    // 向内存池请求的字节数
+    };
+    
+    // 超过块容量该比例的请求单独向内存池申请，不换掉当前块
+    static constexpr size_t DEDICATED_FRACTION = 4;
+    static constexpr size_t RELEASE_BATCH = 64;
+    
+    Pool& pool;
+    size_t block_size;
+    BlockHeader* head = nullptr;        // 最近取得的块
+    char* cursor = nullptr;             // 当前块中下一个可用字节
+    char* limit = nullptr;              // 当前块的结束地址
+    size_t used_bytes = 0;              // 已分配的字节数（含对齐填充）
+    size_t reserved_bytes = 0;          // 持有的块的总字节数
+    size_t block_count = 0;
+    
+    void* allocate_slow(size_t size, size_t alignment) {
+        size_t capacity = block_size - sizeof(BlockHeader);
+        size_t header_space = MemoryAlignment::align_up(sizeof(BlockHeader), alignment);
+        
+        if (size + alignment > capacity / DEDICATED_FRACTION) {
+            if (size > SIZE_MAX - header_space) {
+                throw MemoryPoolException("Monotonic arena allocation too large", ErrorType::OUT_OF_MEMORY);
+            }
+            char* block = acquire_block(header_space + size, std::max(alignment, alignof(BlockHeader)));
+            used_bytes += size;
+            return block + header_space;
+        }
+        
+        char* block = acquire_block(block_size, alignof(BlockHeader));
+        cursor = block + sizeof(BlockHeader);
+        limit = block + block_size;
+        
+        char* result = static_cast<char*>(MemoryAlignment::get_aligned_address(cursor, alignment));
+        used_bytes += result + size - cursor;
+        cursor = result + size;
+        return result;
+    }
+    
+    char* acquire_block(size_t size, size_t alignment) {
+        char* block = static_cast<char*>(pool.allocate(size, alignment));
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(block);
+        header->prev = head;
+        header->size = size;
+        head = header;
+        reserved_bytes += size;
+        block_count++;
+        return block;
+    }
+    
+    // 归还head到stop（不含）之间的块，每批只调用一次deallocate_bulk
+    void release_blocks(BlockHeader* stop) {
+        void* batch[RELEASE_BATCH];
+        size_t count = 0;
+        
+        while (head != stop) {
+            BlockHeader* block = head;
+            head = block->prev;
+            reserved_bytes -= block->size;
+            block_count--;
+            batch[count++] = block;
+            if (count == RELEASE_BATCH) {
+                pool.deallocate_bulk(batch, count);
+                count = 0;
+            }
+        }
+        if (count > 0) {
+            pool.deallocate_bulk(batch, count);
+        }
+    }
+    
+public:
+    // 回退位置。检查点必须按后进先出的顺序使用，回退到一个检查点后，在它之后记录的检查点失效
+    struct Checkpoint {
+        BlockHeader* head;
+        char* cursor;
+        char* limit;
+        size_t used_bytes;
+    };
+    
+    // 作用域检查点：构造时记录，析构时回退
+    class Scope {
+    private:
+        BasicMonotonicArena& arena;
+        Checkpoint checkpoint;
+        
+    public:
+        explicit Scope(BasicMonotonicArena& a) : arena(a), checkpoint(a.checkpoint()) {}
+        
+        ~Scope() {
+            arena.rewind(checkpoint);
+        }
+        
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+    
+    // chunk_size为0时使用内存池的最大块大小
+    explicit BasicMonotonicArena(Pool& p, size_t chunk_size = 0)
+        : pool(p), block_size(chunk_size ? chunk_size : p.get_max_block_size()) {
+        if (block_size > p.get_max_block_size() || block_size < sizeof(BlockHeader) * DEDICATED_FRACTION * 2) {
+            throw MemoryPoolException("Invalid monotonic arena block size", ErrorType::UNKNOWN_ERROR);
+        }
+    }
+    
+    ~BasicMonotonicArena() {
+        try {
+            release();
+        } catch (const MemoryPoolException&) {
+            // 内存池已记录错误，析构中不再抛出
+        }
+    }
+    
+    BasicMonotonicArena(const BasicMonotonicArena&) = delete;
+    BasicMonotonicArena& operator=(const BasicMonotonicArena&) = delete;
+    
+    void* allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            throw MemoryPoolException("Alignment must be a power of two", ErrorType::INVALID_ALIGNMENT);
+        }
+        
+        // 当前块的剩余空间足够时只移动指针
+        uintptr_t address = MemoryAlignment::align_up(reinterpret_cast<uintptr_t>(cursor), alignment);
+        if (cursor && address <= reinterpret_cast<uintptr_t>(limit) &&
+            size <= reinterpret_cast<uintptr_t>(limit) - address) {
+            char* result = reinterpret_cast<char*>(address);
+            used_bytes += result + size - cursor;
+            cursor = result + size;
+            return result;
+        }
+        return allocate_slow(size, alignment);
+    }
+    
+    template<typename T, typename... Args>
+    T* create(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+    
+    Checkpoint checkpoint() const {
+        return Checkpoint{head, cursor, limit, used_bytes};
+    }
+    
+    // 检查点之后分配的对象全部作废，之后取得的块归还内存池。不调用析构函数
+    void rewind(const Checkpoint& point) {
+        release_blocks(point.head);
+        cursor = point.cursor;
+        limit = point.limit;
+        used_bytes = point.used_bytes;
+    }
+    
+    // 归还全部块，分配区回到初始状态
+    void release() {
+        rewind(Checkpoint{nullptr, nullptr, nullptr, 0});
+    }
+    
+    size_t get_used_bytes() const {
+        return used_bytes;
+    }
+    
+    size_t get_reserved_bytes() const {
+        return reserved_bytes;
+    }
+    
+    size_t get_block_count() const {
+        return block_count;
+    }
+    
+    size_t get_block_size() const {
+        return block_size;
+    }
+};
+
+using MonotonicArena = BasicMonotonicArena<>;
+
+// std::pmr::memory_resource适配器，请求转交给内存池。不超过NODE_CACHE_MAX_SIZE字节、
+// 对齐不超过16的请求按16字节分级缓存：释放时按调用者给出的大小直接压回对应级别的链表，
+// 链表为空时向内存池批量申请。链式容器反复分配释放同样大小的节点时不经过内存池的锁和页映射查找。
+// 缓存的节点在release()或析构时归还内存池，也可以限制每级缓存的字节数。
+// LockPolicy为NullLockPolicy时不加锁，只能在单线程中使用
+template<typename Pool = MemoryPool, typename LockPolicy = NullLockPolicy>
+class BasicPoolResource : public std::pmr::memory_resource {
+public:
+    static constexpr size_t NODE_CACHE_MAX_SIZE = 256;
+    static constexpr size_t NODE_CACHE_GRANULARITY = 16;
+    static constexpr size_t NODE_CACHE_CLASSES = NODE_CACHE_MAX_SIZE / NODE_CACHE_GRANULARITY;
+    
+    // 走节点缓存的请求返回所属级别，否则返回SIZE_MAX
+    static constexpr size_t node_class(size_t bytes, size_t alignment) {
+        if (bytes > NODE_CACHE_MAX_SIZE || alignment > NODE_CACHE_GRANULARITY) {
+            return SIZE_MAX;
+        }
+        return bytes <= NODE_CACHE_GRANULARITY ? 0 : (bytes - 1) / NODE_CACHE_GRANULARITY;
+    }
+    
+private:
+    using mutex_type = typename LockPolicy::mutex_type;
+    
+    static constexpr size_t NODE_CACHE_REFILL = 32;   // 链表为空时一次申请的节点数
+    
+    // 空闲节点的单链表，next指针写在节点自身中
+    struct NodeList {
+        void* head = nullptr;
+        size_t count = 0;
+    };
+    
+    Pool& pool;
+    LockPolicy lock_policy;
+    mutable mutex_type mutex;
+    NodeList node_lists[NODE_CACHE_CLASSES];
+    size_t node_cache_limit;            // 每级最多缓存的字节数，超出时归还一半
+    
+    void* allocate_node_locked(size_t index) {
+        NodeList& list = node_lists[index];
+        if (!list.head) {
+            void* nodes[NODE_CACHE_REFILL];
+            pool.allocate_bulk((index + 1) * NODE_CACHE_GRANULARITY, NODE_CACHE_REFILL, nodes,
+                               NODE_CACHE_GRANULARITY);
+            for (void* node : nodes) {
+                *static_cast<void**>(node) = list.head;
+                list.head = node;
+            }
+            list.count = NODE_CACHE_REFILL;
+        }
+        
+        void* node = list.head;
+        list.head = *static_cast<void**>(node);
+        list.count--;
+        return node;
+    }
+    
+    void deallocate_node_locked(void* node, size_t index) {
+        NodeList& list = node_lists[index];
+        *static_cast<void**>(node) = list.head;
+        list.head = node;
+        if (++list.count * (index + 1) * NODE_CACHE_GRANULARITY > node_cache_limit) {
+            release_nodes(list, list.count / 2);
+        }
+    }
+    
+    // 把链表开头的count个节点归还内存池，每批只调用一次deallocate_bulk
+    void release_nodes(NodeList& list, size_t count) {
+        void* batch[NODE_CACHE_REFILL];
+        while (count > 0 && list.head) {
+            size_t batch_count = 0;
+            while (batch_count < NODE_CACHE_REFILL && count > 0 && list.head) {
+                batch[batch_count++] = list.head;
+                list.head = *static_cast<void**>(list.head);
+                list.count--;
+                count--;
             }
+            pool.deallocate_bulk(batch, batch_count);
         }
     }
     
-    template<typename T>
-    T* allocate_type(size_t count = 1) {
-        size_t size = sizeof(T) * count;
-        size_t alignment = alignof(T);
-        return static_cast<T*>(allocate(size, alignment));
+    void release_locked() {
+        for (NodeList& list : node_lists) {
+            release_nodes(list, list.count);
+        }
     }
     
-    void deallocate(void* ptr) {
-        if (!ptr) {
-            return;
-        }
-        
-        auto start_time = std::chrono::high_resolution_clock::now();
-        
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            
-            try {
-                deallocate_from_pool(ptr);
-                
-                // 使用原子操作更新计数器
-                atomic_deallocation_count.fetch_add(1, std::memory_order_relaxed);
-                
-                auto end_time = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-                
-                // 更新统计信息
-                size_t size = get_block_size(ptr);
-                stats.update_deallocation(size, duration);
-                
-            } catch (...) {
-                // 确保异常情况下锁能正确释放
-                stats.update_deallocation_failure();
-                handle_error("Memory deallocation failed", ErrorType::INVALID_POINTER);
-                throw;
-            }
-        } else {
-            // 单线程模式，无需加锁
-            try {
-                deallocate_from_pool(ptr);
-                
-                auto end_time = std::chrono::high_resolution_clock::now();
-                auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time);
-                
-                // 更新统计信息
-                size_t size = get_block_size(ptr);
-                stats.update_deallocation(size, duration);
-                
-            } catch (...) {
-                stats.update_deallocation_failure();
-                handle_error("Memory deallocation failed", ErrorType::INVALID_POINTER);
-                throw;
-            }
-        }
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        return allocate_sized(bytes, alignment);
     }
     
-    void* safe_allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        deallocate_sized(ptr, bytes, alignment);
+    }
+    
+    // 同一内存池上的适配器可以互相释放对方分配的内存
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        const auto* resource = dynamic_cast<const BasicPoolResource*>(&other);
+        return resource && &resource->pool == &pool;
+    }
+    
+public:
+    // 默认不限制缓存量，与std::pmr::unsynchronized_pool_resource一样在release()时整体归还
+    explicit BasicPoolResource(Pool& p, size_t cache_limit_per_class = SIZE_MAX)
+        : pool(p), node_cache_limit(cache_limit_per_class) {}
+    
+    ~BasicPoolResource() override {
         try {
-            return allocate(size, alignment);
+            release();
         } catch (const MemoryPoolException&) {
-            return nullptr;
+            // 内存池已记录错误，析构中不再抛出
         }
     }
     
-    bool safe_deallocate(void* ptr) {
-        try {
-            deallocate(ptr);
-            return true;
-        } catch (const MemoryPoolException&) {
-            return false;
+    BasicPoolResource(const BasicPoolResource&) = delete;
+    BasicPoolResource& operator=(const BasicPoolResource&) = delete;
+    
+    // 节点缓存的快速路径，index由node_class得到
+    void* allocate_node(size_t index) {
+        if (lock_policy.is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(mutex);
+            return allocate_node_locked(index);
         }
+        return allocate_node_locked(index);
     }
     
-    // 内存池管理
-    void reset() {
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            reset_pool();
+    void deallocate_node(void* node, size_t index) {
+        if (lock_policy.is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(mutex);
+            deallocate_node_locked(node, index);
         } else {
-            reset_pool();
+            deallocate_node_locked(node, index);
         }
     }
     
-    bool is_valid_pointer(void* ptr) const {
-        if (!ptr) {
-            return false;
+    // 与do_allocate/do_deallocate相同，但不经过虚函数调用
+    void* allocate_sized(size_t bytes, size_t alignment) {
+        size_t index = node_class(bytes, alignment);
+        if (index != SIZE_MAX) {
+            return allocate_node(index);
         }
-        
-        if (thread_safe) {
-            std::lock_guard<std::mutex> lock(stats_mutex);
-            return is_valid_pointer_internal(ptr);
+        return pool.allocate(bytes, alignment);
+    }
+    
+    // bytes和alignment必须与分配时相同
+    void deallocate_sized(void* ptr, size_t bytes, size_t alignment) {
+        size_t index = node_class(bytes, alignment);
+        if (index != SIZE_MAX) {
+            deallocate_node(ptr, index);
         } else {
-            return is_valid_pointer_internal(ptr);
+            pool.deallocate(ptr);
         }
     }
     
-    size_t get_block_size(void* ptr) const {
-        if (!ptr) {
-            return 0;
-        }
-        
-        if (thread_safe) {
-            std::lock_guard<std::mutex> lock(stats_mutex);
-            return get_block_size_internal(ptr);
+    // 缓存的空闲节点全部归还内存池
+    void release() {
+        if (lock_policy.is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(mutex);
+            release_locked();
         } else {
-            return get_block_size_internal(ptr);
+            release_locked();
         }
     }
     
-    // 线程安全控制
-    void set_thread_safe(bool enabled) {
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            thread_safe = enabled;
-        } else {
-            thread_safe = enabled;
+    size_t get_cached_bytes() const {
+        std::lock_guard<mutex_type> lock(mutex);
+        size_t bytes = 0;
+        for (size_t i = 0; i < NODE_CACHE_CLASSES; ++i) {
+            bytes += node_lists[i].count * (i + 1) * NODE_CACHE_GRANULARITY;
         }
+        return bytes;
     }
     
-    bool is_thread_safe() const {
-        return thread_safe;
+    Pool& get_pool() const {
+        return pool;
     }
+};
+
+using PoolResource = BasicPoolResource<>;
+using SynchronizedPoolResource = BasicPoolResource<MemoryPool, MutexLockPolicy>;
+
+// STL分配器：通过BasicPoolResource分配，释放时带上大小。容器通过allocator_traits重新绑定到
+// 节点类型后，单个节点的分配在编译期确定所属级别，直接走节点缓存
+template<typename T, typename Resource = PoolResource>
+class PoolAllocator {
+private:
+    static constexpr size_t NODE_CLASS = Resource::node_class(sizeof(T), alignof(T));
     
-    // 统计和监控
-    PoolStats get_stats() const {
-        if (thread_safe) {
-            std::lock_guard<std::mutex> lock(stats_mutex);
-            return stats;
-        } else {
-            return stats;
+    Resource* resource;
+    
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+    
+    explicit PoolAllocator(Resource& r) noexcept : resource(&r) {}
+    
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U, Resource>& other) noexcept : resource(other.get_resource()) {}
+    
+    T* allocate(size_t n) {
+        if constexpr (NODE_CLASS != SIZE_MAX) {
+            if (n == 1) {
+                return static_cast<T*>(resource->allocate_node(NODE_CLASS));
+            }
+        }
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
         }
+        return static_cast<T*>(resource->allocate_sized(n * sizeof(T), alignof(T)));
     }
     
-    MemoryUsage get_memory_usage() const {
-        PoolStats current_stats = get_stats();
-        
-        MemoryUsage usage;
-        usage.total = current_stats.get_total_memory();
-        usage.used = current_stats.get_used_memory();
-        usage.free = current_stats.get_free_memory();
-        usage.usage_percent = current_stats.get_memory_usage();
-        
-        return usage;
+    void deallocate(T* ptr, size_t n) {
+        if constexpr (NODE_CLASS != SIZE_MAX) {
+            if (n == 1) {
+                resource->deallocate_node(ptr, NODE_CLASS);
+                return;
+            }
+        }
+        resource->deallocate_sized(ptr, n * sizeof(T), alignof(T));
     }
     
-    PerformanceMetrics get_performance_metrics() const {
-        PoolStats current_stats = get_stats();
-        
-        PerformanceMetrics metrics;
-        metrics.avg_alloc_time_ns = current_stats.get_average_alloc_time();
-        metrics.avg_dealloc_time_ns = current_stats.get_average_dealloc_time();
-        metrics.max_alloc_time_ns = current_stats.get_max_alloc_time();
-        metrics.max_dealloc_time_ns = current_stats.get_max_dealloc_time();
-        metrics.allocation_count = current_stats.get_allocation_count();
-        metrics.deallocation_count = current_stats.get_deallocation_count();
-        
-        return metrics;
+    Resource* get_resource() const noexcept {
+        return resource;
     }
+};
+
+template<typename T, typename U, typename Resource>
+bool operator==(const PoolAllocator<T, Resource>& lhs, const PoolAllocator<U, Resource>& rhs) noexcept {
+    return lhs.get_resource() == rhs.get_resource() || lhs.get_resource()->is_equal(*rhs.get_resource());
+}
+
+template<typename T, typename U, typename Resource>
+bool operator!=(const PoolAllocator<T, Resource>& lhs, const PoolAllocator<U, Resource>& rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+// 定长对象池：从内存池取块切成sizeof(T)大小、按alignof(T)对齐的槽位，空闲槽位组成侵入式链表，
+// make/destroy在槽位上原地构造和析构。KeepConstructed为true时对象只在槽位第一次使用时
+// 默认构造，destroy不析构而是原样放回，下一次make直接返回，适合由调用者自行重置字段的类型；
+// 这种模式下链表指针放在对象之后，槽位多占一个指针。LockPolicy为NullLockPolicy时不加锁
+template<typename T, bool KeepConstructed = false, typename Pool = MemoryPool, typename LockPolicy = NullLockPolicy>
+class ObjectPool {
+private:
+    using mutex_type = typename LockPolicy::mutex_type;
     
-    ErrorStats get_error_stats() const {
-        PoolStats current_stats = get_stats();
-        
-        ErrorStats error_stats;
-        error_stats.allocation_failures = current_stats.get_allocation_failures();
-        error_stats.deallocation_failures = current_stats.get_deallocation_failures();
-        error_stats.invalid_pointer_errors = current_stats.get_invalid_pointer_errors();
-        error_stats.alloc_failure_rate = current_stats.get_allocation_failure_rate();
-        error_stats.dealloc_failure_rate = current_stats.get_deallocation_failure_rate();
-        
-        return error_stats;
+    static constexpr size_t SLOT_ALIGNMENT = std::max(alignof(T), alignof(void*));
+    // 链表指针在槽位中的偏移：普通模式下与对象重叠，保留构造模式下紧跟在对象之后
+    static constexpr size_t LINK_OFFSET = KeepConstructed ? MemoryAlignment::align_up(sizeof(T), alignof(void*)) : 0;
+    static constexpr size_t SLOT_SIZE = MemoryAlignment::align_up(std::max(sizeof(T), LINK_OFFSET + sizeof(void*)),
+                                                                 SLOT_ALIGNMENT);
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+    
+    // 每个块起始处的链表节点，之后是slot_count个槽位
+    struct ChunkHeader {
+        ChunkHeader* next;
+    };
+    static constexpr size_t FIRST_SLOT_OFFSET = MemoryAlignment::align_up(sizeof(ChunkHeader), SLOT_ALIGNMENT);
+    
+    Pool& pool;
+    LockPolicy lock_policy;
+    mutable mutex_type mutex;
+    size_t slots_per_chunk;
+    ChunkHeader* chunks = nullptr;
+    char* free_head = nullptr;          // 空闲槽位链表
+    char* carve_cursor = nullptr;       // 最新的块中还没有用过的槽位
+    char* carve_limit = nullptr;
+    size_t live_count = 0;
+    size_t capacity = 0;
+    
+    static char*& link(char* slot) {
+        return *reinterpret_cast<char**>(slot + LINK_OFFSET);
     }
     
-    HealthReport get_health_report() const {
-        PoolStats current_stats = get_stats();
-        
-        HealthReport report;
-        report.fragmentation_rate = current_stats.get_fragmentation_rate();
-        report.memory_usage = current_stats.get_memory_usage();
-        report.error_rate = (current_stats.get_allocation_failure_rate() + 
-                            current_stats.get_deallocation_failure_rate()) * 100.0;
-        
-        // 根据各种指标确定健康状态
-        if (report.error_rate > 10.0 || report.fragmentation_rate > 50.0) {
-            report.status = HealthStatus::CRITICAL;
-            report.message = "Memory pool is in critical condition";
-        } else if (report.error_rate > 5.0 || report.fragmentation_rate > 30.0) {
-            report.status = HealthStatus::WARNING;
-            report.message = "Memory pool has warnings";
+    char* acquire_slot() {
+        char* slot = free_head;
+        if (slot) {
+            free_head = link(slot);
         } else {
-            report.status = HealthStatus::HEALTHY;
-            report.message = "Memory pool is healthy";
+            if (carve_cursor == carve_limit) {
+                add_chunk();
+            }
+            slot = carve_cursor;
+            carve_cursor += SLOT_SIZE;
         }
-        
-        return report;
+        live_count++;
+        return slot;
     }
     
-    std::string get_detailed_report() const {
-        PoolStats current_stats = get_stats();
-        return current_stats.get_summary();
+    // 保留构造模式：新槽位在移动切分位置之前构造对象，构造失败时槽位仍未使用，
+    // 保证切分位置之前的槽位都持有已构造的对象
+    T* acquire_constructed() {
+        char* slot = free_head;
+        if (slot) {
+            free_head = link(slot);
+        } else {
+            if (carve_cursor == carve_limit) {
+                add_chunk();
+            }
+            slot = carve_cursor;
+            new (slot) T();
+            carve_cursor += SLOT_SIZE;
+        }
+        live_count++;
+        return std::launder(reinterpret_cast<T*>(slot));
     }
     
-    void reset_stats() {
-        if (thread_safe) {
-            std::lock_guard<std::mutex> lock(stats_mutex);
-            stats.reset();
-        } else {
-            stats.reset();
+    void release_slot(char* slot) {
+        link(slot) = free_head;
+        free_head = slot;
+        live_count--;
+    }
+    
+    void add_chunk() {
+        size_t bytes = FIRST_SLOT_OFFSET + slots_per_chunk * SLOT_SIZE;
+        char* memory = static_cast<char*>(pool.allocate(bytes, SLOT_ALIGNMENT));
+        ChunkHeader* chunk = reinterpret_cast<ChunkHeader*>(memory);
+        chunk->next = chunks;
+        chunks = chunk;
+        carve_cursor = memory + FIRST_SLOT_OFFSET;
+        carve_limit = carve_cursor + slots_per_chunk * SLOT_SIZE;
+        capacity += slots_per_chunk;
+    }
+    
+    template<typename Function>
+    auto with_lock(Function function) {
+        if (lock_policy.is_thread_safe()) {
+            std::lock_guard<mutex_type> lock(mutex);
+            return function();
         }
+        return function();
     }
     
-    // 错误处理
-    void set_error_handling_strategy(ErrorHandlingStrategy strategy) {
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            error_strategy = strategy;
-        } else {
-            error_strategy = strategy;
+public:
+    // objects_per_chunk为0时每块约64KB（至少一个对象）
+    explicit ObjectPool(Pool& p, size_t objects_per_chunk = 0) : pool(p) {
+        slots_per_chunk = objects_per_chunk ? objects_per_chunk
+                                            : std::max<size_t>(1, (DEFAULT_CHUNK_SIZE - FIRST_SLOT_OFFSET) / SLOT_SIZE);
+    }
+    
+    // 普通模式下仍存活的对象不析构，由调用者负责；保留构造模式下析构所有构造过的对象
+    ~ObjectPool() {
+        ChunkHeader* chunk = chunks;
+        bool newest = true;
+        while (chunk) {
+            ChunkHeader* next = chunk->next;
+            if (KeepConstructed) {
+                char* first = reinterpret_cast<char*>(chunk) + FIRST_SLOT_OFFSET;
+                char* end = newest ? carve_cursor : first + slots_per_chunk * SLOT_SIZE;
+                for (char* slot = first; slot < end; slot += SLOT_SIZE) {
+                    reinterpret_cast<T*>(slot)->~T();
+                }
+            }
+            try {
+                pool.deallocate(chunk);
+            } catch (const MemoryPoolException&) {
+                // 内存池已记录错误，析构中不再抛出
+            }
+            newest = false;
+            chunk = next;
         }
     }
     
-    void set_error_logger(std::function<void(const std::string&)> logger) {
-        if (thread_safe) {
-            ScopedLock pool_lock(pool_mutex);
-            error_logger = logger;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    
+    // 普通模式：用args在槽位上构造对象。保留构造模式：返回之前destroy的对象，
+    // 没有时默认构造一个新对象，不接受参数
+    template<typename... Args>
+    T* make(Args&&... args) {
+        if constexpr (KeepConstructed) {
+            static_assert(sizeof...(Args) == 0, "KeepConstructed pools only default-construct");
+            return with_lock([this]() { return acquire_constructed(); });
         } else {
-            error_logger = logger;
+            // 构造在锁外进行，构造抛出异常时归还槽位
+            char* slot = with_lock([this]() { return acquire_slot(); });
+            try {
+                return new (slot) T(std::forward<Args>(args)...);
+            } catch (...) {
+                with_lock([this, slot]() { release_slot(slot); });
+                throw;
+            }
         }
     }
     
-private:
-    // 内部实现方法
-    void* allocate_from_pool(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
-        // 计算需要的块大小
-        size_t block_size = calculate_block_size(size);
+    void destroy(T* object) {
+        if (!object) {
+            return;
+        }
+        if (!KeepConstructed) {
+            object->~T();
+        }
+        with_lock([this, object]() { release_slot(reinterpret_cast<char*>(object)); });
+    }
+    
+    size_t get_live_count() const {
+        std::lock_guard<mutex_type> lock(mutex);
+        return live_count;
+    }
+    
+    // 已从内存池取得的槽位数
+    size_t get_capacity() const {
+        std::lock_guard<mutex_type> lock(mutex);
+        return capacity;
+    }
+    
+    static constexpr size_t slot_size() {
+        return SLOT_SIZE;
+    }
+};
+
+// 跨进程共享内存池：头部、阶数表、空闲位图和堆都位于同一个memfd或shm_open对象的MAP_SHARED映射中，
+// 各进程可以把它映射到不同的地址。元数据只保存相对映射起始的偏移，空闲块中的链表节点也是偏移，
+// 自由链表由进程间共享的健壮互斥锁保护。一个进程分配的块可以把偏移交给另一个进程读取和释放，
+// 不需要复制数据。容量在创建时固定；没有slab、线程缓存、大对象层和统计策略
+class SharedMemoryPool {
+public:
+    static constexpr uint64_t MAGIC = 0x4c4f4f504d485353ULL;  // "SSHMPOOL"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t MAX_FREE_LISTS = 48;
+    
+protected:
+    // 空闲块起始处的链表节点，前后块以映射内偏移表示，0表示没有（偏移0是头部）
+    struct FreeBlock {
+        uint64_t next;
+        uint64_t prev;
+    };
+    
+    // 映射起始处的头部，所有字段都与映射地址无关
+    struct Header {
+        std::atomic<uint64_t> magic;            // 创建者初始化完成后最后写入
+        uint32_t version;
+        uint32_t free_list_count;
+        uint64_t mapping_size;
+        uint64_t min_block_size;
+        uint64_t max_block_size;
+        uint64_t heap_offset;                   // 堆的起始偏移，页对齐
+        uint64_t heap_size;                     // 最大块大小的整数倍
+        uint64_t order_map_offset;              // 每个最小块一个字节：已分配块起始处为阶数+1，其余为0
+        uint64_t bitmap_offsets[MAX_FREE_LISTS]; // 每阶一个位图：位i表示第i个该阶大小的块在自由链表中
+        uint64_t free_heads[MAX_FREE_LISTS];    // 各阶自由链表头
+        uint64_t used_bytes;                    // 已分配块字节数
+        uint64_t allocation_count;
+        uint64_t deallocation_count;
+        uint64_t recovered_lock_count;          // 持锁进程退出后由其他进程接管锁的次数
+        uint64_t root_offset;                   // 应用的根对象，0表示未设置
+        uint32_t state;                         // 持久化内存池的打开状态
+        uint32_t reserved;
+        pthread_mutex_t mutex;                  // PTHREAD_PROCESS_SHARED | PTHREAD_MUTEX_ROBUST
+    };
+    static_assert(sizeof(Header) <= PageMap::PAGE_SIZE, "header must fit in the first page");
+    
+    int fd;
+    std::string name;       // shm_open的名字，匿名memfd时为空
+    char* base;             // 本进程中的映射地址
+    size_t mapping_length;  // 本进程的映射长度
+    Header* header;
+    size_t min_block_shift;
+    
+    // 进程间锁。持锁进程异常退出时，下一个加锁者收到EOWNERDEAD：被中断的操作可能让自由链表
+    // 停在中间状态，以阶数表为准重建后把锁标记为一致。锁和元数据都在映射中，const方法也可以加锁
+    class ScopedLock {
+    private:
+        SharedMemoryPool* pool;
+        Header* header;
         
-        // 检查是否超过最大块大小
-        if (block_size > max_block_size) {
-            handle_error("Requested size exceeds maximum block size", ErrorType::OUT_OF_MEMORY);
-            throw MemoryPoolException("Requested size exceeds maximum block size", ErrorType::OUT_OF_MEMORY);
+    public:
+        explicit ScopedLock(const SharedMemoryPool* p)
+            : pool(const_cast<SharedMemoryPool*>(p)), header(p->header) {
+            int rc = pthread_mutex_lock(&header->mutex);
+            if (rc == EOWNERDEAD) {
+                pool->rebuild_free_lists();
+                header->recovered_lock_count++;
+                pthread_mutex_consistent(&header->mutex);
+            } else if (rc != 0) {
+                throw MemoryPoolException("Failed to lock shared memory pool", ErrorType::UNKNOWN_ERROR);
+            }
         }
         
-        // 计算对应的自由链表索引
-        size_t list_index = static_cast<size_t>(log2(block_size) - log2(min_block_size));
+        ~ScopedLock() {
+            pthread_mutex_unlock(&header->mutex);
+        }
         
-        // 尝试从对应的自由链表获取块
-        void* result = allocate_from_free_list(list_index, block_size);
+        ScopedLock(const ScopedLock&) = delete;
+        ScopedLock& operator=(const ScopedLock&) = delete;
+    };
+    
+public:
+    // 创建容量为capacity字节（向上取整到最大块大小）的共享池。name为空时使用匿名memfd，
+    // 通过fork继承或SCM_RIGHTS传递get_fd()共享；否则用shm_open创建，名字已存在时失败
+    SharedMemoryPool(const std::string& shm_name, size_t capacity,
+                     size_t min_blk_size = MIN_BLOCK_SIZE, size_t max_blk_size = MAX_BLOCK_SIZE)
+        : SharedMemoryPool() {
+        name = shm_name;
+        if (name.empty()) {
+            fd = memfd_create("mpool_shared", MFD_CLOEXEC);
+        } else {
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        if (fd < 0) {
+            throw MemoryPoolException("Failed to create shared memory object", ErrorType::OUT_OF_MEMORY);
+        }
         
-        if (!result) {
-            // 如果没有可用块，尝试扩展内存池
-            expand_pool(block_size);
-            
-            // 扩展后再次尝试分配
-            result = allocate_from_free_list(list_index, block_size);
-            
-            if (!result) {
-                handle_error("Failed to allocate memory after pool expansion", ErrorType::OUT_OF_MEMORY);
-                throw MemoryPoolException("Failed to allocate memory after pool expansion", ErrorType::OUT_OF_MEMORY);
+        try {
+            format(capacity, min_blk_size, max_blk_size);
+        } catch (...) {
+            close_mapping();
+            if (!name.empty()) {
+                shm_unlink(name.c_str());
             }
+            throw;
         }
-        
-        return result;
     }
     
-    void* allocate_from_free_list(size_t list_index, size_t block_size) {
-        // 检查索引是否有效
-        if (list_index >= free_list_count) {
+    // 按名字打开其他进程用shm_open创建的共享池
+    explicit SharedMemoryPool(const std::string& shm_name) : SharedMemoryPool() {
+        name = shm_name;
+        fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw MemoryPoolException("Failed to open shared memory object: " + name, ErrorType::UNKNOWN_ERROR);
+        }
+        attach();
+    }
+    
+    // 映射通过fork继承或SCM_RIGHTS收到的描述符，fd被复制，调用者仍负责关闭自己的fd
+    explicit SharedMemoryPool(int shared_fd) : SharedMemoryPool() {
+        fd = fcntl(shared_fd, F_DUPFD_CLOEXEC, 0);
+        if (fd < 0) {
+            throw MemoryPoolException("Invalid shared memory descriptor", ErrorType::UNKNOWN_ERROR);
+        }
+        attach();
+    }
+    
+    // 只解除本进程的映射；shm_open创建的对象需要用remove删除名字
+    ~SharedMemoryPool() {
+        close_mapping();
+    }
+    
+    // 禁用拷贝构造和赋值操作
+    SharedMemoryPool(const SharedMemoryPool&) = delete;
+    SharedMemoryPool& operator=(const SharedMemoryPool&) = delete;
+    
+    // 删除shm_open对象的名字，已经打开的进程不受影响
+    static bool remove(const std::string& shm_name) {
+        return shm_unlink(shm_name.c_str()) == 0;
+    }
+    
+    // 内存分配和释放。块按自身大小对齐（不超过页大小），alignment不能超过页大小
+    void* allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+        if (size == 0) {
             return nullptr;
         }
+        if (alignment > PageMap::PAGE_SIZE || (alignment & (alignment - 1)) != 0) {
+            throw MemoryPoolException("Unsupported alignment for shared memory pool", ErrorType::INVALID_ALIGNMENT);
+        }
         
-        // 尝试从当前链表获取块
-        MemoryBlockDescriptor* block = free_lists[list_index].pop();
-        
-        if (block) {
-            // 标记为已分配
-            block->set_allocated(true);
-            return block->get_address();
+        size_t block_size = header->min_block_size;
+        while (block_size < std::max(size, alignment)) {
+            block_size <<= 1;
+        }
+        if (block_size > header->max_block_size) {
+            throw MemoryPoolException("Requested size exceeds maximum block size", ErrorType::OUT_OF_MEMORY);
         }
+        size_t list_index = floor_log2(block_size) - min_block_shift;
         
-        // 如果当前链表为空，尝试从更大的链表分割块
-        for (size_t i = list_index + 1; i < free_list_count; ++i) {
-            MemoryBlockDescriptor* larger_block = free_lists[i].pop();
+        ScopedLock lock(this);
+        for (size_t i = list_index; i < header->free_list_count; ++i) {
+            uint64_t block = header->free_heads[i];
+            if (block == 0) {
+                continue;
+            }
             
-            if (larger_block) {
-                // 分割大块
-                split_block(larger_block, list_index);
-                
-                // 再次尝试从当前链表获取块
-                block = free_lists[list_index].pop();
-                
-                if (block) {
-                    // 标记为已分配
-                    block->set_allocated(true);
-                    return block->get_address();
-                }
+            uint64_t relative = block - header->heap_offset;
+            remove_free_block(relative, i);
+            
+            // 逐级对半分割，后半块放回自由链表
+            while (i > list_index) {
+                i--;
+                push_free_block(relative + (header->min_block_size << i), i);
             }
+            
+            order_map()[relative >> min_block_shift] = static_cast<uint8_t>(list_index + 1);
+            header->used_bytes += block_size;
+            header->allocation_count++;
+            return base + block;
         }
         
-        return nullptr;
+        throw MemoryPoolException("Shared memory pool is full", ErrorType::POOL_FULL);
     }
     
-    void deallocate_from_pool(void* ptr) {
-        // 检查指针是否有效
-        if (!is_valid_pointer_internal(ptr)) {
-            stats.update_invalid_pointer_error();
-            handle_error("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
-            throw MemoryPoolException("Invalid pointer passed to deallocate", ErrorType::INVALID_POINTER);
+    // 可以释放任何进程分配的块
+    void deallocate(void* ptr) {
+        if (!ptr) {
+            return;
         }
         
-        // 获取块大小
-        size_t size = get_block_size_internal(ptr);
-        
-        // 计算对应的自由链表索引
-        size_t list_index = static_cast<size_t>(log2(size) - log2(min_block_size));
-        
-        // 创建新的块描述符
-        MemoryBlockDescriptor* block = new MemoryBlockDescriptor(ptr, size, false);
+        ScopedLock lock(this);
+        size_t list_index = block_list_index(ptr);
+        if (list_index == SIZE_MAX) {
+            throw MemoryPoolException("Invalid pointer passed to shared pool deallocate", ErrorType::INVALID_POINTER);
+        }
         
-        // 将块添加到自由链表
-        free_lists[list_index].push(block);
+        uint64_t relative = offset_of(ptr) - header->heap_offset;
+        order_map()[relative >> min_block_shift] = 0;
+        header->used_bytes -= header->min_block_size << list_index;
+        header->deallocation_count++;
         
-        // 尝试合并伙伴块
-        merge_blocks(block);
+        // 通过空闲位图判断伙伴是否空闲，逐级向上合并
+        while (list_index + 1 < header->free_list_count) {
+            uint64_t buddy = relative ^ (header->min_block_size << list_index);
+            if (!is_block_free(buddy, list_index)) {
+                break;
+            }
+            remove_free_block(buddy, list_index);
+            relative = std::min(relative, buddy);
+            list_index++;
+        }
+        push_free_block(relative, list_index);
     }
     
-    void split_block(MemoryBlockDescriptor* block, size_t target_list_index) {
-        // 获取当前块的大小
-        size_t current_size = block->get_size();
-        size_t current_list_index = static_cast<size_t>(log2(current_size) - log2(min_block_size));
-        
-        // 如果当前链表已经是目标链表，无需分割
-        if (current_list_index <= target_list_index) {
-            free_lists[current_list_index].push(block);
-            return;
+    // 地址与映射内偏移的转换，偏移可以在进程之间传递；0表示空指针
+    uint64_t offset_of(const void* ptr) const {
+        return ptr ? static_cast<uint64_t>(static_cast<const char*>(ptr) - base) : 0;
+    }
+    
+    void* address_of(uint64_t offset) const {
+        return offset ? base + offset : nullptr;
+    }
+    
+    // 查询方法
+    bool is_valid_pointer(void* ptr) const {
+        return get_block_size(ptr) != 0;
+    }
+    
+    // 返回已分配块的大小；ptr不是某个存活分配的起始地址时返回0
+    size_t get_block_size(void* ptr) const {
+        if (!ptr) {
+            return 0;
+        }
+        ScopedLock lock(this);
+        size_t list_index = block_list_index(ptr);
+        return list_index == SIZE_MAX ? 0 : header->min_block_size << list_index;
+    }
+    
+    size_t get_capacity() const {
+        return header->heap_size;
+    }
+    
+    size_t get_used_memory() const {
+        ScopedLock lock(this);
+        return header->used_bytes;
+    }
+    
+    size_t get_allocation_count() const {
+        ScopedLock lock(this);
+        return header->allocation_count;
+    }
+    
+    size_t get_deallocation_count() const {
+        ScopedLock lock(this);
+        return header->deallocation_count;
+    }
+    
+    size_t get_recovered_lock_count() const {
+        ScopedLock lock(this);
+        return header->recovered_lock_count;
+    }
+    
+    // 应用的根对象偏移：重新映射或重启后从这里找到池中的数据结构
+    void set_root(uint64_t offset) {
+        ScopedLock lock(this);
+        header->root_offset = offset;
+    }
+    
+    uint64_t get_root() const {
+        ScopedLock lock(this);
+        return header->root_offset;
+    }
+    
+    int get_fd() const {
+        return fd;
+    }
+    
+    const std::string& get_name() const {
+        return name;
+    }
+    
+protected:
+    SharedMemoryPool() : fd(-1), base(nullptr), mapping_length(0), header(nullptr), min_block_shift(0) {}
+    
+    // 在空的fd上建立共享池：扩展到所需长度并映射，写好头部后把整个堆切成最大块。
+    // ftruncate得到的内容全为零，阶数表和位图不需要初始化
+    void format(size_t capacity, size_t min_blk_size, size_t max_blk_size) {
+        if (min_blk_size < sizeof(FreeBlock) || (min_blk_size & (min_blk_size - 1)) != 0 ||
+            max_blk_size < min_blk_size || (max_blk_size & (max_blk_size - 1)) != 0 ||
+            floor_log2(max_blk_size / min_blk_size) + 1 > MAX_FREE_LISTS || capacity == 0) {
+            throw MemoryPoolException("Invalid shared memory pool geometry", ErrorType::INVALID_ALIGNMENT);
         }
         
-        // 分割块
-        size_t new_size = current_size / 2;
-        void* addr = block->get_address();
-        
-        // 创建第一个子块
-        MemoryBlockDescriptor* first_block = new MemoryBlockDescriptor(addr, new_size, false);
-        
-        // 创建第二个子块（伙伴块）
-        void* second_addr = static_cast<char*>(addr) + new_size;
-        MemoryBlockDescriptor* second_block = new MemoryBlockDescriptor(second_addr, new_size, false);
-        
-        // 将子块添加到对应的自由链表
-        size_t new_list_index = static_cast<size_t>(log2(new_size) - log2(min_block_size));
-        free_lists[new_list_index].push(first_block);
-        free_lists[new_list_index].push(second_block);
+        size_t free_list_count = floor_log2(max_blk_size / min_blk_size) + 1;
+        size_t heap_size = MemoryAlignment::align_up(capacity, max_blk_size);
         
-        // 更新碎片统计
-        stats.update_fragmentation(1);
+        // 布局：头部、阶数表、各阶位图，堆从下一页开始
+        uint64_t order_map_offset = MemoryAlignment::align_up(sizeof(Header), 64);
+        uint64_t offset = order_map_offset + heap_size / min_blk_size;
+        uint64_t bitmap_offsets[MAX_FREE_LISTS] = {};
+        for (size_t i = 0; i < free_list_count; ++i) {
+            offset = MemoryAlignment::align_up(offset, 8);
+            bitmap_offsets[i] = offset;
+            offset += ((heap_size / (min_blk_size << i)) + 63) / 64 * 8;
+        }
+        uint64_t heap_offset = MemoryAlignment::align_up(offset, PageMap::PAGE_SIZE);
+        uint64_t mapping_size = heap_offset + heap_size;
         
-        // 释放原始块
-        delete block;
+        if (ftruncate(fd, static_cast<off_t>(mapping_size)) != 0 || !map(mapping_size)) {
+            throw MemoryPoolException("Failed to map shared memory pool", ErrorType::OUT_OF_MEMORY);
+        }
         
-        // 递归分割，直到达到目标大小
-        if (new_list_index > target_list_index) {
-            split_block(first_block, target_list_index);
+        header->version = VERSION;
+        header->free_list_count = static_cast<uint32_t>(free_list_count);
+        header->mapping_size = mapping_size;
+        header->min_block_size = min_blk_size;
+        header->max_block_size = max_blk_size;
+        header->heap_offset = heap_offset;
+        header->heap_size = heap_size;
+        header->order_map_offset = order_map_offset;
+        std::memcpy(header->bitmap_offsets, bitmap_offsets, sizeof(bitmap_offsets));
+        min_block_shift = floor_log2(min_blk_size);
+        initialize_lock();
+        
+        for (uint64_t block = 0; block < heap_size; block += max_blk_size) {
+            push_free_block(block, free_list_count - 1);
         }
+        
+        header->magic.store(MAGIC, std::memory_order_release);
+    }
+    
+    void initialize_lock() {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
     }
     
-    void merge_blocks(MemoryBlockDescriptor* block) {
-        if (block->is_allocated()) {
-            return; // 已分配的块不能合并
+    // 调用者需持有锁或独占映射。阶数表是唯一的权威记录：清空各阶自由链表和空闲位图，
+    // 每个最大块自顶向下检查，范围内没有已分配块起始位置的部分整体成为空闲块。
+    // 与阶数不符的记录（中断的操作留下的）视为空闲
+    void rebuild_free_lists() {
+        for (size_t i = 0; i < header->free_list_count; ++i) {
+            header->free_heads[i] = 0;
+            size_t words = ((header->heap_size / (header->min_block_size << i)) + 63) / 64;
+            std::memset(free_bitmap(i), 0, words * sizeof(uint64_t));
         }
+        header->used_bytes = 0;
         
-        // 查找伙伴块
-        MemoryBlockDescriptor* buddy = find_buddy(block);
-        
-        // 检查伙伴块是否存在且空闲
-        if (buddy && !buddy->is_allocated() && buddy->get_size() == block->get_size()) {
-            // 从自由链表中移除伙伴块
-            size_t list_index = static_cast<size_t>(log2(block->get_size()) - log2(min_block_size));
-            free_lists[list_index].remove(buddy);
-            
-            // 创建新的合并块
-            void* new_addr = std::min(block->get_address(), buddy->get_address());
-            size_t new_size = block->get_size() * 2;
-            MemoryBlockDescriptor* merged_block = new MemoryBlockDescriptor(new_addr, new_size, false);
-            
-            // 将合并块添加到对应的自由链表
-            size_t new_list_index = static_cast<size_t>(log2(new_size) - log2(min_block_size));
-            if (new_list_index < free_list_count) {
-                free_lists[new_list_index].push(merged_block);
-            }
-            
-            // 释放原来的块描述符
-            delete block;
-            delete buddy;
-            
-            // 更新碎片统计
-            stats.update_fragmentation(-1);
-            
-            // 递归尝试继续合并
-            merge_blocks(merged_block);
+        for (uint64_t block = 0; block < header->heap_size; block += header->max_block_size) {
+            rebuild_block(block, header->free_list_count - 1);
         }
     }
     
-    MemoryBlockDescriptor* find_buddy(MemoryBlockDescriptor* block) {
-        if (!block) {
-            return nullptr;
+    void rebuild_block(uint64_t relative, size_t list_index) {
+        uint8_t* entry = &order_map()[relative >> min_block_shift];
+        if (*entry == list_index + 1) {
+            header->used_bytes += header->min_block_size << list_index;
+            return;
+        }
+        if (*entry > list_index + 1 || (*entry != 0 && list_index == 0)) {
+            *entry = 0;
         }
         
-        // 计算伙伴地址
-        void* buddy_addr = block->calculate_buddy_address();
-        
-        // 在对应的自由链表中查找伙伴块
-        size_t list_index = static_cast<size_t>(log2(block->get_size()) - log2(min_block_size));
-        
-        MemoryBlockDescriptor* current = free_lists[list_index].get_head();
-        while (current) {
-            if (current->get_address() == buddy_addr) {
-                return current;
-            }
-            current = current->get_next();
+        if (order_map_range_empty(relative >> min_block_shift, size_t(1) << list_index)) {
+            push_free_block(relative, list_index);
+            return;
         }
         
-        return nullptr;
+        uint64_t half = header->min_block_size << (list_index - 1);
+        rebuild_block(relative, list_index - 1);
+        rebuild_block(relative + half, list_index - 1);
     }
     
-    size_t calculate_block_size(size_t requested_size) {
-        // 确保块大小至少为最小块大小
-        size_t size = std::max(requested_size, min_block_size);
-        
-        // 计算向上对齐的2的幂次方
-        size_t power = 1;
-        while (power < size) {
-            power <<= 1;
+    // 阶数表[first, first + count)是否全为零，按8字节一组比较
+    bool order_map_range_empty(size_t first, size_t count) const {
+        const uint8_t* bytes = order_map() + first;
+        size_t i = 0;
+        for (; i < count && (reinterpret_cast<uintptr_t>(bytes + i) & 7) != 0; ++i) {
+            if (bytes[i]) {
+                return false;
+            }
         }
-        
-        return power;
+        for (; i + 8 <= count; i += 8) {
+            if (*reinterpret_cast<const uint64_t*>(bytes + i)) {
+                return false;
+            }
+        }
+        for (; i < count; ++i) {
+            if (bytes[i]) {
+                return false;
+            }
+        }
+        return true;
     }
     
-    void initialize_pool(size_t initial_size) {
-        // 分配初始内存
-        void* memory = allocate_system_memory(initial_size);
-        
-        if (!memory) {
-            handle_error("Failed to allocate initial memory pool", ErrorType::OUT_OF_MEMORY);
-            throw MemoryPoolException("Failed to allocate initial memory pool", ErrorType::OUT_OF_MEMORY);
+    bool map(size_t mapping_size) {
+        void* memory = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory == MAP_FAILED) {
+            return false;
         }
-        
-        // 添加到内存段列表
-        add_memory_segment(memory, initial_size);
-        
-        // 初始化自由链表
-        initialize_free_lists();
+        base = static_cast<char*>(memory);
+        mapping_length = mapping_size;
+        header = reinterpret_cast<Header*>(base);
+        return true;
     }
     
-    void initialize_free_lists() {
-        // 清空所有自由链表
-        for (size_t i = 0; i < free_list_count; ++i) {
-            free_lists[i].clear();
+    // 映射已有的共享池并校验头部
+    void attach() {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header) ||
+            !map(static_cast<size_t>(info.st_size))) {
+            close_mapping();
+            throw MemoryPoolException("Failed to map shared memory pool", ErrorType::UNKNOWN_ERROR);
         }
         
-        // 遍历所有内存段，初始化自由链表
-        for (const auto& segment : memory_segments) {
-            initialize_segment(segment.base, segment.size);
+        if (header->magic.load(std::memory_order_acquire) != MAGIC || header->version != VERSION ||
+            header->mapping_size != static_cast<uint64_t>(info.st_size)) {
+            close_mapping();
+            throw MemoryPoolException("Shared memory object is not an initialized pool", ErrorType::UNKNOWN_ERROR);
+        }
+        
+        if (!header_is_consistent()) {
+            close_mapping();
+            throw MemoryPoolException("Shared memory pool header is corrupted", ErrorType::UNKNOWN_ERROR);
         }
+        min_block_shift = floor_log2(header->min_block_size);
+    }
+    
+    // [offset, offset + length)是否在映射范围内
+    bool region_in_mapping(uint64_t offset, uint64_t length) const {
+        return offset <= header->mapping_size && length <= header->mapping_size - offset;
     }
     
-    void initialize_segment(void* base, size_t size) {
-        // 将内存段分割为最大块
-        size_t block_size = max_block_size;
-        size_t remaining_size = size;
-        void* current_addr = base;
+    // 头部来自文件或其他进程，使用前检查块大小与阶数是否自洽，
+    // 以及阶数表、各阶位图、堆和自由链表头是否都落在映射之内
+    bool header_is_consistent() const {
+        uint64_t min_blk_size = header->min_block_size;
+        uint64_t max_blk_size = header->max_block_size;
+        if (min_blk_size < sizeof(FreeBlock) || (min_blk_size & (min_blk_size - 1)) != 0 ||
+            max_blk_size < min_blk_size || (max_blk_size & (max_blk_size - 1)) != 0 ||
+            header->free_list_count == 0 || header->free_list_count > MAX_FREE_LISTS ||
+            header->free_list_count != floor_log2(max_blk_size / min_blk_size) + 1) {
+            return false;
+        }
         
-        while (remaining_size >= block_size) {
-            // 创建块描述符
-            MemoryBlockDescriptor* block = new MemoryBlockDescriptor(current_addr, block_size, false);
-            
-            // 计算对应的自由链表索引
-            size_t list_index = static_cast<size_t>(log2(block_size) - log2(min_block_size));
-            
-            // 将块添加到自由链表
-            free_lists[list_index].push(block);
-            
-            // 移动到下一个块
-            current_addr = static_cast<char*>(current_addr) + block_size;
-            remaining_size -= block_size;
+        uint64_t heap_size = header->heap_size;
+        if (heap_size == 0 || heap_size % max_blk_size != 0 || header->heap_offset < sizeof(Header) ||
+            header->heap_offset % PageMap::PAGE_SIZE != 0 || !region_in_mapping(header->heap_offset, heap_size) ||
+            !region_in_mapping(header->order_map_offset, heap_size / min_blk_size)) {
+            return false;
         }
         
-        // 处理剩余的小块
-        if (remaining_size >= min_block_size) {
-            // 为剩余部分找到合适的块大小
-            size_t remaining_block_size = min_block_size;
-            while (remaining_block_size * 2 <= remaining_size) {
-                remaining_block_size *= 2;
+        for (size_t i = 0; i < header->free_list_count; ++i) {
+            uint64_t bitmap_bytes = ((heap_size / (min_blk_size << i)) + 63) / 64 * 8;
+            if (header->bitmap_offsets[i] % 8 != 0 || !region_in_mapping(header->bitmap_offsets[i], bitmap_bytes)) {
+                return false;
             }
             
-            // 创建块描述符
-            MemoryBlockDescriptor* block = new MemoryBlockDescriptor(current_addr, remaining_block_size, false);
-            
-            // 计算对应的自由链表索引
-            size_t list_index = static_cast<size_t>(log2(remaining_block_size) - log2(min_block_size));
-            
-            // 将块添加到自由链表
-            free_lists[list_index].push(block);
+            uint64_t head = header->free_heads[i];
+            if (head != 0 && (head < header->heap_offset || head - header->heap_offset >= heap_size ||
+                              (head - header->heap_offset) % (min_blk_size << i) != 0)) {
+                return false;
+            }
         }
+        return true;
     }
     
-    void add_memory_segment(void* base, size_t size) {
-        memory_segments.emplace_back(base, size, true);
-        stats.set_total_memory(stats.get_total_memory() + size);
+    void close_mapping() {
+        if (base) {
+            munmap(base, mapping_length);
+            base = nullptr;
+            header = nullptr;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
     }
     
-    void release_all_segments() {
-        for (auto& segment : memory_segments) {
-            if (segment.owned && segment.base) {
-                deallocate_system_memory(segment.base, segment.size);
-            }
+    // 调用者需持有锁。ptr不是存活分配的起始地址时返回SIZE_MAX
+    size_t block_list_index(const void* ptr) const {
+        uint64_t offset = static_cast<uint64_t>(static_cast<const char*>(ptr) - base);
+        if (static_cast<const char*>(ptr) < base || offset < header->heap_offset ||
+            offset >= header->heap_offset + header->heap_size) {
+            return SIZE_MAX;
         }
-        memory_segments.clear();
+        uint64_t relative = offset - header->heap_offset;
+        if (relative & (header->min_block_size - 1)) {
+            return SIZE_MAX;
+        }
+        uint8_t entry = order_map()[relative >> min_block_shift];
+        return entry == 0 ? SIZE_MAX : entry - 1;
     }
     
-    void* allocate_system_memory(size_t size) {
-        // 使用系统分配函数
-        void* memory = std::malloc(size);
-        
-        if (memory) {
-            // 清零内存
-            std::memset(memory, 0, size);
-        }
-        
-        return memory;
+    uint8_t* order_map() const {
+        return reinterpret_cast<uint8_t*>(base + header->order_map_offset);
     }
     
-    void deallocate_system_memory(void* ptr, size_t size) {
-        // 使用系统释放函数
-        std::free(ptr);
+    uint64_t* free_bitmap(size_t list_index) const {
+        return reinterpret_cast<uint64_t*>(base + header->bitmap_offsets[list_index]);
     }
     
-    void expand_pool(size_t required_size) {
-        // 计算需要扩展的大小
-        size_t current_total = 0;
-        for (const auto& segment : memory_segments) {
-            current_total += segment.size;
-        }
-        
-        size_t expand_size = static_cast<size_t>(current_total * (growth_factor - 1.0));
-        expand_size = std::max(expand_size, required_size);
-        
-        // 确保扩展大小是最大块大小的整数倍
-        expand_size = MemoryAlignment::align_up(expand_size, max_block_size);
-        
-        // 检查是否超过最大内存限制
-        if (max_memory_limit > 0 && current_total + expand_size > max_memory_limit) {
-            handle_error("Memory pool has reached maximum size limit", ErrorType::POOL_FULL);
-            throw MemoryPoolException("Memory pool has reached maximum size limit", ErrorType::POOL_FULL);
-        }
-        
-        // 分配新的内存段
-        void* new_segment = allocate_system_memory(expand_size);
-        
-        if (!new_segment) {
-            handle_error("Failed to allocate system memory for pool expansion", ErrorType::OUT_OF_MEMORY);
-            throw MemoryPoolException("Failed to allocate system memory for pool expansion", ErrorType::OUT_OF_MEMORY);
+    FreeBlock* free_block(uint64_t offset) const {
+        return reinterpret_cast<FreeBlock*>(base + offset);
+    }
+    
+    // 以下方法的调用者需持有锁，relative是块相对堆起始的偏移
+    bool is_block_free(uint64_t relative, size_t list_index) const {
+        uint64_t bit = relative >> (min_block_shift + list_index);
+        return (free_bitmap(list_index)[bit / 64] >> (bit % 64)) & 1;
+    }
+    
+    void set_free_bit(uint64_t relative, size_t list_index, bool free) {
+        uint64_t bit = relative >> (min_block_shift + list_index);
+        uint64_t mask = uint64_t(1) << (bit % 64);
+        if (free) {
+            free_bitmap(list_index)[bit / 64] |= mask;
+        } else {
+            free_bitmap(list_index)[bit / 64] &= ~mask;
         }
-        
-        // 添加到内存段列表
-        add_memory_segment(new_segment, expand_size);
-        
-        // 初始化新段的自由链表
-        initialize_segment(new_segment, expand_size);
     }
     
-    void reset_pool() {
-        // 清空所有自由链表
-        for (size_t i = 0; i < free_list_count; ++i) {
-            free_lists[i].clear();
+    void push_free_block(uint64_t relative, size_t list_index) {
+        uint64_t offset = header->heap_offset + relative;
+        FreeBlock* block = free_block(offset);
+        block->prev = 0;
+        block->next = header->free_heads[list_index];
+        if (block->next) {
+            free_block(block->next)->prev = offset;
         }
-        
-        // 重新初始化自由链表
-        initialize_free_lists();
-        
-        // 重置统计信息
-        stats.reset();
+        header->free_heads[list_index] = offset;
+        set_free_bit(relative, list_index, true);
     }
     
-    bool is_valid_pointer_internal(void* ptr) const {
-        // 检查指针是否在任何内存段范围内
-        for (const auto& segment : memory_segments) {
-            char* base = static_cast<char*>(segment.base);
-            char* target = static_cast<char*>(ptr);
-            
-            if (target >= base && target < base + segment.size) {
-                return true;
-            }
+    void remove_free_block(uint64_t relative, size_t list_index) {
+        uint64_t offset = header->heap_offset + relative;
+        FreeBlock* block = free_block(offset);
+        if (block->prev) {
+            free_block(block->prev)->next = block->next;
+        } else {
+            header->free_heads[list_index] = block->next;
         }
-        
-        return false;
+        if (block->next) {
+            free_block(block->next)->prev = block->prev;
+        }
+        set_free_bit(relative, list_index, false);
     }
+};
+
+// 文件持久化内存池：共享内存池的整个映射就是一个普通文件（MAP_SHARED），进程重启后重新映射
+// 即可继续使用其中的数据，通过根对象偏移找到应用的数据结构。头部记录打开状态：上次正常关闭时
+// 只校验头部，打开时间与池大小无关；上次没有正常关闭时以阶数表为准重建自由链表和空闲位图。
+// 同一时刻只允许一个进程打开（flock），进程内可以多线程使用
+class PersistentMemoryPool : public SharedMemoryPool {
+private:
+    static constexpr uint32_t STATE_CLOSED = 1;  // 正常关闭
+    static constexpr uint32_t STATE_OPEN = 2;    // 打开中，再次打开时仍为该值说明上次没有正常关闭
     
-    size_t get_block_size_internal(void* ptr) const {
-        // 这是一个简化的实现，实际应用中可能需要更复杂的机制来存储和检索块大小
-        // 例如，可以在每个块前存储块大小的元数据
+    std::string path;
+    bool created = false;    // 本次打开时新建了池
+    bool recovered = false;  // 本次打开时做了崩溃恢复
+    
+public:
+    // 文件不存在或为空时按capacity和块大小新建；否则打开已有的池，忽略这三个参数
+    PersistentMemoryPool(const std::string& file_path, size_t capacity,
+                         size_t min_blk_size = MIN_BLOCK_SIZE, size_t max_blk_size = MAX_BLOCK_SIZE)
+        : path(file_path) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            throw MemoryPoolException("Failed to open persistent pool file: " + path, ErrorType::UNKNOWN_ERROR);
+        }
+        if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            throw MemoryPoolException("Persistent pool is opened by another process: " + path, ErrorType::UNKNOWN_ERROR);
+        }
         
-        // 遍历所有自由链表，查找包含该指针的块
-        for (size_t i = 0; i < free_list_count; ++i) {
-            MemoryBlockDescriptor* current = free_lists[i].get_head();
-            while (current) {
-                if (current->get_address() == ptr) {
-                    return current->get_size();
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            throw MemoryPoolException("Failed to stat persistent pool file: " + path, ErrorType::UNKNOWN_ERROR);
+        }
+        
+        if (info.st_size == 0) {
+            try {
+                format(capacity, min_blk_size, max_blk_size);
+            } catch (...) {
+                // 留下空文件，下次打开时重新建立
+                if (ftruncate(fd, 0) != 0) {
+                    // 文件已损坏，下次打开时attach会报错
                 }
-                current = current->get_next();
+                throw;
+            }
+            created = true;
+        } else {
+            attach();
+            // 文件锁保证没有其他进程在使用，上一个进程可能在持锁时退出，直接重新初始化锁
+            initialize_lock();
+            if (header->state != STATE_CLOSED) {
+                rebuild_free_lists();
+                recovered = true;
             }
         }
         
-        // 如果没有在自由链表中找到，假设这是一个已分配的块
-        // 在实际应用中，可能需要更复杂的机制来处理已分配的块
-        return min_block_size;
+        header->state = STATE_OPEN;
     }
     
-    void handle_error(const std::string& error_msg, ErrorType error_type) {
-        // 根据错误处理策略处理错误
-        switch (error_strategy) {
-            case ErrorHandlingStrategy::THROW_EXCEPTION:
-                throw MemoryPoolException(error_msg, error_type);
-                
-            case ErrorHandlingStrategy::RETURN_NULLPTR:
-                // 对于分配操作，返回空指针
-                // 对于释放操作，直接返回
-                break;
-                
-            case ErrorHandlingStrategy::LOG_ERROR:
-                if (error_logger) {
-                    error_logger(error_msg);
-                }
-                break;
-                
-            case ErrorHandlingStrategy::TERMINATE:
-                std::cerr << "Fatal error: " << error_msg << std::endl;
-                std::terminate();
-                break;
+    // 标记为正常关闭：先把整个映射同步写入文件，再写关闭状态并同步头部所在的页。
+    // 自由链表的前后偏移保存在堆中的空闲块里，正常关闭后再次打开时直接沿用，
+    // 所以关闭状态不能早于它们和元数据（头部、阶数表、位图）落盘。同步失败时保持打开状态，
+    // 下次打开时按阶数表恢复
+    ~PersistentMemoryPool() {
+        if (!header) {
+            return;
+        }
+        if (msync(base, mapping_length, MS_SYNC) != 0) {
+            return;
+        }
+        header->state = STATE_CLOSED;
+        msync(base, PageMap::PAGE_SIZE, MS_SYNC);
+    }
+    
+    // 把映射中的修改同步写入文件。只在调用flush之后，数据才能在系统崩溃或断电后保留下来
+    void flush() {
+        if (msync(base, mapping_length, MS_SYNC) != 0) {
+            throw MemoryPoolException("Failed to flush persistent pool: " + path, ErrorType::UNKNOWN_ERROR);
         }
     }
+    
+    bool was_created() const {
+        return created;
+    }
+    
+    bool was_recovered() const {
+        return recovered;
+    }
+    
+    const std::string& get_path() const {
+        return path;
+    }
 };
 
+#ifndef MPOOL_NO_MAIN
 int main() {
     std::cout << "内存池测试程序" << std::endl;
     
@@ -1537,6 +6806,8 @@ int main() {
         std::cout << "  最大释放时间: " << metrics.max_dealloc_time_ns << " 纳秒" << std::endl;
         std::cout << "  分配次数: " << metrics.allocation_count << std::endl;
         std::cout << "  释放次数: " << metrics.deallocation_count << std::endl;
+        std::cout << "  分配延迟 p50/p99/p99.9: " << metrics.alloc_latency.p50_ns << "/" << metrics.alloc_latency.p99_ns
+                  << "/" << metrics.alloc_latency.p999_ns << " 纳秒 (" << metrics.alloc_latency.samples << " 个样本)" << std::endl;
         
         // 获取健康报告
         auto health = pool.get_health_report();
@@ -1624,3 +6895,4 @@ int main() {
     
     return 0;
 }
+#endif
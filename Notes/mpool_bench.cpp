@@ -0,0 +1,1488 @@
+// 内存池性能基准测试，复用 mpool.cpp 中的实现
+// 编译: g++ -std=c++17 -O2 -pthread mpool_bench.cpp -o mpool_bench
+// 运行: ./mpool_bench [最大线程数] [每线程操作次数] [最大存活块数]
+
+#define MPOOL_NO_MAIN
+#include "mpool.cpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <random>
+#include <sys/wait.h>
+
+// 多线程扩展性测试：每个线程保持少量存活对象，循环分配/释放小块内存
+double run_thread_scaling(MemoryPool& pool, size_t thread_count, size_t ops_per_thread) {
+    std::vector<std::thread> threads;
+    std::atomic<bool> start{false};
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&pool, &start, ops_per_thread, t]() {
+            std::mt19937 rng(static_cast<unsigned>(t + 1));
+            std::uniform_int_distribution<size_t> size_dist(16, 512);
+
+            const size_t live_count = 32;
+            std::vector<void*> live(live_count, nullptr);
+
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                size_t slot = i % live_count;
+                if (live[slot]) {
+                    pool.deallocate(live[slot]);
+                }
+                live[slot] = pool.allocate(size_dist(rng));
+            }
+
+            for (void* ptr : live) {
+                pool.deallocate(ptr);
+            }
+        });
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+    // 每次循环包含一次分配和一次释放
+    return static_cast<double>(thread_count * ops_per_thread * 2) / seconds;
+}
+
+void benchmark_thread_scaling(size_t max_threads, size_t ops_per_thread) {
+    std::cout << "\n=== 线程扩展性测试 (ops/sec) ===" << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(16) << "locked"
+              << std::setw(16) << "thread_cache"
+              << std::setw(10) << "speedup" << std::endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double locked_ops = 0.0;
+        double cached_ops = 0.0;
+
+        {
+            MemoryPool pool(16 * 1024 * 1024);
+            locked_ops = run_thread_scaling(pool, threads, ops_per_thread);
+        }
+
+        {
+            MemoryPool pool(16 * 1024 * 1024);
+            pool.set_thread_cache_enabled(true);
+            cached_ops = run_thread_scaling(pool, threads, ops_per_thread);
+        }
+
+        std::cout << std::setw(8) << threads
+                  << std::setw(16) << std::fixed << std::setprecision(0) << locked_ops
+                  << std::setw(16) << cached_ops
+                  << std::setw(9) << std::setprecision(2) << cached_ops / locked_ops << "x" << std::endl;
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+// 计算已排序样本的百分位数
+template<typename T>
+T percentile(const std::vector<T>& sorted, double p) {
+    if (sorted.empty()) {
+        return T();
+    }
+    size_t index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[index];
+}
+
+struct ContentionResult {
+    double ops_per_sec = 0.0;
+    double p50_ns = 0.0;
+    double p99_ns = 0.0;
+    double p999_ns = 0.0;
+};
+
+// 单个自由链表的竞争测试：所有线程对同一链表反复pop/push
+template<typename List>
+ContentionResult run_free_list_contention(size_t thread_count, size_t ops_per_thread) {
+    List list(MIN_BLOCK_SIZE);
+    const size_t initial_blocks = thread_count * 64;
+    std::vector<char> arena(initial_blocks * MIN_BLOCK_SIZE);
+    for (size_t i = 0; i < initial_blocks; ++i) {
+        list.push(MemoryBlockDescriptor::create(arena.data() + i * MIN_BLOCK_SIZE));
+    }
+
+    std::vector<std::vector<uint32_t>> latencies(thread_count);
+    std::vector<std::thread> threads;
+    std::atomic<bool> start{false};
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&list, &start, &latencies, ops_per_thread, t]() {
+            std::vector<uint32_t>& samples = latencies[t];
+            samples.reserve(ops_per_thread);
+
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                MemoryBlockDescriptor* block = list.pop();
+                if (block) {
+                    list.push(block);
+                }
+                auto end = std::chrono::steady_clock::now();
+                samples.push_back(static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            }
+        });
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> all;
+    for (auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    ContentionResult result;
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+    result.ops_per_sec = static_cast<double>(thread_count * ops_per_thread * 2) / seconds;
+    result.p50_ns = percentile(all, 50.0);
+    result.p99_ns = percentile(all, 99.0);
+    result.p999_ns = percentile(all, 99.9);
+    return result;
+}
+
+void benchmark_free_list_contention(size_t max_threads, size_t ops_per_thread) {
+    std::cout << "\n=== 单链表竞争测试：互斥锁 vs 无锁 (pop+push) ===" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(10) << "policy"
+              << std::setw(16) << "ops/sec"
+              << std::setw(10) << "p50(ns)"
+              << std::setw(10) << "p99(ns)"
+              << std::setw(12) << "p99.9(ns)" << std::endl;
+
+    auto print_row = [](size_t threads, const char* policy, const ContentionResult& r) {
+        std::cout << std::setw(8) << threads << std::setw(10) << policy
+                  << std::setw(16) << std::fixed << std::setprecision(0) << r.ops_per_sec
+                  << std::setw(10) << r.p50_ns
+                  << std::setw(10) << r.p99_ns
+                  << std::setw(12) << r.p999_ns << std::endl;
+    };
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        print_row(threads, "mutex", run_free_list_contention<FreeList>(threads, ops_per_thread));
+        print_row(threads, "lockfree", run_free_list_contention<LockFreeFreeList>(threads, ops_per_thread));
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+// 内存池在单一阶数上的竞争测试：所有线程反复分配并释放同样大小的伙伴块，
+// 分配和释放都落在同一条自由链表上，只有自由链表同步策略不同
+template<typename FreeListPolicy>
+ContentionResult run_pool_free_list_contention(size_t thread_count, size_t ops_per_thread) {
+    using Pool = BasicMemoryPool<MutexLockPolicy, NullPoolStats, FactorGrowthPolicy, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE,
+                                 FreeListPolicy>;
+    const size_t block_size = 1024;
+    Pool pool(thread_count * 64 * block_size * 2);
+
+    std::vector<std::vector<uint32_t>> latencies(thread_count);
+    std::vector<std::thread> threads;
+    std::atomic<bool> start{false};
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&pool, &start, &latencies, ops_per_thread, t]() {
+            std::vector<uint32_t>& samples = latencies[t];
+            samples.reserve(ops_per_thread);
+
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                pool.deallocate(pool.allocate(block_size));
+                auto end = std::chrono::steady_clock::now();
+                samples.push_back(static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            }
+        });
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> all;
+    for (auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    ContentionResult result;
+    double seconds = std::chrono::duration<double>(end_time - start_time).count();
+    result.ops_per_sec = static_cast<double>(thread_count * ops_per_thread * 2) / seconds;
+    result.p50_ns = percentile(all, 50.0);
+    result.p99_ns = percentile(all, 99.0);
+    result.p999_ns = percentile(all, 99.9);
+    return result;
+}
+
+void benchmark_pool_free_list_contention(size_t max_threads, size_t ops_per_thread) {
+    std::cout << "\n=== 内存池单阶竞争测试：自由链表互斥锁 vs 无锁 (1KB allocate+deallocate) ===" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(10) << "policy"
+              << std::setw(16) << "ops/sec"
+              << std::setw(10) << "p50(ns)"
+              << std::setw(10) << "p99(ns)"
+              << std::setw(12) << "p99.9(ns)" << std::endl;
+
+    auto print_row = [](size_t threads, const char* policy, const ContentionResult& r) {
+        std::cout << std::setw(8) << threads << std::setw(10) << policy
+                  << std::setw(16) << std::fixed << std::setprecision(0) << r.ops_per_sec
+                  << std::setw(10) << r.p50_ns
+                  << std::setw(10) << r.p99_ns
+                  << std::setw(12) << r.p999_ns << std::endl;
+    };
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        print_row(threads, "mutex", run_pool_free_list_contention<MutexFreeListPolicy>(threads, ops_per_thread));
+        print_row(threads, "lockfree", run_pool_free_list_contention<LockFreeFreeListPolicy>(threads, ops_per_thread));
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+}
+
+// 释放开销随存活块数量的变化：先分配live_count个块，再随机释放并重新分配其中一部分
+double run_deallocation_cost(size_t live_count, size_t sample_count) {
+    MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> size_dist(16, 64);
+
+    std::vector<void*> live(live_count);
+    for (auto& ptr : live) {
+        ptr = pool.allocate(size_dist(rng));
+    }
+
+    std::vector<size_t> victims(sample_count);
+    std::uniform_int_distribution<size_t> index_dist(0, live_count - 1);
+    for (auto& index : victims) {
+        index = index_dist(rng);
+    }
+
+    std::chrono::nanoseconds total(0);
+    for (size_t index : victims) {
+        auto begin = std::chrono::steady_clock::now();
+        pool.deallocate(live[index]);
+        auto end = std::chrono::steady_clock::now();
+        total += std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin);
+
+        live[index] = pool.allocate(size_dist(rng));
+    }
+
+    return static_cast<double>(total.count()) / sample_count;
+}
+
+void benchmark_deallocation_cost(size_t max_live_count) {
+    std::cout << "\n=== 释放开销 vs 存活块数量 ===" << std::endl;
+    std::cout << std::setw(12) << "live_blocks" << std::setw(16) << "ns/dealloc" << std::endl;
+
+    for (size_t live_count = 1000; live_count <= max_live_count; live_count *= 10) {
+        double ns = run_deallocation_cost(live_count, 10000);
+        std::cout << std::setw(12) << live_count
+                  << std::setw(16) << std::fixed << std::setprecision(1) << ns << std::endl;
+    }
+}
+
+// 碎片化堆上的释放延迟：随机释放一半块制造大量小空闲块，再测量其余块的释放（含逐级合并）
+void benchmark_fragmented_free(size_t max_block_count) {
+    std::cout << "\n=== 碎片化堆释放延迟 ===" << std::endl;
+    std::cout << std::setw(12) << "blocks" << std::setw(14) << "free_blocks"
+              << std::setw(12) << "avg(ns)" << std::setw(12) << "p99(ns)" << std::endl;
+
+    for (size_t block_count = 10000; block_count <= max_block_count; block_count *= 10) {
+        MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+
+        std::mt19937 rng(7);
+        std::uniform_int_distribution<size_t> size_dist(16, 256);
+
+        std::vector<void*> blocks(block_count);
+        for (auto& ptr : blocks) {
+            ptr = pool.allocate(size_dist(rng));
+        }
+        std::shuffle(blocks.begin(), blocks.end(), rng);
+
+        size_t half = block_count / 2;
+        for (size_t i = 0; i < half; ++i) {
+            pool.deallocate(blocks[i]);
+        }
+
+        std::vector<uint32_t> samples;
+        samples.reserve(block_count - half);
+        for (size_t i = half; i < block_count; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            pool.deallocate(blocks[i]);
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+        }
+
+        double total = 0.0;
+        for (uint32_t ns : samples) {
+            total += ns;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        std::cout << std::setw(12) << block_count << std::setw(14) << half
+                  << std::setw(12) << std::fixed << std::setprecision(1) << total / samples.size()
+                  << std::setw(12) << percentile(samples, 99.0) << std::endl;
+    }
+}
+
+// 多内存段下的指针归属查询：增长因子为1.0时每次扩展只增加一个段
+void benchmark_segment_lookup() {
+    std::cout << "\n=== 内存段查找 (页映射) ===" << std::endl;
+    std::cout << std::setw(10) << "segments" << std::setw(16) << "ns/lookup" << std::endl;
+
+    for (size_t segment_count : {10, 100, 1000}) {
+        const size_t block_size = 64 * 1024;
+        MemoryPool pool(block_size, MIN_BLOCK_SIZE, block_size, false, 1.0);
+
+        std::vector<void*> blocks;
+        for (size_t i = 0; i < segment_count; ++i) {
+            blocks.push_back(pool.allocate(block_size));
+        }
+
+        std::mt19937 rng(3);
+        std::uniform_int_distribution<size_t> index_dist(0, blocks.size() - 1);
+        const size_t lookups = 1000000;
+        size_t checksum = 0;
+
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; ++i) {
+            checksum += pool.get_block_size(blocks[index_dist(rng)]);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count() / lookups;
+        std::cout << std::setw(10) << segment_count
+                  << std::setw(16) << std::fixed << std::setprecision(1) << ns
+                  << (checksum == 0 ? " (invalid)" : "") << std::endl;
+
+        for (void* ptr : blocks) {
+            pool.deallocate(ptr);
+        }
+    }
+}
+
+// 当前进程的常驻内存（Linux）
+size_t resident_bytes() {
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> total_pages >> resident_pages;
+    return resident_pages * PageMap::PAGE_SIZE;
+}
+
+// 启动与扩展延迟：内存段按需清零，构造和扩展的耗时与常驻内存不再随段大小线性增长。
+// 对照组为旧实现的分配方式（aligned_alloc + memset）
+void benchmark_startup_latency() {
+    std::cout << "\n=== 启动延迟 (构造内存池) ===" << std::endl;
+    std::cout << std::setw(10) << "size(MB)" << std::setw(14) << "mmap(us)" << std::setw(14) << "rss(KB)"
+              << std::setw(18) << "memset(us)" << std::setw(14) << "rss(KB)" << std::endl;
+
+    for (size_t megabytes : {1, 16, 256}) {
+        size_t size = megabytes * 1024 * 1024;
+
+        size_t rss_before = resident_bytes();
+        auto begin = std::chrono::steady_clock::now();
+        auto pool = std::make_unique<MemoryPool>(size, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+        auto end = std::chrono::steady_clock::now();
+        double pool_us = std::chrono::duration<double, std::micro>(end - begin).count();
+        size_t pool_rss = resident_bytes() - rss_before;
+        pool.reset();
+
+        rss_before = resident_bytes();
+        begin = std::chrono::steady_clock::now();
+        void* memory = std::aligned_alloc(PageMap::PAGE_SIZE, size);
+        std::memset(memory, 0, size);
+        asm volatile("" : : "r"(memory) : "memory");  // 防止memset被优化掉
+        end = std::chrono::steady_clock::now();
+        double memset_us = std::chrono::duration<double, std::micro>(end - begin).count();
+        size_t memset_rss = resident_bytes() - rss_before;
+        std::free(memory);
+
+        std::cout << std::setw(10) << megabytes
+                  << std::setw(14) << std::fixed << std::setprecision(1) << pool_us
+                  << std::setw(14) << pool_rss / 1024
+                  << std::setw(18) << memset_us
+                  << std::setw(14) << memset_rss / 1024 << std::endl;
+    }
+
+    std::cout << "\n=== 扩展延迟 (增长因子2.0, 逐个分配1MB块) ===" << std::endl;
+    std::cout << std::setw(16) << "segment(MB)" << std::setw(16) << "latency(us)" << std::endl;
+
+    MemoryPool pool(MAX_BLOCK_SIZE, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false, 2.0);
+    std::vector<void*> blocks;
+    size_t total = pool.get_memory_usage().total;
+    while (total < 512 * 1024 * 1024) {
+        auto begin = std::chrono::steady_clock::now();
+        blocks.push_back(pool.allocate(MAX_BLOCK_SIZE));
+        auto end = std::chrono::steady_clock::now();
+
+        size_t new_total = pool.get_memory_usage().total;
+        if (new_total != total) {
+            std::cout << std::setw(16) << (new_total - total) / (1024 * 1024)
+                      << std::setw(16) << std::fixed << std::setprecision(1)
+                      << std::chrono::duration<double, std::micro>(end - begin).count() << std::endl;
+            total = new_total;
+        }
+    }
+
+    // allocate_zeroed在未使用过的页上不需要再写入
+    pool.reset();
+    const size_t zeroed_count = 256;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < zeroed_count; ++i) {
+        pool.allocate_zeroed(MAX_BLOCK_SIZE);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "allocate_zeroed(1MB) 新页: " << std::fixed << std::setprecision(1)
+              << std::chrono::duration<double, std::micro>(end - begin).count() / zeroed_count << " us/次" << std::endl;
+}
+
+// 多个线程同时更新同一个PoolStats，输出每次更新（一次分配或一次释放记录）占用的CPU纳秒数
+void benchmark_stats_overhead(size_t max_threads, size_t ops_per_thread) {
+    std::cout << "\n=== 统计更新开销 (共享PoolStats) ===" << std::endl;
+    std::cout << std::setw(10) << "threads" << std::setw(16) << "ns/update" << std::endl;
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        PoolStats stats;
+        std::vector<std::thread> workers;
+
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&stats, ops_per_thread]() {
+                for (size_t i = 0; i < ops_per_thread; ++i) {
+                    size_t size = 16 << (i % 8);
+                    stats.update_allocation(size, std::chrono::nanoseconds(50));
+                    stats.update_deallocation(size, std::chrono::nanoseconds(40));
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        // 按实际可并行的核数折算成每次更新占用的CPU时间
+        size_t cores = std::min<size_t>(threads, std::max(1u, std::thread::hardware_concurrency()));
+        std::cout << std::setw(10) << threads << std::setw(16) << std::fixed << std::setprecision(1)
+                  << std::chrono::duration<double, std::nano>(end - begin).count() * cores / (threads * ops_per_thread * 2)
+                  << std::endl;
+
+        if (stats.get_allocation_count() != threads * ops_per_thread || stats.get_used_memory() != 0) {
+            throw std::runtime_error("stats aggregation mismatch");
+        }
+    }
+}
+
+// 每个周期分配再释放一批大小相同的缓冲区，比较逐个调用与批量接口
+// 单生产者单消费者的交接环形队列，只用于传递指针，不经过被测的分配器
+struct HandoffRing {
+    static constexpr size_t CAPACITY = 1024;
+
+    void* slots[CAPACITY];
+    alignas(64) std::atomic<size_t> head{0};  // 消费者读取位置
+    alignas(64) std::atomic<size_t> tail{0};  // 生产者写入位置
+
+    bool push(void* ptr) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CAPACITY) {
+            return false;
+        }
+        slots[t % CAPACITY] = ptr;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void* pop() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        void* ptr = slots[h % CAPACITY];
+        head.store(h + 1, std::memory_order_release);
+        return ptr;
+    }
+};
+
+struct HandoffResult {
+    double ops_per_sec = 0.0;
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+};
+
+// 生产者分配64~1024字节的缓冲区交给消费者释放，记录生产者每16次分配中一次的延迟
+template<typename Pool>
+HandoffResult run_producer_consumer(Pool& pool, size_t ops) {
+    HandoffRing ring;
+    LatencyHistogram latency;
+
+    std::thread consumer([&pool, &ring, ops]() {
+        for (size_t freed = 0; freed < ops;) {
+            void* ptr = ring.pop();
+            if (!ptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            pool.deallocate(ptr);
+            ++freed;
+        }
+    });
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> size_dist(64, 1024);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        size_t size = size_dist(rng);
+        void* ptr;
+        if (i % 16 == 0) {
+            uint64_t start = CycleClock::now();
+            ptr = pool.allocate(size);
+            latency.record(CycleClock::to_duration(CycleClock::now() - start).count());
+        } else {
+            ptr = pool.allocate(size);
+        }
+        static_cast<char*>(ptr)[0] = 1;
+        while (!ring.push(ptr)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    auto end = std::chrono::steady_clock::now();
+
+    HandoffResult result;
+    result.ops_per_sec = ops / std::chrono::duration<double>(end - begin).count();
+    result.p50_ns = latency.percentile(0.5);
+    result.p99_ns = latency.percentile(0.99);
+    result.p999_ns = latency.percentile(0.999);
+    return result;
+}
+
+// 跨线程释放：生产者与消费者落在不同arena上，比较远程释放链表与直接在所属arena加锁释放
+void benchmark_remote_free(size_t ops) {
+    std::cout << "\n=== 生产者/消费者交接 (生产者分配、消费者释放) ===" << std::endl;
+    std::cout << std::setw(28) << "allocator"
+              << std::setw(14) << "handoffs/s"
+              << std::setw(26) << "alloc p50/p99/p99.9(ns)"
+              << std::setw(14) << "remote frees" << std::endl;
+
+    auto print = [](const char* name, const HandoffResult& result, size_t remote_frees) {
+        std::ostringstream latency;
+        latency << result.p50_ns << "/" << result.p99_ns << "/" << result.p999_ns;
+        std::cout << std::setw(28) << name
+                  << std::setw(14) << std::fixed << std::setprecision(0) << result.ops_per_sec
+                  << std::setw(26) << latency.str()
+                  << std::setw(14) << remote_frees << std::endl;
+    };
+
+    {
+        MemoryPool pool(16 * 1024 * 1024);
+        print("MemoryPool (locked)", run_producer_consumer(pool, ops), 0);
+    }
+    {
+        MemoryPool pool(16 * 1024 * 1024);
+        pool.set_thread_cache_enabled(true);
+        print("MemoryPool (thread cache)", run_producer_consumer(pool, ops), 0);
+    }
+    for (bool remote : {false, true}) {
+        // 生产者先分配，轮流指派到arena 0；消费者第一次释放时被指派到arena 1
+        ArenaPool pool(2, 16 * 1024 * 1024);
+        pool.set_remote_free_enabled(remote);
+        HandoffResult result = run_producer_consumer(pool, ops);
+        print(remote ? "ArenaPool (remote free)" : "ArenaPool (locked free)", result, pool.get_remote_free_count());
+    }
+}
+
+void benchmark_bulk_operations(size_t ticks) {
+    std::cout << "\n=== 批量分配/释放 (每周期1000个同尺寸块) ===" << std::endl;
+    std::cout << std::setw(10) << "size" << std::setw(16) << "single(ns/op)" << std::setw(16) << "bulk(ns/op)" << std::endl;
+
+    const size_t batch = 1000;
+    std::vector<void*> buffers(batch);
+
+    for (size_t size : {64, 512, 8192}) {
+        double results[2] = {};
+        for (int bulk = 0; bulk < 2; ++bulk) {
+            MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true);
+
+            auto begin = std::chrono::steady_clock::now();
+            for (size_t tick = 0; tick < ticks; ++tick) {
+                if (bulk) {
+                    pool.allocate_bulk(size, batch, buffers.data());
+                    pool.deallocate_bulk(buffers.data(), batch);
+                } else {
+                    for (size_t i = 0; i < batch; ++i) {
+                        buffers[i] = pool.allocate(size);
+                    }
+                    for (size_t i = 0; i < batch; ++i) {
+                        pool.deallocate(buffers[i]);
+                    }
+                }
+            }
+            auto end = std::chrono::steady_clock::now();
+            results[bulk] = std::chrono::duration<double, std::nano>(end - begin).count() / (ticks * batch);
+        }
+
+        std::cout << std::setw(10) << size << std::setw(16) << std::fixed << std::setprecision(1)
+                  << results[0] << std::setw(16) << results[1] << std::endl;
+    }
+}
+
+// 4-64MB的大块循环分配/释放（每次写入首尾页），比较span缓存、不缓存和直接mmap
+void benchmark_large_objects(size_t ops) {
+    std::cout << "\n=== 大对象分配 (4-64MB, 每次写入首尾页) ===" << std::endl;
+    std::cout << std::setw(18) << "allocator" << std::setw(16) << "ns/op" << std::setw(16) << "cache hits" << std::endl;
+
+    std::mt19937 rng(42);
+    std::vector<size_t> sizes(ops);
+    for (auto& size : sizes) {
+        size = (size_t(4) << (rng() % 5)) * 1024 * 1024;
+    }
+
+    auto touch = [](void* ptr, size_t size) {
+        static_cast<char*>(ptr)[0] = 1;
+        static_cast<char*>(ptr)[size - 1] = 1;
+    };
+
+    for (size_t cache_limit : {LARGE_SPAN_CACHE_BYTES, size_t(0)}) {
+        MemoryPool pool(1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true);
+        pool.set_large_span_cache_limit(cache_limit);
+
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t size : sizes) {
+            void* ptr = pool.allocate(size);
+            touch(ptr, size);
+            pool.deallocate(ptr);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << std::setw(18) << (cache_limit ? "pool(span cache)" : "pool(no cache)")
+                  << std::setw(16) << std::fixed << std::setprecision(0)
+                  << std::chrono::duration<double, std::nano>(end - begin).count() / ops
+                  << std::setw(16) << pool.get_stats().get_large_cache_hits() << std::endl;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t size : sizes) {
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        touch(ptr, size);
+        munmap(ptr, size);
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << std::setw(18) << "mmap/munmap" << std::setw(16) << std::fixed << std::setprecision(0)
+              << std::chrono::duration<double, std::nano>(end - begin).count() / ops << std::setw(16) << "-" << std::endl;
+}
+
+// 多线程小对象分配/释放，返回每次分配延迟的p99和最大值（纳秒）
+std::pair<double, double> run_small_allocation_latency(MemoryPool& pool, size_t thread_count, size_t ops_per_thread) {
+    std::vector<std::vector<double>> samples(thread_count);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < thread_count; ++t) {
+        threads.emplace_back([&pool, &samples, t, ops_per_thread]() {
+            samples[t].reserve(ops_per_thread);
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                void* ptr = pool.allocate(64 + (i % 8) * 32);
+                auto end = std::chrono::steady_clock::now();
+                samples[t].push_back(std::chrono::duration<double, std::nano>(end - begin).count());
+                pool.deallocate(ptr);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    for (auto& thread_samples : samples) {
+        all.insert(all.end(), thread_samples.begin(), thread_samples.end());
+    }
+    std::sort(all.begin(), all.end());
+    return {all[all.size() * 99 / 100], all.back()};
+}
+
+void benchmark_scavenger() {
+    std::cout << "\n=== 后台回收 (分配并写入512MB的1MB块后释放) ===" << std::endl;
+
+    const size_t spike_bytes = 512 * 1024 * 1024;
+    MemoryPool pool(64 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true, 2.0);
+
+    size_t rss_before = resident_bytes();
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < spike_bytes / MAX_BLOCK_SIZE; ++i) {
+        void* ptr = pool.allocate(MAX_BLOCK_SIZE);
+        std::memset(ptr, 1, MAX_BLOCK_SIZE);
+        blocks.push_back(ptr);
+    }
+    size_t rss_peak = resident_bytes();
+    for (void* ptr : blocks) {
+        pool.deallocate(ptr);
+    }
+    size_t rss_freed = resident_bytes();
+
+    ScavengerConfig config;
+    config.interval = std::chrono::milliseconds(10);
+    config.idle_threshold = std::chrono::milliseconds(0);
+    pool.start_scavenger(config);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    size_t rss_scavenged = resident_bytes();
+    ScavengerStats scavenger_stats = pool.get_scavenger_stats();
+
+    std::cout << "RSS增量(MB): 峰值 " << (rss_peak - rss_before) / (1024 * 1024)
+              << ", 释放后 " << (rss_freed - rss_before) / (1024 * 1024)
+              << ", 回收后 " << (rss_scavenged > rss_before ? (rss_scavenged - rss_before) / (1024 * 1024) : 0) << std::endl;
+    std::cout << "madvise归还 " << scavenger_stats.released_bytes / (1024 * 1024) << " MB, 解除映射 "
+              << scavenger_stats.unmapped_bytes / (1024 * 1024) << " MB (" << scavenger_stats.unmapped_segments
+              << " 个内存段), 回收轮数 " << scavenger_stats.passes << std::endl;
+
+    // 回收线程持续运行时小对象分配的尾延迟
+    std::cout << std::setw(14) << "scavenger" << std::setw(14) << "p99(ns)" << std::setw(14) << "max(ns)" << std::endl;
+    size_t thread_count = std::max(2u, std::min(4u, std::thread::hardware_concurrency()));
+    for (bool running : {false, true}) {
+        if (running) {
+            config.interval = std::chrono::milliseconds(1);
+            pool.start_scavenger(config);
+        } else {
+            pool.stop_scavenger();
+        }
+
+        auto latency = run_small_allocation_latency(pool, thread_count, 200000);
+        std::cout << std::setw(14) << (running ? "on" : "off")
+                  << std::setw(14) << std::fixed << std::setprecision(0) << latency.first
+                  << std::setw(14) << latency.second << std::endl;
+    }
+    pool.stop_scavenger();
+}
+
+// 单线程固定大小的分配/释放循环，返回每对操作的纳秒数
+template<typename Pool>
+double run_policy_overhead(Pool& pool, size_t ops) {
+    const size_t live_count = 64;
+    void* live[live_count] = {};
+
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        size_t slot = i % live_count;
+        if (live[slot]) {
+            pool.deallocate(live[slot]);
+        }
+        live[slot] = pool.allocate(64);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (void* ptr : live) {
+        pool.deallocate(ptr);
+    }
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ops;
+}
+
+// 策略开销：运行时开关（默认MemoryPool）与编译期空策略的单线程分配成本
+void benchmark_policy_overhead(size_t ops) {
+    std::cout << "\n=== 策略开销 (单线程, 64字节, ns/alloc+free) ===" << std::endl;
+
+    using UnsyncedPool = BasicMemoryPool<NullLockPolicy, NullPoolStats, FactorGrowthPolicy, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE>;
+    using LockedNoStatsPool = BasicMemoryPool<MutexLockPolicy, NullPoolStats, FactorGrowthPolicy, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE>;
+
+    MemoryPool runtime_locked(1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true);
+    MemoryPool runtime_unlocked(1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+    LockedNoStatsPool locked_no_stats(1024 * 1024);
+    UnsyncedPool unsynced(1024 * 1024);
+
+    std::cout << std::setw(34) << "configuration" << std::setw(12) << "ns/op" << std::endl;
+    std::cout << std::setw(34) << "MemoryPool(thread_safe=true)" << std::setw(12) << std::fixed << std::setprecision(1)
+              << run_policy_overhead(runtime_locked, ops) << std::endl;
+    std::cout << std::setw(34) << "MemoryPool(thread_safe=false)" << std::setw(12)
+              << run_policy_overhead(runtime_unlocked, ops) << std::endl;
+    std::cout << std::setw(34) << "MutexLock + NullStats" << std::setw(12)
+              << run_policy_overhead(locked_no_stats, ops) << std::endl;
+    std::cout << std::setw(34) << "NullLock + NullStats" << std::setw(12)
+              << run_policy_overhead(unsynced, ops) << std::endl;
+}
+
+// 计时采样率对分配/释放开销的影响，以及两种时钟的读取开销
+void benchmark_timing_overhead(size_t ops) {
+    std::cout << "\n=== 计时开销 (单线程, 64字节) ===" << std::endl;
+
+    const size_t clock_reads = 1000000;
+    uint64_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < clock_reads; ++i) {
+        sink += std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double chrono_ns = std::chrono::duration<double, std::nano>(end - begin).count() / clock_reads;
+
+    begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < clock_reads; ++i) {
+        sink += CycleClock::now();
+    }
+    end = std::chrono::steady_clock::now();
+    double tsc_ns = std::chrono::duration<double, std::nano>(end - begin).count() / clock_reads;
+    asm volatile("" : : "r"(sink) : "memory");
+
+    std::cout << "时钟读取: high_resolution_clock " << std::fixed << std::setprecision(1) << chrono_ns
+              << " ns, CycleClock " << tsc_ns << " ns" << std::endl;
+
+    std::cout << std::setw(14) << "sample rate" << std::setw(12) << "ns/op" << std::setw(12) << "p50(ns)"
+              << std::setw(12) << "p99(ns)" << std::setw(12) << "p99.9(ns)" << std::endl;
+    for (size_t rate : {size_t(0), size_t(1), DEFAULT_TIMING_SAMPLE_RATE}) {
+        MemoryPool pool(1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+        pool.set_timing_sample_rate(rate);
+        double ns = run_policy_overhead(pool, ops);
+        PerformanceMetrics metrics = pool.get_performance_metrics();
+
+        std::cout << std::setw(14) << rate << std::setw(12) << std::fixed << std::setprecision(1) << ns
+                  << std::setw(12) << metrics.alloc_latency.p50_ns
+                  << std::setw(12) << metrics.alloc_latency.p99_ns
+                  << std::setw(12) << metrics.alloc_latency.p999_ns << std::endl;
+    }
+}
+
+// 小对象内部碎片：按对数正态分布（中位数约55字节，上限4KB）生成请求大小，
+// 比较按2的幂次方取整的伙伴块与slab大小类各自浪费的字节数
+void benchmark_internal_fragmentation() {
+    std::cout << "\n=== 小对象内部碎片 (对数正态分布请求) ===" << std::endl;
+
+    const size_t object_count = 200000;
+    MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+
+    std::mt19937 rng(11);
+    std::lognormal_distribution<double> size_dist(4.0, 1.0);
+
+    size_t requested_bytes = 0;
+    size_t power_of_two_bytes = 0;
+    size_t slab_bytes = 0;
+    std::vector<void*> objects;
+    objects.reserve(object_count);
+
+    for (size_t i = 0; i < object_count; ++i) {
+        size_t size = std::min<size_t>(SLAB_MAX_OBJECT_SIZE, std::max<size_t>(1, static_cast<size_t>(size_dist(rng))));
+        size_t power = MIN_BLOCK_SIZE;
+        while (power < size) {
+            power <<= 1;
+        }
+
+        void* ptr = pool.allocate(size);
+        requested_bytes += size;
+        power_of_two_bytes += power;
+        slab_bytes += pool.get_block_size(ptr);
+        objects.push_back(ptr);
+    }
+
+    auto waste = [requested_bytes](size_t bytes) {
+        return static_cast<double>(bytes - requested_bytes) / bytes * 100.0;
+    };
+
+    std::cout << std::setw(14) << "scheme" << std::setw(16) << "bytes" << std::setw(12) << "waste(%)" << std::endl;
+    std::cout << std::setw(14) << "requested" << std::setw(16) << requested_bytes << std::endl;
+    std::cout << std::setw(14) << "power_of_two" << std::setw(16) << power_of_two_bytes
+              << std::setw(12) << std::fixed << std::setprecision(1) << waste(power_of_two_bytes) << std::endl;
+    std::cout << std::setw(14) << "slab_classes" << std::setw(16) << slab_bytes
+              << std::setw(12) << std::fixed << std::setprecision(1) << waste(slab_bytes) << std::endl;
+    std::cout << "slab大小类节省: " << power_of_two_bytes - slab_bytes << " 字节 ("
+              << std::fixed << std::setprecision(1)
+              << static_cast<double>(power_of_two_bytes - slab_bytes) / power_of_two_bytes * 100.0
+              << "%)" << std::endl;
+
+    for (void* ptr : objects) {
+        pool.deallocate(ptr);
+    }
+}
+
+// 在线压缩：随机大小的句柄块释放80%后，逐步压缩直到没有可做的搬移，
+// 比较占用的内存段字节数、每步停顿的分布，以及pin/unpin相对直接访问指针的开销
+void benchmark_compaction(size_t handle_count) {
+    std::cout << "\n=== 在线压缩 (" << handle_count << "个16B-4KB的句柄块，随机释放80%) ===" << std::endl;
+
+    MemoryPool pool(256 * 1024);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> size_dist(16, 4096);
+    std::vector<MemoryHandle> handles;
+    for (size_t i = 0; i < handle_count; ++i) {
+        size_t size = size_dist(rng);
+        MemoryHandle handle = pool.allocate_handle(size);
+        std::memset(pool.pin(handle), 1, size);
+        pool.unpin(handle);
+        handles.push_back(handle);
+    }
+    std::shuffle(handles.begin(), handles.end(), rng);
+    size_t keep_count = handles.size() / 5;
+    for (size_t i = keep_count; i < handles.size(); ++i) {
+        pool.free_handle(handles[i]);
+    }
+    handles.resize(keep_count);
+    size_t total_before = pool.get_stats().get_total_memory();
+    size_t used = pool.get_stats().get_used_memory();
+
+    std::vector<int64_t> pauses;
+    CompactionResult result;
+    while (!result.complete) {
+        result = pool.compact_step();
+        pauses.push_back(result.pause.count());
+    }
+    std::sort(pauses.begin(), pauses.end());
+    CompactionStats compaction_stats = pool.get_compaction_stats();
+    size_t total_after = pool.get_stats().get_total_memory();
+
+    std::cout << "已分配 " << used / 1024 << " KB, 内存段 " << total_before / 1024 << " KB -> "
+              << total_after / 1024 << " KB (解除映射" << compaction_stats.released_segments << "个)" << std::endl;
+    std::cout << "搬移 " << compaction_stats.moved_blocks << " 块 / " << compaction_stats.moved_bytes / 1024
+              << " KB, " << compaction_stats.steps << " 步, 单步停顿 p50/p99/max(us): "
+              << std::fixed << std::setprecision(1) << percentile(pauses, 50.0) / 1e3 << "/"
+              << percentile(pauses, 99.0) / 1e3 << "/" << pauses.back() / 1e3 << std::endl;
+
+    // pin/unpin一次与经由普通指针访问的对比
+    const size_t rounds = 20;
+    std::vector<void*> pointers;
+    for (MemoryHandle handle : handles) {
+        pointers.push_back(pool.pin(handle));
+        pool.unpin(handle);
+    }
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (MemoryHandle handle : handles) {
+            sum += *static_cast<unsigned char*>(pool.pin(handle));
+            pool.unpin(handle);
+        }
+    }
+    double pinned_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (void* ptr : pointers) {
+            sum += *static_cast<volatile unsigned char*>(ptr);
+        }
+    }
+    double raw_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    size_t accesses = rounds * handles.size();
+    std::cout << "每次访问(ns): pin/unpin " << std::setprecision(1) << pinned_ns / accesses
+              << ", 直接指针 " << raw_ns / accesses << " (校验和 " << sum << ")" << std::endl;
+
+    for (MemoryHandle handle : handles) {
+        pool.free_handle(handle);
+    }
+}
+
+// 跨进程交接一条消息的往返时间（微秒）：父进程生成消息，子进程读完整条消息后回送1字节确认。
+// zero_copy时消息写在共享池中，管道只传8字节偏移，子进程读完后直接释放；否则整条消息经管道复制
+double run_shared_handoff(SharedMemoryPool& pool, size_t message_size, size_t count, bool zero_copy) {
+    int request[2];
+    int response[2];
+    if (pipe(request) != 0 || pipe(response) != 0) {
+        throw std::runtime_error("pipe failed");
+    }
+
+    auto read_full = [](int fd, void* buffer, size_t size) {
+        char* out = static_cast<char*>(buffer);
+        while (size > 0) {
+            ssize_t n = read(fd, out, size);
+            if (n <= 0) {
+                return false;
+            }
+            out += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+    auto write_full = [](int fd, const void* buffer, size_t size) {
+        const char* in = static_cast<const char*>(buffer);
+        while (size > 0) {
+            ssize_t n = write(fd, in, size);
+            if (n <= 0) {
+                return false;
+            }
+            in += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    };
+
+    pid_t child = fork();
+    if (child == 0) {
+        // 子进程重新映射共享池，映射地址与父进程不同
+        close(request[1]);
+        close(response[0]);
+        SharedMemoryPool view(pool.get_fd());
+        std::vector<unsigned char> buffer(zero_copy ? 0 : message_size);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const unsigned char* message;
+            uint64_t offset = 0;
+            if (zero_copy) {
+                read_full(request[0], &offset, sizeof(offset));
+                message = static_cast<const unsigned char*>(view.address_of(offset));
+            } else {
+                read_full(request[0], buffer.data(), message_size);
+                message = buffer.data();
+            }
+            for (size_t j = 0; j < message_size; j += 64) {
+                sum += message[j];
+            }
+            if (zero_copy) {
+                view.deallocate(view.address_of(offset));
+            }
+            char ack = static_cast<char>(sum);
+            write_full(response[1], &ack, 1);
+        }
+        _exit(0);
+    }
+    close(request[0]);
+    close(response[1]);
+
+    std::vector<unsigned char> buffer(zero_copy ? 0 : message_size);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        if (zero_copy) {
+            void* message = pool.allocate(message_size);
+            std::memset(message, static_cast<int>(i), message_size);
+            uint64_t offset = pool.offset_of(message);
+            write_full(request[1], &offset, sizeof(offset));
+        } else {
+            std::memset(buffer.data(), static_cast<int>(i), message_size);
+            write_full(request[1], buffer.data(), message_size);
+        }
+        char ack;
+        read_full(response[0], &ack, 1);
+    }
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    close(request[1]);
+    close(response[0]);
+    waitpid(child, nullptr, 0);
+    return elapsed / count;
+}
+
+void benchmark_shared_memory_handoff() {
+    std::cout << "\n=== 跨进程交接大消息 (共享池传偏移 vs 管道复制) ===" << std::endl;
+    std::cout << std::setw(14) << "message" << std::setw(18) << "pipe copy(us)"
+              << std::setw(18) << "shared pool(us)" << std::setw(12) << "speedup" << std::endl;
+
+    SharedMemoryPool pool("", 256 * 1024 * 1024, 4096, 16 * 1024 * 1024);
+    for (size_t message_size : {64 * 1024, 1024 * 1024, 8 * 1024 * 1024}) {
+        size_t count = std::max<size_t>(50, 256 * 1024 * 1024 / message_size / 4);
+        double copied = run_shared_handoff(pool, message_size, count, false);
+        double shared = run_shared_handoff(pool, message_size, count, true);
+        std::cout << std::setw(12) << message_size / 1024 << "KB"
+                  << std::setw(18) << std::fixed << std::setprecision(1) << copied
+                  << std::setw(18) << shared
+                  << std::setw(11) << std::setprecision(2) << copied / shared << "x" << std::endl;
+    }
+    std::cout << "共享池收发后已使用字节: " << pool.get_used_memory() << std::endl;
+}
+
+// 持久化内存池的启动耗时：正常关闭后重新打开只校验头部，与池大小无关；崩溃后打开需要按阶数表
+// 重建自由链表。对照组为重新构造MemoryPool并重新分配、填充同样多的对象（重建数据）
+struct PersistentNode {
+    uint64_t next;
+    uint64_t payload[31];
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void benchmark_persistent_restart(size_t object_count) {
+    std::cout << "\n=== 持久化内存池启动 (" << object_count << "个256B对象) ===" << std::endl;
+    std::cout << std::setw(10) << "size(MB)" << std::setw(14) << "create(ms)" << std::setw(14) << "reopen(us)"
+              << std::setw(14) << "recover(ms)" << std::setw(14) << "rebuild(ms)" << std::endl;
+
+    const std::string path = "/tmp/mpool_bench_persistent.pool";
+    for (size_t megabytes : {256, 1024, 2048}) {
+        size_t size = megabytes * 1024 * 1024;
+        unlink(path.c_str());
+
+        auto begin = std::chrono::steady_clock::now();
+        {
+            PersistentMemoryPool pool(path, size);
+            uint64_t head = 0;
+            for (size_t i = 0; i < object_count; ++i) {
+                auto* node = static_cast<PersistentNode*>(pool.allocate(sizeof(PersistentNode)));
+                node->next = head;
+                node->payload[0] = i;
+                head = pool.offset_of(node);
+            }
+            pool.set_root(head);
+        }
+        double create_ms = elapsed_ms(begin);
+
+        begin = std::chrono::steady_clock::now();
+        double reopen_us = 0.0;
+        {
+            PersistentMemoryPool pool(path, 0);
+            reopen_us = elapsed_ms(begin) * 1000.0;
+        }
+
+        // 子进程打开后直接退出，不执行析构，模拟崩溃
+        pid_t child = fork();
+        if (child == 0) {
+            new PersistentMemoryPool(path, 0);
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(child, &status, 0);
+
+        begin = std::chrono::steady_clock::now();
+        double recover_ms = 0.0;
+        {
+            PersistentMemoryPool pool(path, 0);
+            recover_ms = elapsed_ms(begin);
+            if (!pool.was_recovered()) {
+                throw std::runtime_error("persistent pool was not recovered");
+            }
+        }
+
+        begin = std::chrono::steady_clock::now();
+        {
+            MemoryPool pool(size, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+            PersistentNode* head = nullptr;
+            for (size_t i = 0; i < object_count; ++i) {
+                auto* node = static_cast<PersistentNode*>(pool.allocate(sizeof(PersistentNode)));
+                node->next = reinterpret_cast<uint64_t>(head);
+                node->payload[0] = i;
+                head = node;
+            }
+            asm volatile("" : : "r"(head) : "memory");
+        }
+        double rebuild_ms = elapsed_ms(begin);
+
+        std::cout << std::setw(10) << megabytes
+                  << std::setw(14) << std::fixed << std::setprecision(1) << create_ms
+                  << std::setw(14) << reopen_us
+                  << std::setw(14) << recover_ms
+                  << std::setw(14) << rebuild_ms << std::endl;
+    }
+    unlink(path.c_str());
+}
+
+// 请求作用域内分配若干小对象、结束时全部释放：逐个释放（每次都要合并伙伴）与单调分配区整体归还
+void benchmark_monotonic_arena(size_t requests) {
+    std::cout << "\n=== 请求作用域分配 (16-512B对象, 请求结束时全部释放) ===" << std::endl;
+    std::cout << std::setw(10) << "objects" << std::setw(18) << "pool(ns/obj)" << std::setw(18) << "arena(ns/obj)"
+              << std::setw(12) << "speedup" << std::endl;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> size_dist(16, 512);
+
+    for (size_t object_count : {100, 500, 2000}) {
+        std::vector<size_t> sizes(object_count);
+        for (size_t& size : sizes) {
+            size = size_dist(rng);
+        }
+        std::vector<void*> objects(object_count);
+        size_t rounds = std::max<size_t>(1, requests * 100 / object_count);
+
+        MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true);
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            for (size_t i = 0; i < object_count; ++i) {
+                objects[i] = pool.allocate(sizes[i]);
+            }
+            for (size_t i = 0; i < object_count; ++i) {
+                pool.deallocate(objects[i]);
+            }
+        }
+        double pool_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                         / (rounds * object_count);
+
+        begin = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; ++round) {
+            MonotonicArena arena(pool);
+            for (size_t i = 0; i < object_count; ++i) {
+                objects[i] = arena.allocate(sizes[i]);
+            }
+            asm volatile("" : : "r"(objects.data()) : "memory");
+        }
+        double arena_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count()
+                          / (rounds * object_count);
+
+        std::cout << std::setw(10) << object_count
+                  << std::setw(18) << std::fixed << std::setprecision(1) << pool_ns
+                  << std::setw(18) << arena_ns
+                  << std::setw(11) << std::setprecision(2) << pool_ns / arena_ns << "x" << std::endl;
+    }
+}
+
+// 批处理任务之间的reset：每个任务写入64MB的4KB块后整体reset。
+// reset只清除各内存段的元数据并保留物理页，块在之后分配时再按需切出；
+// 归还物理页的代价会转移到下一个任务的缺页上，因此同时报告reset与任务的合计
+void benchmark_reset(size_t jobs) {
+    std::cout << "\n=== 任务间reset (每个任务分配64MB的4KB块) ===" << std::endl;
+    std::cout << std::setw(10) << "size(MB)" << std::setw(14) << "reset(us)" << std::setw(22) << "first alloc(us)"
+              << std::setw(16) << "job(ms)" << std::setw(20) << "reset+job(ms)" << std::endl;
+
+    const size_t block_size = 4096;
+    const size_t job_blocks = 64 * 1024 * 1024 / block_size;
+    for (size_t megabytes : {256, 1024, 4096}) {
+        MemoryPool pool(megabytes * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, true);
+        double reset_us = 0.0;
+        double first_us = 0.0;
+        double job_ms = 0.0;
+
+        for (size_t job = 0; job < jobs; ++job) {
+            auto begin = std::chrono::steady_clock::now();
+            char* first = static_cast<char*>(pool.allocate(block_size));
+            first_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+            first[0] = 1;
+            for (size_t i = 1; i < job_blocks; ++i) {
+                static_cast<char*>(pool.allocate(block_size))[0] = 1;
+            }
+            job_ms += elapsed_ms(begin);
+
+            begin = std::chrono::steady_clock::now();
+            pool.reset();
+            reset_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+        }
+
+        std::cout << std::setw(10) << megabytes
+                  << std::setw(14) << std::fixed << std::setprecision(1) << reset_us / jobs
+                  << std::setw(22) << first_us / jobs
+                  << std::setw(16) << job_ms / jobs
+                  << std::setw(20) << (reset_us / 1000.0 + job_ms) / jobs << std::endl;
+    }
+}
+
+// 链式容器负载：每轮插入count个元素后全部删除，返回每个元素（一次插入加一次删除）的纳秒数
+template<typename List>
+double run_list_workload(List& list, size_t count, size_t rounds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < count; ++i) {
+            list.push_back(static_cast<int>(i));
+        }
+        while (!list.empty()) {
+            list.pop_front();
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (rounds * count);
+}
+
+template<typename Map>
+double run_map_workload(Map& map, const std::vector<int>& keys, size_t rounds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (int key : keys) {
+            map.emplace(key, key);
+        }
+        for (int key : keys) {
+            map.erase(key);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (rounds * keys.size());
+}
+
+// 标准容器使用默认分配器、std::pmr容器使用PoolResource、PoolAllocator三种方式的对比
+void benchmark_stl_allocators(size_t count) {
+    std::cout << "\n=== STL容器 (" << count << "个元素插入后全部删除, ns/元素) ===" << std::endl;
+    std::cout << std::setw(16) << "container" << std::setw(16) << "std::allocator" << std::setw(16) << "pmr resource"
+              << std::setw(16) << "PoolAllocator" << std::endl;
+
+    const size_t rounds = 10;
+    std::vector<int> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys[i] = static_cast<int>(i);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(11));
+
+    MemoryPool pool(64 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+    PoolResource resource(pool);
+    PoolAllocator<int> allocator(resource);
+    double results[3][3] = {};
+
+    {
+        std::list<int> standard;
+        std::pmr::list<int> polymorphic(&resource);
+        std::list<int, PoolAllocator<int>> pooled(allocator);
+        results[0][0] = run_list_workload(standard, count, rounds);
+        results[0][1] = run_list_workload(polymorphic, count, rounds);
+        results[0][2] = run_list_workload(pooled, count, rounds);
+    }
+    {
+        using Node = std::pair<const int, int>;
+        std::map<int, int> standard;
+        std::pmr::map<int, int> polymorphic(&resource);
+        std::map<int, int, std::less<int>, PoolAllocator<Node>> pooled(allocator);
+        results[1][0] = run_map_workload(standard, keys, rounds);
+        results[1][1] = run_map_workload(polymorphic, keys, rounds);
+        results[1][2] = run_map_workload(pooled, keys, rounds);
+    }
+    {
+        using Node = std::pair<const int, int>;
+        std::unordered_map<int, int> standard;
+        std::pmr::unordered_map<int, int> polymorphic(&resource);
+        std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, PoolAllocator<Node>> pooled(allocator);
+        results[2][0] = run_map_workload(standard, keys, rounds);
+        results[2][1] = run_map_workload(polymorphic, keys, rounds);
+        results[2][2] = run_map_workload(pooled, keys, rounds);
+    }
+
+    const char* names[3] = {"list", "map", "unordered_map"};
+    for (size_t i = 0; i < 3; ++i) {
+        std::cout << std::setw(16) << names[i] << std::fixed << std::setprecision(1)
+                  << std::setw(16) << results[i][0] << std::setw(16) << results[i][1]
+                  << std::setw(16) << results[i][2] << std::endl;
+    }
+}
+
+// 热点消息对象：构造时为负载预留缓冲区，重置只需清空负载
+struct BenchMessage {
+    uint64_t id = 0;
+    uint32_t type = 0;
+    std::vector<char> payload;
+
+    BenchMessage() {
+        payload.reserve(256);
+    }
+
+    BenchMessage(uint64_t message_id, uint32_t message_type) : id(message_id), type(message_type) {
+        payload.reserve(256);
+    }
+};
+
+// 保持64个存活消息，每次创建一个新消息、销毁最旧的一个，返回每次（创建加销毁）的纳秒数
+template<typename Make, typename Destroy>
+double run_message_churn(size_t ops, Make make, Destroy destroy) {
+    const size_t live_count = 64;
+    std::vector<BenchMessage*> live(live_count, nullptr);
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        BenchMessage*& slot = live[i % live_count];
+        if (slot) {
+            destroy(slot);
+        }
+        slot = make(i);
+        slot->payload.push_back(static_cast<char>(i));
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    for (BenchMessage* message : live) {
+        if (message) {
+            destroy(message);
+        }
+    }
+    return elapsed / ops;
+}
+
+void benchmark_object_pool(size_t ops) {
+    std::cout << "\n=== 定长对象池 (sizeof(BenchMessage) = " << sizeof(BenchMessage)
+              << ", ns/创建+销毁) ===" << std::endl;
+
+    MemoryPool pool(16 * 1024 * 1024, MIN_BLOCK_SIZE, MAX_BLOCK_SIZE, false);
+
+    double new_delete = run_message_churn(ops,
+        [](size_t i) { return new BenchMessage(i, 1); },
+        [](BenchMessage* message) { delete message; });
+
+    double allocate_type = run_message_churn(ops,
+        [&pool](size_t i) { return new (pool.allocate_type<BenchMessage>()) BenchMessage(i, 1); },
+        [&pool](BenchMessage* message) {
+            message->~BenchMessage();
+            pool.deallocate(message);
+        });
+
+    ObjectPool<BenchMessage> objects(pool);
+    double object_pool = run_message_churn(ops,
+        [&objects](size_t i) { return objects.make(i, 1); },
+        [&objects](BenchMessage* message) { objects.destroy(message); });
+
+    // 保留构造：对象不析构，复用时由调用者重置字段，负载缓冲区保留
+    ObjectPool<BenchMessage, true> recycled(pool);
+    double keep_constructed = run_message_churn(ops,
+        [&recycled](size_t i) {
+            BenchMessage* message = recycled.make();
+            message->id = i;
+            message->type = 1;
+            message->payload.clear();
+            return message;
+        },
+        [&recycled](BenchMessage* message) { recycled.destroy(message); });
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "  new/delete:                 " << new_delete << std::endl
+              << "  allocate_type + placement:  " << allocate_type << std::endl
+              << "  ObjectPool:                 " << object_pool << std::endl
+              << "  ObjectPool (保留构造):      " << keep_constructed << std::endl;
+    BenchMessage* block = pool.allocate_type<BenchMessage>();
+    std::cout << "  槽位大小: ObjectPool " << ObjectPool<BenchMessage>::slot_size()
+              << "，保留构造 " << ObjectPool<BenchMessage, true>::slot_size()
+              << "，allocate_type块 " << pool.get_block_size(block) << std::endl;
+    pool.deallocate(block);
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1) {
+        max_threads = std::max(1, std::atoi(argv[1]));
+    }
+    size_t ops_per_thread = 100000;
+    if (argc > 2) {
+        ops_per_thread = std::max(1, std::atoi(argv[2]));
+    }
+    size_t max_live_count = 10000000;
+    if (argc > 3) {
+        max_live_count = std::max(1000, std::atoi(argv[3]));
+    }
+
+    std::cout << "内存池基准测试程序" << std::endl;
+
+    try {
+        benchmark_thread_scaling(max_threads, ops_per_thread);
+        benchmark_free_list_contention(max_threads, ops_per_thread * 10);
+        benchmark_pool_free_list_contention(max_threads, ops_per_thread * 10);
+        benchmark_deallocation_cost(max_live_count);
+        benchmark_fragmented_free(std::min<size_t>(max_live_count, 1000000));
+        benchmark_segment_lookup();
+        benchmark_internal_fragmentation();
+        benchmark_policy_overhead(ops_per_thread * 10);
+        benchmark_stats_overhead(max_threads, ops_per_thread * 10);
+        benchmark_timing_overhead(ops_per_thread * 10);
+        benchmark_startup_latency();
+        benchmark_scavenger();
+        benchmark_large_objects(ops_per_thread / 10);
+        benchmark_bulk_operations(ops_per_thread / 100);
+        benchmark_remote_free(ops_per_thread * 10);
+        benchmark_compaction(ops_per_thread);
+        benchmark_shared_memory_handoff();
+        benchmark_persistent_restart(ops_per_thread * 10);
+        benchmark_monotonic_arena(ops_per_thread);
+        benchmark_reset(20);
+        benchmark_stl_allocators(ops_per_thread);
+        benchmark_object_pool(ops_per_thread * 10);
+    } catch (const std::exception& e) {
+        std::cerr << "基准测试失败: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
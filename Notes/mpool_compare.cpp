@@ -0,0 +1,643 @@
+// 分配器对比基准：在相同负载下比较 MemoryPool、ArenaPool、glibc malloc 和 std::pmr 池资源
+// 编译: g++ -std=c++17 -O2 -pthread mpool_compare.cpp -o mpool_compare
+// 运行: ./mpool_compare [最大线程数] [每线程操作次数] [结果文件]
+//
+// 每个 (负载, 分配器, 线程数) 组合在 fork 出的子进程中运行，常驻内存读数互不干扰。
+// 结果以表格打印到标准输出，同时以每行一个 JSON 对象写入结果文件（默认 mpool_compare.jsonl）
+
+#define MPOOL_NO_MAIN
+#include "mpool.cpp"
+
+#include <fstream>
+#include <iomanip>
+#include <memory_resource>
+#include <random>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// 每隔多少次操作计时一次，计时本身（两次rdtsc）约20ns，全量计时会明显拉低吞吐
+const size_t LATENCY_SAMPLE_INTERVAL = 16;
+// 每隔多少次操作汇总一次存活字节数并采样常驻内存
+const size_t RSS_SAMPLE_INTERVAL = 4096;
+
+// 当前进程的常驻内存（Linux）
+size_t resident_bytes() {
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> total_pages >> resident_pages;
+    return resident_pages * PageMap::PAGE_SIZE;
+}
+
+// ==================== 被测分配器 ====================
+// 统一接口：allocate(size) / deallocate(ptr, size)，pmr 的释放需要原始大小
+
+struct MallocAdapter {
+    static constexpr const char* name = "malloc";
+    static constexpr bool thread_safe = true;
+
+    void* allocate(size_t size) { return std::malloc(size); }
+    void deallocate(void* ptr, size_t) { std::free(ptr); }
+};
+
+// 线程安全的默认内存池，开启线程缓存；超过 MAX_BLOCK_SIZE 的请求走大对象层
+struct MemoryPoolAdapter {
+    static constexpr const char* name = "mpool";
+    static constexpr bool thread_safe = true;
+
+    MemoryPool pool{16 * 1024 * 1024};
+
+    MemoryPoolAdapter() { pool.set_thread_cache_enabled(true); }
+
+    void* allocate(size_t size) { return pool.allocate(size); }
+    void deallocate(void* ptr, size_t) { pool.deallocate(ptr); }
+};
+
+// 每个硬件线程一个arena，线程轮流指派，同样开启线程缓存
+struct ArenaPoolAdapter {
+    static constexpr const char* name = "mpool_arena";
+    static constexpr bool thread_safe = true;
+
+    ArenaPool pool{std::max(1u, std::thread::hardware_concurrency()), 4 * 1024 * 1024};
+
+    ArenaPoolAdapter() { pool.set_thread_cache_enabled(true); }
+
+    void* allocate(size_t size) { return pool.allocate(size); }
+    void deallocate(void* ptr, size_t) { pool.deallocate(ptr); }
+};
+
+// pmr 池资源默认只池化较小的块，这里把上限放宽到与内存池相同的 MAX_BLOCK_SIZE
+inline std::pmr::pool_options compare_pool_options() {
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = MAX_BLOCK_SIZE;
+    return options;
+}
+
+struct PmrSynchronizedAdapter {
+    static constexpr const char* name = "pmr_sync";
+    static constexpr bool thread_safe = true;
+
+    std::pmr::synchronized_pool_resource resource{compare_pool_options()};
+
+    void* allocate(size_t size) { return resource.allocate(size, DEFAULT_ALIGNMENT); }
+    void deallocate(void* ptr, size_t size) { resource.deallocate(ptr, size, DEFAULT_ALIGNMENT); }
+};
+
+// 非同步版本只参加单线程负载
+struct PmrUnsynchronizedAdapter {
+    static constexpr const char* name = "pmr_unsync";
+    static constexpr bool thread_safe = false;
+
+    std::pmr::unsynchronized_pool_resource resource{compare_pool_options()};
+
+    void* allocate(size_t size) { return resource.allocate(size, DEFAULT_ALIGNMENT); }
+    void deallocate(void* ptr, size_t size) { resource.deallocate(ptr, size, DEFAULT_ALIGNMENT); }
+};
+
+// ==================== 测量框架 ====================
+
+// 一次运行中所有线程共享的测量状态
+struct RunState {
+    LatencyHistogram alloc_latency;
+    LatencyHistogram free_latency;
+    std::atomic<int64_t> live_bytes{0};
+    std::atomic<int64_t> peak_live_bytes{0};
+    std::atomic<size_t> peak_rss{0};
+    std::atomic<size_t> operations{0};
+
+    static void update_max(std::atomic<int64_t>& target, int64_t value) {
+        int64_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void update_max(std::atomic<size_t>& target, size_t value) {
+        size_t current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// 每个线程一个：采样计时、写入新分配的内存，并周期性地汇总存活字节数和常驻内存
+template<typename Alloc>
+class MeasuredAllocator {
+private:
+    Alloc& alloc;
+    RunState& state;
+    size_t op_count = 0;
+    size_t flushed_ops = 0;
+    size_t alloc_count = 0;   // 分配与释放分别计数采样，避免交替调用时只采到其中一种
+    size_t free_count = 0;
+    int64_t pending_live = 0;
+
+    static uint64_t ticks_to_ns(uint64_t ticks) {
+        return static_cast<uint64_t>(ticks * CycleClock::nanoseconds_per_tick());
+    }
+
+    // 每页写一个字节，保证常驻内存反映真实占用，又不让大块的memset主导耗时
+    static void touch(void* ptr, size_t size) {
+        char* bytes = static_cast<char*>(ptr);
+        for (size_t offset = 0; offset < size; offset += PageMap::PAGE_SIZE) {
+            bytes[offset] = 1;
+        }
+        bytes[size - 1] = 1;
+    }
+
+    void count_operation() {
+        if (++op_count % RSS_SAMPLE_INTERVAL == 0) {
+            flush();
+        }
+    }
+
+public:
+    MeasuredAllocator(Alloc& a, RunState& s) : alloc(a), state(s) {}
+
+    ~MeasuredAllocator() {
+        flush();
+    }
+
+    void* allocate(size_t size) {
+        void* ptr;
+        if (alloc_count++ % LATENCY_SAMPLE_INTERVAL == 0) {
+            uint64_t start = CycleClock::now();
+            ptr = alloc.allocate(size);
+            state.alloc_latency.record(ticks_to_ns(CycleClock::now() - start));
+        } else {
+            ptr = alloc.allocate(size);
+        }
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        touch(ptr, size);
+        pending_live += static_cast<int64_t>(size);
+        count_operation();
+        return ptr;
+    }
+
+    void deallocate(void* ptr, size_t size) {
+        if (free_count++ % LATENCY_SAMPLE_INTERVAL == 0) {
+            uint64_t start = CycleClock::now();
+            alloc.deallocate(ptr, size);
+            state.free_latency.record(ticks_to_ns(CycleClock::now() - start));
+        } else {
+            alloc.deallocate(ptr, size);
+        }
+        pending_live -= static_cast<int64_t>(size);
+        count_operation();
+    }
+
+    void flush() {
+        int64_t live = state.live_bytes.fetch_add(pending_live, std::memory_order_relaxed) + pending_live;
+        pending_live = 0;
+        state.operations.fetch_add(op_count - flushed_ops, std::memory_order_relaxed);
+        flushed_ops = op_count;
+        RunState::update_max(state.peak_live_bytes, live);
+        RunState::update_max(state.peak_rss, resident_bytes());
+    }
+};
+
+// ==================== 负载 ====================
+
+enum class Workload {
+    FIXED_CHURN,        // 固定64字节，环形替换1024个存活对象
+    RANDOM_SIZES,       // 16B~1MiB 对数均匀分布，随机替换256个存活对象
+    PRODUCER_CONSUMER,  // 生产者分配、消费者释放，成对运行
+    MIXED_LIFETIME,     // 长寿命中等块与短寿命小块交错
+    COUNT
+};
+
+const char* workload_name(Workload workload) {
+    switch (workload) {
+        case Workload::FIXED_CHURN: return "fixed_churn";
+        case Workload::RANDOM_SIZES: return "random_sizes";
+        case Workload::PRODUCER_CONSUMER: return "producer_consumer";
+        case Workload::MIXED_LIFETIME: return "mixed_lifetime";
+        default: return "unknown";
+    }
+}
+
+template<typename Alloc>
+void run_fixed_churn(MeasuredAllocator<Alloc>& alloc, size_t, size_t ops) {
+    const size_t live_count = 1024;
+    const size_t size = 64;
+    std::vector<void*> live(live_count, nullptr);
+
+    for (size_t i = 0; i < ops; ++i) {
+        size_t slot = i % live_count;
+        if (live[slot]) {
+            alloc.deallocate(live[slot], size);
+        }
+        live[slot] = alloc.allocate(size);
+    }
+
+    for (void* ptr : live) {
+        if (ptr) {
+            alloc.deallocate(ptr, size);
+        }
+    }
+}
+
+template<typename Alloc>
+void run_random_sizes(MeasuredAllocator<Alloc>& alloc, size_t thread_index, size_t ops) {
+    const size_t live_count = 256;
+    std::mt19937 rng(static_cast<unsigned>(thread_index + 1));
+    std::uniform_real_distribution<double> log_size(std::log(16.0), std::log(1024.0 * 1024.0));
+    std::uniform_int_distribution<size_t> slot_dist(0, live_count - 1);
+    std::vector<std::pair<void*, size_t>> live(live_count, {nullptr, 0});
+
+    for (size_t i = 0; i < ops; ++i) {
+        auto& entry = live[slot_dist(rng)];
+        if (entry.first) {
+            alloc.deallocate(entry.first, entry.second);
+        }
+        entry.second = static_cast<size_t>(std::exp(log_size(rng)));
+        entry.first = alloc.allocate(entry.second);
+    }
+
+    for (auto& entry : live) {
+        if (entry.first) {
+            alloc.deallocate(entry.first, entry.second);
+        }
+    }
+}
+
+// 生产者与消费者之间的交接队列，按批交换以免队列本身成为瓶颈
+struct HandoffQueue {
+    static constexpr size_t BATCH_SIZE = 64;
+    static constexpr size_t MAX_PENDING = 64 * BATCH_SIZE;
+
+    std::mutex mutex;
+    std::vector<std::pair<void*, size_t>> items;
+    bool done = false;
+};
+
+template<typename Alloc>
+void run_producer(MeasuredAllocator<Alloc>& alloc, HandoffQueue& queue, size_t thread_index, size_t ops) {
+    std::mt19937 rng(static_cast<unsigned>(thread_index + 1));
+    std::uniform_int_distribution<size_t> size_dist(16, 512);
+    std::vector<std::pair<void*, size_t>> batch;
+    batch.reserve(HandoffQueue::BATCH_SIZE);
+
+    for (size_t i = 0; i < ops; ++i) {
+        size_t size = size_dist(rng);
+        batch.emplace_back(alloc.allocate(size), size);
+        if (batch.size() == HandoffQueue::BATCH_SIZE || i + 1 == ops) {
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    if (queue.items.size() < HandoffQueue::MAX_PENDING) {
+                        queue.items.insert(queue.items.end(), batch.begin(), batch.end());
+                        break;
+                    }
+                }
+                std::this_thread::yield();
+            }
+            batch.clear();
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.done = true;
+}
+
+template<typename Alloc>
+void run_consumer(MeasuredAllocator<Alloc>& alloc, HandoffQueue& queue) {
+    std::vector<std::pair<void*, size_t>> batch;
+
+    for (;;) {
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            batch.swap(queue.items);
+            done = queue.done;
+        }
+        if (batch.empty()) {
+            if (done) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        for (auto& item : batch) {
+            alloc.deallocate(item.first, item.second);
+        }
+        batch.clear();
+    }
+}
+
+template<typename Alloc>
+void run_mixed_lifetime(MeasuredAllocator<Alloc>& alloc, size_t thread_index, size_t ops) {
+    const size_t long_lived_capacity = 2048;
+    const size_t short_lived_window = 8;
+    std::mt19937 rng(static_cast<unsigned>(thread_index + 1));
+    std::uniform_int_distribution<size_t> long_size(1024, 64 * 1024);
+    std::uniform_int_distribution<size_t> short_size(16, 512);
+    std::uniform_int_distribution<size_t> slot_dist(0, long_lived_capacity - 1);
+
+    std::vector<std::pair<void*, size_t>> long_lived;
+    long_lived.reserve(long_lived_capacity);
+    std::vector<std::pair<void*, size_t>> short_lived(short_lived_window, {nullptr, 0});
+
+    for (size_t i = 0; i < ops; ++i) {
+        if (i % 16 == 0) {
+            size_t size = long_size(rng);
+            void* ptr = alloc.allocate(size);
+            if (long_lived.size() < long_lived_capacity) {
+                long_lived.emplace_back(ptr, size);
+            } else {
+                auto& entry = long_lived[slot_dist(rng)];
+                alloc.deallocate(entry.first, entry.second);
+                entry = {ptr, size};
+            }
+        } else {
+            auto& entry = short_lived[i % short_lived_window];
+            if (entry.first) {
+                alloc.deallocate(entry.first, entry.second);
+            }
+            entry.second = short_size(rng);
+            entry.first = alloc.allocate(entry.second);
+        }
+    }
+
+    for (auto& entry : long_lived) {
+        alloc.deallocate(entry.first, entry.second);
+    }
+    for (auto& entry : short_lived) {
+        if (entry.first) {
+            alloc.deallocate(entry.first, entry.second);
+        }
+    }
+}
+
+// ==================== 运行与结果 ====================
+
+// 子进程通过管道回传的结果，必须是平凡类型
+struct CaseResult {
+    bool ok = false;
+    size_t threads = 0;
+    double seconds = 0.0;
+    size_t operations = 0;
+    uint64_t alloc_p50_ns = 0;
+    uint64_t alloc_p99_ns = 0;
+    uint64_t alloc_p999_ns = 0;
+    uint64_t free_p50_ns = 0;
+    uint64_t free_p99_ns = 0;
+    uint64_t free_p999_ns = 0;
+    size_t peak_live_bytes = 0;
+    size_t peak_rss_bytes = 0;      // 相对运行前的增量
+    size_t retained_rss_bytes = 0;  // 全部释放后、分配器析构前仍常驻的增量
+
+    double ops_per_sec() const {
+        return seconds > 0.0 ? operations / seconds : 0.0;
+    }
+
+    // 峰值常驻内存中不属于存活数据的比例
+    double fragmentation() const {
+        if (peak_rss_bytes == 0 || peak_live_bytes >= peak_rss_bytes) {
+            return 0.0;
+        }
+        return 1.0 - static_cast<double>(peak_live_bytes) / peak_rss_bytes;
+    }
+};
+
+// 生产者-消费者负载按对运行，其余负载每个线程独立
+size_t workload_threads(Workload workload, size_t threads) {
+    if (workload == Workload::PRODUCER_CONSUMER) {
+        return std::max<size_t>(1, threads / 2) * 2;
+    }
+    return threads;
+}
+
+// 大块负载的每次操作代价高出一到两个数量级，缩减操作数以控制总时长
+size_t workload_ops(Workload workload, size_t ops) {
+    return workload == Workload::RANDOM_SIZES ? std::max<size_t>(1, ops / 10) : ops;
+}
+
+template<typename Alloc>
+CaseResult run_case(Workload workload, size_t threads, size_t ops) {
+    CaseResult result;
+    result.threads = threads;
+    size_t rss_before = resident_bytes();
+    RunState state;
+
+    {
+        Alloc alloc;
+        std::vector<std::thread> workers;
+        std::vector<HandoffQueue> queues(workload == Workload::PRODUCER_CONSUMER ? threads / 2 : 0);
+        std::atomic<bool> start{false};
+
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                MeasuredAllocator<Alloc> measured(alloc, state);
+                while (!start.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                switch (workload) {
+                    case Workload::FIXED_CHURN:
+                        run_fixed_churn(measured, t, ops);
+                        break;
+                    case Workload::RANDOM_SIZES:
+                        run_random_sizes(measured, t, ops);
+                        break;
+                    case Workload::PRODUCER_CONSUMER:
+                        if (t % 2 == 0) {
+                            run_producer(measured, queues[t / 2], t, ops);
+                        } else {
+                            run_consumer(measured, queues[t / 2]);
+                        }
+                        break;
+                    case Workload::MIXED_LIFETIME:
+                        run_mixed_lifetime(measured, t, ops);
+                        break;
+                    default:
+                        break;
+                }
+            });
+        }
+
+        auto start_time = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto end_time = std::chrono::steady_clock::now();
+        result.seconds = std::chrono::duration<double>(end_time - start_time).count();
+
+        size_t rss_after = resident_bytes();
+        result.retained_rss_bytes = rss_after > rss_before ? rss_after - rss_before : 0;
+    }
+
+    size_t peak_rss = state.peak_rss.load();
+    result.peak_rss_bytes = peak_rss > rss_before ? peak_rss - rss_before : 0;
+    result.peak_live_bytes = static_cast<size_t>(std::max<int64_t>(0, state.peak_live_bytes.load()));
+    result.operations = state.operations.load();
+    result.alloc_p50_ns = state.alloc_latency.percentile(0.5);
+    result.alloc_p99_ns = state.alloc_latency.percentile(0.99);
+    result.alloc_p999_ns = state.alloc_latency.percentile(0.999);
+    result.free_p50_ns = state.free_latency.percentile(0.5);
+    result.free_p99_ns = state.free_latency.percentile(0.99);
+    result.free_p999_ns = state.free_latency.percentile(0.999);
+    result.ok = true;
+    return result;
+}
+
+// 在子进程中运行一个组合，避免前一个分配器保留的内存影响后一个的常驻内存读数
+template<typename Alloc>
+bool run_isolated(Workload workload, size_t threads, size_t ops, CaseResult& result) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        CaseResult child_result;
+        try {
+            child_result = run_case<Alloc>(workload, threads, ops);
+        } catch (const std::exception& e) {
+            std::cerr << Alloc::name << "/" << workload_name(workload) << " 失败: " << e.what() << std::endl;
+            child_result.ok = false;
+        }
+        ssize_t written = write(fds[1], &child_result, sizeof(child_result));
+        _exit(written == static_cast<ssize_t>(sizeof(child_result)) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    size_t received = 0;
+    char* buffer = reinterpret_cast<char*>(&result);
+    while (received < sizeof(result)) {
+        ssize_t n = read(fds[0], buffer + received, sizeof(result) - received);
+        if (n <= 0) {
+            break;
+        }
+        received += static_cast<size_t>(n);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return received == sizeof(result) && result.ok;
+}
+
+void print_header() {
+    std::cout << std::setw(12) << "allocator"
+              << std::setw(8) << "threads"
+              << std::setw(10) << "Mops/s"
+              << std::setw(22) << "alloc p50/p99/p99.9"
+              << std::setw(22) << "free p50/p99/p99.9"
+              << std::setw(11) << "peak MiB"
+              << std::setw(11) << "kept MiB"
+              << std::setw(8) << "frag" << std::endl;
+}
+
+std::string latency_triplet(uint64_t p50, uint64_t p99, uint64_t p999) {
+    std::ostringstream oss;
+    oss << p50 << "/" << p99 << "/" << p999;
+    return oss.str();
+}
+
+void print_row(const char* allocator, const CaseResult& result) {
+    const double mib = 1024.0 * 1024.0;
+    std::cout << std::setw(12) << allocator
+              << std::setw(8) << result.threads
+              << std::setw(10) << std::fixed << std::setprecision(2) << result.ops_per_sec() / 1e6
+              << std::setw(22) << latency_triplet(result.alloc_p50_ns, result.alloc_p99_ns, result.alloc_p999_ns)
+              << std::setw(22) << latency_triplet(result.free_p50_ns, result.free_p99_ns, result.free_p999_ns)
+              << std::setw(11) << std::setprecision(1) << result.peak_rss_bytes / mib
+              << std::setw(11) << result.retained_rss_bytes / mib
+              << std::setw(7) << std::setprecision(1) << result.fragmentation() * 100 << "%" << std::endl;
+}
+
+void write_json(std::ostream& out, Workload workload, const char* allocator, const CaseResult& result) {
+    out << "{\"workload\":\"" << workload_name(workload) << "\""
+        << ",\"allocator\":\"" << allocator << "\""
+        << ",\"threads\":" << result.threads
+        << ",\"operations\":" << result.operations
+        << ",\"seconds\":" << std::setprecision(6) << result.seconds
+        << ",\"ops_per_sec\":" << std::setprecision(0) << std::fixed << result.ops_per_sec()
+        << ",\"alloc_p50_ns\":" << result.alloc_p50_ns
+        << ",\"alloc_p99_ns\":" << result.alloc_p99_ns
+        << ",\"alloc_p999_ns\":" << result.alloc_p999_ns
+        << ",\"free_p50_ns\":" << result.free_p50_ns
+        << ",\"free_p99_ns\":" << result.free_p99_ns
+        << ",\"free_p999_ns\":" << result.free_p999_ns
+        << ",\"peak_live_bytes\":" << result.peak_live_bytes
+        << ",\"peak_rss_bytes\":" << result.peak_rss_bytes
+        << ",\"retained_rss_bytes\":" << result.retained_rss_bytes
+        << ",\"fragmentation\":" << std::setprecision(4) << result.fragmentation()
+        << "}" << std::endl;
+}
+
+template<typename Alloc>
+void compare_one(Workload workload, size_t threads, size_t ops, std::ostream& json) {
+    if (!Alloc::thread_safe && workload_threads(workload, threads) > 1) {
+        return;
+    }
+
+    CaseResult result;
+    if (!run_isolated<Alloc>(workload, workload_threads(workload, threads), workload_ops(workload, ops), result)) {
+        std::cout << std::setw(12) << Alloc::name << "  (运行失败)" << std::endl;
+        return;
+    }
+    print_row(Alloc::name, result);
+    write_json(json, workload, Alloc::name, result);
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1) {
+        max_threads = std::max(1, std::atoi(argv[1]));
+    }
+    size_t ops_per_thread = 200000;
+    if (argc > 2) {
+        ops_per_thread = std::max(1, std::atoi(argv[2]));
+    }
+    std::string output_path = argc > 3 ? argv[3] : "mpool_compare.jsonl";
+
+    std::ofstream json(output_path);
+    if (!json) {
+        std::cerr << "无法写入结果文件: " << output_path << std::endl;
+        return 1;
+    }
+
+    // 在父进程中完成时钟校准，子进程直接继承
+    CycleClock::nanoseconds_per_tick();
+
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::cout << "分配器对比基准 (延迟单位ns，每" << LATENCY_SAMPLE_INTERVAL << "次操作采样一次)" << std::endl;
+
+    for (size_t w = 0; w < static_cast<size_t>(Workload::COUNT); ++w) {
+        Workload workload = static_cast<Workload>(w);
+        std::cout << "\n=== " << workload_name(workload) << " ===" << std::endl;
+        print_header();
+
+        size_t last_threads = 0;
+        for (size_t threads : thread_counts) {
+            if (workload_threads(workload, threads) == last_threads) {
+                continue;
+            }
+            last_threads = workload_threads(workload, threads);
+
+            compare_one<MemoryPoolAdapter>(workload, threads, ops_per_thread, json);
+            compare_one<ArenaPoolAdapter>(workload, threads, ops_per_thread, json);
+            compare_one<MallocAdapter>(workload, threads, ops_per_thread, json);
+            compare_one<PmrSynchronizedAdapter>(workload, threads, ops_per_thread, json);
+            compare_one<PmrUnsynchronizedAdapter>(workload, threads, ops_per_thread, json);
+        }
+    }
+
+    std::cout << "\n结果已写入 " << output_path << std::endl;
+    return 0;
+}
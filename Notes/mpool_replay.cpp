@@ -0,0 +1,231 @@
+// 分配轨迹回放：用 MemoryPool::start_trace 记录的轨迹驱动任意配置的内存池
+// 编译: g++ -std=c++17 -O2 -pthread mpool_replay.cpp -o mpool_replay
+// 运行: ./mpool_replay <轨迹文件> [选项]
+//   --initial-size <MiB>   初始内存池大小，默认1
+//   --min-block <字节>      最小块大小，默认 MIN_BLOCK_SIZE
+//   --max-block <字节>      最大块大小，默认 MAX_BLOCK_SIZE
+//   --thread-cache         开启线程缓存
+//   --no-lock              单线程模式（只适用于单线程记录的轨迹）
+//   --repeat <次数>         重复回放，报告最短的一次，默认1
+//
+// 每个记录线程对应一个回放线程，线程内按原顺序全速执行，不按记录时的间隔等待。
+// 释放另一个线程分配的对象时，等待该分配先完成
+
+#define MPOOL_NO_MAIN
+#include "mpool.cpp"
+
+#include <fstream>
+#include <iomanip>
+
+struct ReplayOptions {
+    std::string trace_path;
+    size_t initial_size = 1024 * 1024;
+    size_t min_block = MIN_BLOCK_SIZE;
+    size_t max_block = MAX_BLOCK_SIZE;
+    bool thread_cache = false;
+    bool thread_safe = true;
+    size_t repeat = 1;
+};
+
+struct ReplayResult {
+    double seconds = 0.0;
+    size_t peak_footprint = 0;      // 内存段、大对象和span缓存占用之和的峰值
+    size_t peak_used = 0;           // PoolStats记录的已分配块字节数峰值
+    size_t peak_rss = 0;            // 相对回放前的常驻内存增量峰值
+};
+
+// 当前进程的常驻内存（Linux）
+size_t resident_bytes() {
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> total_pages >> resident_pages;
+    return resident_pages * PageMap::PAGE_SIZE;
+}
+
+size_t pool_footprint(const MemoryPool& pool) {
+    PoolStats stats = pool.get_stats();
+    return stats.get_total_memory() + stats.get_large_object_memory() + stats.get_large_cache_memory();
+}
+
+// 轨迹本身的存活字节数峰值（按请求大小），是任何分配器都无法低于的下限
+size_t peak_live_bytes(const std::vector<TraceEvent>& events, size_t object_count) {
+    std::vector<uint64_t> sizes(object_count, 0);
+    size_t live = 0;
+    size_t peak = 0;
+    for (const TraceEvent& event : events) {
+        if (event.type == TraceEventType::DEALLOCATE) {
+            live -= sizes[event.object_id];
+        } else {
+            sizes[event.object_id] = event.size;
+            live += event.size;
+            peak = std::max(peak, live);
+        }
+    }
+    return peak;
+}
+
+void replay_thread(MemoryPool& pool, const std::vector<TraceEvent>& events,
+                   std::vector<std::atomic<void*>>& objects, const std::atomic<bool>& start) {
+    while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    for (const TraceEvent& event : events) {
+        size_t alignment = size_t(1) << event.alignment_log2;
+        switch (event.type) {
+            case TraceEventType::ALLOCATE:
+                objects[event.object_id].store(pool.allocate(event.size, alignment), std::memory_order_release);
+                break;
+            case TraceEventType::ALLOCATE_ZEROED:
+                objects[event.object_id].store(pool.allocate_zeroed(event.size, alignment), std::memory_order_release);
+                break;
+            case TraceEventType::DEALLOCATE: {
+                void* ptr;
+                while (!(ptr = objects[event.object_id].load(std::memory_order_acquire))) {
+                    std::this_thread::yield();
+                }
+                pool.deallocate(ptr);
+                break;
+            }
+        }
+    }
+}
+
+ReplayResult replay(const ReplayOptions& options, const std::vector<std::vector<TraceEvent>>& per_thread,
+                    size_t object_count) {
+    ReplayResult result;
+    size_t rss_before = resident_bytes();
+
+    MemoryPool pool(options.initial_size, options.min_block, options.max_block, options.thread_safe);
+    pool.set_thread_cache_enabled(options.thread_cache);
+
+    std::vector<std::atomic<void*>> objects(object_count);
+    std::atomic<bool> start{false};
+    std::atomic<bool> finished{false};
+    std::vector<std::thread> threads;
+    for (const auto& events : per_thread) {
+        threads.emplace_back(replay_thread, std::ref(pool), std::cref(events), std::ref(objects), std::cref(start));
+    }
+
+    // 采样线程：内存池占用与常驻内存的峰值
+    std::thread monitor([&]() {
+        while (!finished.load(std::memory_order_acquire)) {
+            result.peak_footprint = std::max(result.peak_footprint, pool_footprint(pool));
+            size_t rss = resident_bytes();
+            result.peak_rss = std::max(result.peak_rss, rss > rss_before ? rss - rss_before : 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    auto start_time = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    finished.store(true, std::memory_order_release);
+    monitor.join();
+
+    result.seconds = std::chrono::duration<double>(end_time - start_time).count();
+    result.peak_footprint = std::max(result.peak_footprint, pool_footprint(pool));
+    result.peak_used = pool.get_stats().get_peak_memory_usage();
+    return result;
+}
+
+bool parse_options(int argc, char* argv[], ReplayOptions& options) {
+    if (argc < 2) {
+        return false;
+    }
+    options.trace_path = argv[1];
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--initial-size" && has_value) {
+            options.initial_size = std::stoul(argv[++i]) * 1024 * 1024;
+        } else if (arg == "--min-block" && has_value) {
+            options.min_block = std::stoul(argv[++i]);
+        } else if (arg == "--max-block" && has_value) {
+            options.max_block = std::stoul(argv[++i]);
+        } else if (arg == "--thread-cache") {
+            options.thread_cache = true;
+        } else if (arg == "--no-lock") {
+            options.thread_safe = false;
+        } else if (arg == "--repeat" && has_value) {
+            options.repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    ReplayOptions options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "用法: " << argv[0] << " <轨迹文件> [--initial-size MiB] [--min-block 字节] [--max-block 字节]"
+                  << " [--thread-cache] [--no-lock] [--repeat 次数]" << std::endl;
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    if (!TraceRecorder::load(options.trace_path, events)) {
+        std::cerr << "无法读取轨迹文件: " << options.trace_path << std::endl;
+        return 1;
+    }
+
+    // load已把对象和线程重新编号为从0开始的连续序号
+    size_t object_count = 0;
+    size_t thread_count = 0;
+    for (const TraceEvent& event : events) {
+        object_count = std::max<size_t>(object_count, event.object_id + 1);
+        thread_count = std::max<size_t>(thread_count, event.thread_index + 1);
+    }
+    std::vector<std::vector<TraceEvent>> per_thread(thread_count);
+    for (const TraceEvent& event : events) {
+        per_thread[event.thread_index].push_back(event);
+    }
+
+    if (!options.thread_safe && thread_count > 1) {
+        std::cerr << "--no-lock 只适用于单线程轨迹，该轨迹包含 " << thread_count << " 个线程" << std::endl;
+        return 1;
+    }
+
+    size_t live_peak = peak_live_bytes(events, object_count);
+
+    std::cout << "轨迹: " << options.trace_path << std::endl;
+    std::cout << "  事件数: " << events.size() << "，对象数: " << object_count
+              << "，线程数: " << thread_count << std::endl;
+    std::cout << "  记录时长: " << std::fixed << std::setprecision(3)
+              << (events.empty() ? 0.0 : events.back().timestamp_ns / 1e9) << " s" << std::endl;
+    std::cout << "  存活字节峰值: " << live_peak << std::endl;
+
+    try {
+        ReplayResult best;
+        for (size_t run = 0; run < options.repeat; ++run) {
+            ReplayResult result = replay(options, per_thread, object_count);
+            if (run == 0 || result.seconds < best.seconds) {
+                best = result;
+            }
+        }
+
+        double fragmentation = best.peak_footprint > 0
+            ? 1.0 - static_cast<double>(live_peak) / best.peak_footprint : 0.0;
+
+        std::cout << "回放结果 (最短的一次，共" << options.repeat << "次):" << std::endl;
+        std::cout << "  耗时: " << std::setprecision(3) << best.seconds * 1e3 << " ms ("
+                  << std::setprecision(1) << (best.seconds > 0 ? events.size() / best.seconds / 1e6 : 0.0)
+                  << " M事件/s)" << std::endl;
+        std::cout << "  内存池占用峰值: " << best.peak_footprint << std::endl;
+        std::cout << "  已分配块峰值（不含大对象）: " << best.peak_used << std::endl;
+        std::cout << "  常驻内存增量峰值: " << best.peak_rss << std::endl;
+        std::cout << "  碎片率 (1 - 存活字节峰值 / 占用峰值): " << std::setprecision(1)
+                  << std::max(0.0, fragmentation) * 100 << "%" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "回放失败: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}